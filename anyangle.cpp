@@ -0,0 +1,234 @@
+#include "anyangle.h"
+#include "compactpath.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <queue>
+
+namespace {
+
+/**
+ * @brief Деление с округлением вниз (для отрицательных числителей тоже).
+ */
+long long floorDiv(long long a, long long b)
+{
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+/**
+ * @brief Деление с округлением вверх.
+ */
+long long ceilDiv(long long a, long long b)
+{
+    return -floorDiv(-a, b);
+}
+
+/**
+ * @brief Элемент открытого списка Theta*.
+ */
+struct OpenEntry {
+    float f;    /**< Оценка полной стоимости. */
+    float g;    /**< Стоимость на момент добавления (для отбрасывания устаревших копий). */
+    int cell;   /**< Индекс ячейки (y * width + x). */
+    bool operator<(const OpenEntry &o) const { return f > o.f; }
+};
+
+}
+
+/**
+ * @brief Проверка прямой видимости между центрами двух ячеек.
+ *
+ * Координаты удваиваются, чтобы границы ячеек были целыми: ячейка c занимает
+ * отрезок [2c - 1, 2c + 1]. Для каждой строки, через которую проходит отрезок,
+ * точно (в целых числах) вычисляется диапазон ячеек, которых он касается, и этот
+ * диапазон проверяется целиком по словам маски.
+ */
+bool lineOfSight(const Grid &grid, const Node &from, const Node &to)
+{
+    if (!grid.contains(from.x, from.y) || !grid.contains(to.x, to.y))
+        return false;
+
+    Node p{from.x, from.y};
+    Node q{to.x, to.y};
+    if (p.y > q.y)
+        std::swap(p, q);
+    const long long dx = q.x - p.x;
+    const long long dy = q.y - p.y;
+    if (dy == 0)
+        return grid.isSpanFree(p.y, std::min(p.x, q.x), std::max(p.x, q.x));
+
+    for (int y = p.y; y <= q.y; ++y) {
+        // Часть отрезка внутри полосы строки y (удвоенные смещения от p.y)
+        const long long t0 = std::max<long long>(2ll * p.y, 2ll * y - 1) - 2ll * p.y;
+        const long long t1 = std::min<long long>(2ll * q.y, 2ll * y + 1) - 2ll * p.y;
+        // Удвоенные x концов этой части, умноженные на dy
+        long long n0 = 2ll * p.x * dy + dx * t0;
+        long long n1 = 2ll * p.x * dy + dx * t1;
+        if (n0 > n1)
+            std::swap(n0, n1);
+        const int x0 = int(std::max<long long>(0, ceilDiv(n0 - dy, 2 * dy)));
+        const int x1 = int(std::min<long long>(grid.width() - 1, floorDiv(n1 + dy, 2 * dy)));
+        if (!grid.isSpanFree(y, x0, x1))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Спрямление пути (string pulling).
+ *
+ * Между соседними углами пути лежит прямой участок свободных ячеек, поэтому
+ * предыдущий угол всегда виден из следующего, и жадный проход корректен.
+ */
+std::vector<Node> pullString(const Grid &grid, const CompactPath &path)
+{
+    std::vector<Node> waypoints;
+    if (path.empty())
+        return waypoints;
+
+    Node anchor = path.front();
+    Node lastVisible = anchor;
+    Node node = anchor;
+    waypoints.push_back(anchor);
+    const size_t steps = path.steps();
+    for (size_t i = 0; i < steps; ++i) {
+        const CompactPath::Direction d = path.direction(i);
+        node.x += CompactPath::dx[d];
+        node.y += CompactPath::dy[d];
+        if (i + 1 < steps && path.direction(i + 1) == d)
+            continue;
+
+        if (!lineOfSight(grid, anchor, node)) {
+            waypoints.push_back(lastVisible);
+            anchor = lastVisible;
+        }
+        lastVisible = node;
+    }
+    if (!(waypoints.back() == node))
+        waypoints.push_back(node);
+    return waypoints;
+}
+
+/**
+ * @brief Длина ломаной по опорным точкам (евклидова).
+ */
+double waypointLength(const std::vector<Node> &waypoints)
+{
+    double length = 0;
+    for (size_t i = 1; i < waypoints.size(); ++i)
+        length += std::hypot(double(waypoints[i].x - waypoints[i - 1].x), double(waypoints[i].y - waypoints[i - 1].y));
+    return length;
+}
+
+/**
+ * @brief Поиск пути под любыми углами (Lazy Theta*).
+ *
+ * При добавлении соседа предполагается, что он виден из родителя текущей ячейки
+ * (путь 2 Theta*). При раскрытии ячейки предположение проверяется; если видимости нет,
+ * родителем становится лучший из уже закрытых соседей (такой всегда есть - ячейка,
+ * из которой пришли). Состояние поиска размещается в арене потока.
+ */
+std::vector<Node> theta_star_search(const Grid &grid, const Node &start, const Node &goal, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    if (!grid.contains(start.x, start.y) || !grid.contains(goal.x, goal.y))
+        return {};
+
+    ArenaScope arena;
+    std::pmr::memory_resource *memory = arena.resource();
+
+    const int width = grid.width();
+    const float infinity = std::numeric_limits<float>::infinity();
+    std::pmr::vector<float> g_score(grid.cellCount(), infinity, memory);
+    std::pmr::vector<int> parent(grid.cellCount(), -1, memory);
+    std::pmr::vector<uint8_t> closed(grid.cellCount(), 0, memory);
+    std::priority_queue<OpenEntry, std::pmr::vector<OpenEntry>> open_set{std::less<OpenEntry>(),
+                                                                          std::pmr::vector<OpenEntry>(memory)};
+
+    auto distance = [width](int a, int b) {
+        return float(std::hypot(double(a % width - b % width), double(a / width - b / width)));
+    };
+    auto toNode = [width](int cell) { return Node{cell % width, cell / width}; };
+    const int startCell = start.y * width + start.x;
+    const int goalCell = goal.y * width + goal.x;
+
+    g_score[startCell] = 0;
+    parent[startCell] = startCell;
+    open_set.push({distance(startCell, goalCell), 0, startCell});
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = 1);
+
+    static const int dx[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+    static const int dy[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+
+    while (!open_set.empty()) {
+        const OpenEntry entry = open_set.top();
+        open_set.pop();
+        const int cell = entry.cell;
+        if (closed[cell] || entry.g != g_score[cell]) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        const Node current = toNode(cell);
+        SEARCH_STATS(stats, ++stats->expansions;
+                     if (stats->recordExpansions) stats->expansionOrder.push_back(cell));
+
+        // Проверка отложенной видимости родителя
+        if (parent[cell] != cell && !lineOfSight(grid, toNode(parent[cell]), current)) {
+            g_score[cell] = infinity;
+            for (int d = 0; d < 8; ++d) {
+                const int nx = current.x + dx[d];
+                const int ny = current.y + dy[d];
+                if (!grid.contains(nx, ny))
+                    continue;
+                if (d >= 4 && (grid.isBlocked(nx, current.y) || grid.isBlocked(current.x, ny)))
+                    continue;
+                const int neighbor = ny * width + nx;
+                const float g = g_score[neighbor] + distance(neighbor, cell);
+                if (closed[neighbor] && g < g_score[cell]) {
+                    g_score[cell] = g;
+                    parent[cell] = neighbor;
+                }
+            }
+        }
+        closed[cell] = 1;
+
+        if (cell == goalCell) {
+            SEARCH_STATS(stats, stats->peakMemoryBytes = std::max<long long>(stats->peakMemoryBytes, arena.bytesUsed()));
+            size_t count = 1;
+            for (int c = cell; parent[c] != c; c = parent[c])
+                ++count;
+            std::vector<Node> waypoints(count, Node{0, 0});
+            for (int c = cell; count-- > 0; c = parent[c])
+                waypoints[count] = toNode(c);
+            return waypoints;
+        }
+
+        const int from = parent[cell];
+        for (int d = 0; d < 8; ++d) {
+            const int nx = current.x + dx[d];
+            const int ny = current.y + dy[d];
+            if (!grid.isFree(nx, ny))
+                continue;
+            if (d >= 4 && (grid.isBlocked(nx, current.y) || grid.isBlocked(current.x, ny)))
+                continue;
+            const int neighbor = ny * width + nx;
+            if (closed[neighbor])
+                continue;
+
+            const float g = g_score[from] + distance(from, neighbor);
+            if (g < g_score[neighbor]) {
+                g_score[neighbor] = g;
+                parent[neighbor] = from;
+                open_set.push({g + distance(neighbor, goalCell), g, neighbor});
+                SEARCH_STATS(stats, ++stats->pushes;
+                             stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, open_set.size()));
+            }
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max<long long>(stats->peakMemoryBytes, arena.bytesUsed()));
+    return {};
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pathfinding.h"
+
+#include <vector>
+
+class CompactPath;
+
+/**
+ * @brief Проверка прямой видимости между центрами двух ячеек.
+ *
+ * Отрезок между центрами ячеек видим, если все ячейки, которых он касается (включая
+ * касание границы или угла), свободны. Поэтому отрезок не проходит между двумя
+ * заблокированными ячейками, соприкасающимися углами. Ячейки отрезка перебираются
+ * построчно, а каждая строка проверяется по словам битовой маски (Grid::isSpanFree()).
+ *
+ * @param grid Сетка препятствий.
+ * @param from Начальная ячейка.
+ * @param to Конечная ячейка.
+ * @return true, если обе ячейки внутри сетки и отрезок между ними свободен.
+ */
+bool lineOfSight(const Grid &grid, const Node &from, const Node &to);
+
+/**
+ * @brief Спрямление пути (string pulling).
+ *
+ * Жадно заменяет участки пути отрезками прямой видимости: из текущей опорной точки
+ * путь продолжается до последнего угла, который еще виден, и этот угол становится
+ * следующей опорной точкой. Проверяются только углы пути, поэтому на прямых участках
+ * проверки видимости не выполняются.
+ *
+ * @param grid Сетка, на которой найден путь.
+ * @param path Путь по соседним ячейкам.
+ * @return Опорные точки пути (первая - начало, последняя - конец); пусто, если путь пуст.
+ */
+std::vector<Node> pullString(const Grid &grid, const CompactPath &path);
+
+/**
+ * @brief Длина ломаной по опорным точкам (евклидова).
+ *
+ * @param waypoints Опорные точки.
+ * @return Сумма длин отрезков.
+ */
+double waypointLength(const std::vector<Node> &waypoints);
+
+/**
+ * @brief Поиск пути под любыми углами (Lazy Theta*).
+ *
+ * Вариант A* на 8-связной сетке (диагональный шаг допустим, только если свободны обе
+ * соседние по стороне ячейки), в котором родителем ячейки может стать любой видимый
+ * предок. Прямая видимость проверяется лениво - при раскрытии ячейки, а не при каждом
+ * обновлении соседа, поэтому проверок на порядок меньше, чем у Theta*.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return Опорные точки пути; между соседними точками есть прямая видимость.
+ *         Если путь не найден, возвращается пустой вектор.
+ */
+std::vector<Node> theta_star_search(const Grid &grid, const Node &start, const Node &goal, SearchStats *stats = nullptr);
@@ -0,0 +1,260 @@
+#include "anytime.h"
+#include "pathcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+namespace {
+
+const uint8_t NoParent = SearchTree::Unreached;
+const uint8_t StartCell = SearchTree::Root;
+
+}
+
+/**
+ * @brief Конструктор поиска.
+ *
+ * Выделяет состояние поиска; сам поиск выполняется вызовами improve().
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param initialEpsilon Вес эвристики первой итерации (не меньше 1).
+ * @param epsilonStep Уменьшение веса между итерациями.
+ */
+AnytimeSearch::AnytimeSearch(const Grid &grid, const Node &start, const Node &goal, double initialEpsilon,
+                             double epsilonStep)
+    : m_grid(grid),
+    m_start{start.x, start.y},
+    m_goal{goal.x, goal.y},
+    m_goalCell(goal.y * grid.width() + goal.x),
+    m_epsilon(std::max(1.0, initialEpsilon)),
+    m_epsilonStep(std::max(0.01, epsilonStep))
+{
+    if (!grid.contains(start.x, start.y) || !grid.contains(goal.x, goal.y)) {
+        m_finished = true;
+        return;
+    }
+
+    m_g.assign(grid.cellCount(), INT_MAX);
+    m_cameFrom.assign(grid.cellCount(), NoParent);
+    m_closed.assign(grid.cellCount(), 0);
+    m_listed.assign(grid.cellCount(), 0);
+
+    const int startCell = start.y * grid.width() + start.x;
+    m_g[startCell] = 0;
+    m_cameFrom[startCell] = StartCell;
+    m_open.push_back({key(startCell), 0, startCell});
+}
+
+/**
+ * @brief Продолжение поиска.
+ *
+ * Выполняет итерации ARA* до нахождения лучшего пути, завершения поиска или
+ * исчерпания бюджета. Прерванная итерация продолжается следующим вызовом.
+ *
+ * @param budget Ограничение работы в этом вызове.
+ * @param stats Статистика поиска (может быть nullptr); счетчики накапливаются между вызовами.
+ * @return true, если найден путь лучше прежнего.
+ */
+bool AnytimeSearch::improve(const SearchBudget &budget, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    const auto started = std::chrono::steady_clock::now();
+    const long long expansionsBefore = m_expansions;
+    while (!m_finished) {
+        if (!improvePath(budget, expansionsBefore, started, stats))
+            return false;
+
+        const int previous = m_path.empty() ? INT_MAX : int(m_path.steps());
+        const bool improved = m_g[m_goalCell] < previous;
+        if (improved)
+            publishPath();
+        nextIteration();
+        if (improved)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Эвристика: манхэттенское расстояние до цели.
+ */
+int AnytimeSearch::heuristic(int cell) const
+{
+    const int width = m_grid.width();
+    return std::abs(cell % width - m_goal.x) + std::abs(cell / width - m_goal.y);
+}
+
+/**
+ * @brief Одна итерация взвешенного A* (ImprovePath).
+ *
+ * Раскрывает ячейки, пока ключ цели больше минимального ключа открытого списка.
+ * Ячейка раскрывается не более одного раза за итерацию; закрытые ячейки, стоимость
+ * которых уменьшилась, откладываются в список несогласованных до следующей итерации.
+ *
+ * @param budget Ограничение работы вызова improve().
+ * @param expansionsBefore Количество раскрытий до начала вызова improve().
+ * @param started Момент начала вызова improve().
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return true, если итерация завершена; false, если исчерпан бюджет.
+ */
+bool AnytimeSearch::improvePath(const SearchBudget &budget, long long expansionsBefore,
+                                std::chrono::steady_clock::time_point started, SearchStats *stats)
+{
+    const int width = m_grid.width();
+
+    while (!m_open.empty()) {
+        const OpenEntry top = m_open.front();
+        if (m_g[m_goalCell] != INT_MAX && m_g[m_goalCell] <= top.key)
+            return true;
+
+        const long long expansions = m_expansions - expansionsBefore;
+        if (budget.maxExpansions > 0 && expansions >= budget.maxExpansions)
+            return false;
+        if (budget.maxNs > 0 && (expansions & 63) == 0
+            && std::chrono::steady_clock::now() - started >= std::chrono::nanoseconds(budget.maxNs))
+            return false;
+
+        std::pop_heap(m_open.begin(), m_open.end());
+        m_open.pop_back();
+        const int cell = top.cell;
+        if (top.g != m_g[cell] || m_closed[cell] == m_iteration) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        m_closed[cell] = m_iteration;
+        ++m_expansions;
+        SEARCH_STATS(stats, ++stats->expansions; if (stats->recordExpansions) stats->expansionOrder.push_back(cell));
+
+        const Node current {cell % width, cell / width};
+        for (uint8_t d = 0; d < 4; ++d) {
+            const int nx = current.x + CompactPath::dx[d];
+            const int ny = current.y + CompactPath::dy[d];
+            if (!m_grid.isFree(nx, ny))
+                continue;
+            const int neighbor = ny * width + nx;
+            const int g = m_g[cell] + 1;
+            if (g >= m_g[neighbor])
+                continue;
+
+            m_g[neighbor] = g;
+            m_cameFrom[neighbor] = d;
+            if (m_closed[neighbor] != m_iteration) {
+                m_open.push_back({key(neighbor), g, neighbor});
+                std::push_heap(m_open.begin(), m_open.end());
+                SEARCH_STATS(stats, ++stats->pushes;
+                             stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, m_open.size()));
+            } else if (m_listed[neighbor] != m_iteration) {
+                m_listed[neighbor] = m_iteration;
+                m_incons.push_back(neighbor);
+            }
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max<long long>(
+                            stats->peakMemoryBytes,
+                            (long long)(m_g.size() * (sizeof(int) + 1 + 2 * sizeof(uint16_t))
+                                        + m_open.capacity() * sizeof(OpenEntry) + m_incons.capacity() * sizeof(int))));
+    return true;
+}
+
+/**
+ * @brief Сохранение пути до цели и оценки его субоптимальности.
+ *
+ * Оценка - отношение длины пути к нижней границе кратчайшего пути, вычисленной по
+ * открытым и несогласованным ячейкам, но не больше текущего веса эвристики.
+ */
+void AnytimeSearch::publishPath()
+{
+    m_path = CompactPath::fromParents(m_cameFrom.data(), m_grid.width(), m_start, m_goal, StartCell);
+
+    long long bound = m_g[m_goalCell];
+    for (const OpenEntry &entry : m_open) {
+        if (entry.g == m_g[entry.cell])
+            bound = std::min<long long>(bound, entry.g + heuristic(entry.cell));
+    }
+    for (int cell : m_incons)
+        bound = std::min<long long>(bound, m_g[cell] + heuristic(cell));
+    m_pathEpsilon = bound > 0 ? std::min(m_epsilon, double(m_g[m_goalCell]) / double(bound)) : 1.0;
+}
+
+/**
+ * @brief Переход к следующей итерации с меньшим весом эвристики.
+ *
+ * Несогласованные ячейки возвращаются в открытый список, ключи пересчитываются,
+ * отметки закрытых ячеек сбрасываются сменой номера итерации. Поиск завершается,
+ * если итерация с весом 1 выполнена или открытый список исчерпан.
+ */
+void AnytimeSearch::nextIteration()
+{
+    if (m_epsilon <= 1.0 || m_g[m_goalCell] == INT_MAX) {
+        m_finished = true;
+        if (!m_path.empty())
+            m_pathEpsilon = 1.0;
+        m_open = std::vector<OpenEntry>();
+        m_incons = std::vector<int>();
+        return;
+    }
+
+    m_epsilon = std::max(1.0, std::min(m_epsilon - m_epsilonStep, m_pathEpsilon));
+
+    // Пересборка кучи по новым ключам без устаревших копий; повторы отсеиваются
+    // отметками m_listed с промежуточным номером итерации
+    if (m_iteration >= UINT16_MAX - 2) {
+        std::fill(m_closed.begin(), m_closed.end(), 0);
+        std::fill(m_listed.begin(), m_listed.end(), 0);
+        m_iteration = 0;
+    }
+    ++m_iteration;
+    std::vector<OpenEntry> open;
+    open.reserve(m_open.size() + m_incons.size());
+    for (const OpenEntry &entry : m_open) {
+        if (entry.g == m_g[entry.cell] && m_listed[entry.cell] != m_iteration) {
+            m_listed[entry.cell] = m_iteration;
+            open.push_back({key(entry.cell), entry.g, entry.cell});
+        }
+    }
+    for (int cell : m_incons) {
+        if (m_listed[cell] != m_iteration) {
+            m_listed[cell] = m_iteration;
+            open.push_back({key(cell), m_g[cell], cell});
+        }
+    }
+    std::make_heap(open.begin(), open.end());
+    m_open.swap(open);
+    m_incons.clear();
+    ++m_iteration;
+}
+
+/**
+ * @brief Поиск пути с уточнением в пределах бюджета.
+ */
+CompactPath ara_star_search(const Grid &grid, const Node &start, const Node &goal, const SearchBudget &budget,
+                            SearchStats *stats, double *epsilon)
+{
+    SearchTimer timer(stats);
+    AnytimeSearch search(grid, start, goal);
+    const auto started = std::chrono::steady_clock::now();
+    while (!search.isFinished()) {
+        SearchBudget remaining;
+        if (budget.maxNs > 0) {
+            const long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - started).count();
+            remaining.maxNs = budget.maxNs - elapsed;
+            if (remaining.maxNs <= 0)
+                break;
+        }
+        if (budget.maxExpansions > 0) {
+            remaining.maxExpansions = budget.maxExpansions - search.expansions();
+            if (remaining.maxExpansions <= 0)
+                break;
+        }
+        if (!search.improve(remaining, stats) && !search.isFinished())
+            break;
+    }
+    if (epsilon != nullptr)
+        *epsilon = search.epsilon();
+    return search.path();
+}
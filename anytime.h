@@ -0,0 +1,98 @@
+#pragma once
+
+#include "compactpath.h"
+#include "pathfinding.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Ограничение работы поиска за один вызов.
+ *
+ * Нулевое значение поля означает отсутствие соответствующего ограничения.
+ */
+struct SearchBudget {
+    long long maxExpansions {0};    /**< Наибольшее количество раскрытий. */
+    long long maxNs {0};            /**< Наибольшее время в наносекундах. */
+};
+
+/**
+ * @brief Поиск пути с уточнением (ARA*, Anytime Repairing A*).
+ *
+ * Взвешенный A* с ключом g + epsilon * h быстро находит путь, длина которого не более
+ * чем в epsilon раз превышает кратчайшую. Затем epsilon уменьшается, и поиск
+ * продолжается с сохраненными стоимостями: заново раскрываются только ячейки, стоимость
+ * которых уменьшилась (открытые и несогласованные), поэтому каждое следующее уточнение
+ * дешевле нового поиска. При epsilon = 1 найденный путь кратчайший.
+ *
+ * Поиск выполняется частями в пределах заданного бюджета и может быть продолжен
+ * следующим вызовом improve(). Сетка должна существовать, пока существует объект.
+ */
+class AnytimeSearch
+{
+public:
+    AnytimeSearch(const Grid &grid, const Node &start, const Node &goal, double initialEpsilon = 3.0,
+                  double epsilonStep = 0.5);
+
+    bool improve(const SearchBudget &budget = SearchBudget(), SearchStats *stats = nullptr);
+
+    const CompactPath &path() const { return m_path; }      /**< Лучший найденный путь (пустой, если пути еще нет). */
+    double epsilon() const { return m_pathEpsilon; }        /**< Во сколько раз путь может быть длиннее кратчайшего. */
+    bool isFinished() const { return m_finished; }          /**< Путь кратчайший или цель недостижима. */
+    long long expansions() const { return m_expansions; }   /**< Раскрытия во всех вызовах improve(). */
+
+private:
+    /**
+     * @brief Элемент открытого списка.
+     */
+    struct OpenEntry {
+        double key;     /**< g + epsilon * h на момент добавления. */
+        int g;          /**< Стоимость на момент добавления (для отбрасывания устаревших копий). */
+        int cell;       /**< Индекс ячейки (y * width + x). */
+        bool operator<(const OpenEntry &o) const { return key > o.key || (key == o.key && g < o.g); }
+    };
+
+    const Grid &m_grid;             /**< Сетка препятствий. */
+    Node m_start;                   /**< Начальная ячейка. */
+    Node m_goal;                    /**< Конечная ячейка. */
+    int m_goalCell;                 /**< Индекс конечной ячейки. */
+    double m_epsilon;               /**< Вес эвристики текущей итерации. */
+    double m_epsilonStep;           /**< Уменьшение веса между итерациями. */
+    uint16_t m_iteration {1};       /**< Номер итерации (для отметок закрытых ячеек). */
+    bool m_finished {false};        /**< Поиск завершен. */
+    CompactPath m_path;             /**< Лучший найденный путь. */
+    double m_pathEpsilon {0};       /**< Оценка субоптимальности лучшего пути. */
+    long long m_expansions {0};     /**< Раскрытия во всех вызовах improve(). */
+
+    std::vector<int> m_g;               /**< Стоимости ячеек. */
+    std::vector<uint8_t> m_cameFrom;    /**< Направления шагов, которыми пришли в ячейки. */
+    std::vector<uint16_t> m_closed;     /**< Итерация, в которой ячейка закрыта. */
+    std::vector<uint16_t> m_listed;     /**< Итерация, в которой ячейка добавлена в список несогласованных. */
+    std::vector<OpenEntry> m_open;      /**< Открытый список (куча). */
+    std::vector<int> m_incons;          /**< Закрытые ячейки, стоимость которых уменьшилась. */
+
+    int heuristic(int cell) const;
+    double key(int cell) const { return m_g[cell] + m_epsilon * heuristic(cell); }
+    bool improvePath(const SearchBudget &budget, long long expansionsBefore,
+                     std::chrono::steady_clock::time_point started, SearchStats *stats);
+    void publishPath();
+    void nextIteration();
+};
+
+/**
+ * @brief Поиск пути с уточнением в пределах бюджета.
+ *
+ * Выполняет AnytimeSearch до получения кратчайшего пути или исчерпания бюджета.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param budget Ограничение работы (по умолчанию - без ограничения, результат кратчайший).
+ * @param stats Статистика поиска (может быть nullptr).
+ * @param epsilon Оценка субоптимальности результата (может быть nullptr).
+ * @return Лучший путь, найденный в пределах бюджета; пустой, если путь не найден.
+ */
+CompactPath ara_star_search(const Grid &grid, const Node &start, const Node &goal,
+                            const SearchBudget &budget = SearchBudget(), SearchStats *stats = nullptr,
+                            double *epsilon = nullptr);
@@ -0,0 +1,13 @@
+QT -= core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+
+TARGET = findPathBench
+
+unix: LIBS += -lpthread
+
+SOURCES += \
+    main.cpp
+
+include(../search.pri)
@@ -0,0 +1,640 @@
+#include "anyangle.h"
+#include "anytime.h"
+#include "compactpath.h"
+#include "firstmove.h"
+#include "mapgen.h"
+#include "pathfinding.h"
+#include "searcharena.h"
+#include "sssp.h"
+#include "tiledgrid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Подсчет выделений памяти: глобальные operator new/delete (включая варианты с выравниванием,
+// через которые работают стандартные ресурсы std::pmr) заменяются обертками, которые хранят
+// размер блока и адрес выделенной памяти в заголовке и ведут счетчики вызовов и текущего объема.
+namespace {
+
+std::atomic<long long> g_allocations {0};
+std::atomic<long long> g_liveBytes {0};
+std::atomic<long long> g_peakBytes {0};
+
+constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+void *trackedAlloc(size_t size, size_t alignment = HeaderSize)
+{
+    alignment = std::max(alignment, HeaderSize);
+    char *block = static_cast<char *>(std::malloc(size + HeaderSize + alignment));
+    if (block == nullptr)
+        return nullptr;
+    const uintptr_t address = reinterpret_cast<uintptr_t>(block) + HeaderSize;
+    char *ptr = block + ((address + alignment - 1) & ~uintptr_t(alignment - 1)) - reinterpret_cast<uintptr_t>(block);
+    reinterpret_cast<size_t *>(ptr)[-1] = size;
+    reinterpret_cast<char **>(ptr)[-2] = block;
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    long long live = g_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    long long peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return ptr;
+}
+
+void trackedFree(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+    g_liveBytes.fetch_sub(static_cast<long long>(static_cast<size_t *>(ptr)[-1]), std::memory_order_relaxed);
+    std::free(static_cast<char **>(ptr)[-2]);
+}
+
+}
+
+void *operator new(size_t size)
+{
+    if (void *ptr = trackedAlloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return trackedAlloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return trackedAlloc(size); }
+void operator delete(void *ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { trackedFree(ptr); }
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    if (void *ptr = trackedAlloc(size, size_t(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return trackedAlloc(size, size_t(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return trackedAlloc(size, size_t(alignment)); }
+void operator delete(void *ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+
+namespace {
+
+/**
+ * @brief Сценарий бенчмарка: карта и набор запросов к ней.
+ */
+struct Scenario {
+    std::string name;               /**< Имя сценария (семейство/размер). */
+    std::string family;             /**< Семейство карт. */
+    int size {0};                   /**< Размер стороны карты. */
+    std::function<Grid()> makeGrid; /**< Генератор карты. */
+    bool unreachable {false};       /**< Запросы через разделяющую стену. */
+};
+
+/**
+ * @brief Измеренные показатели сценария.
+ */
+struct Measurement {
+    int queries {0};                /**< Количество запросов. */
+    int found {0};                  /**< Количество найденных путей. */
+    double nsPerQuery {0};          /**< Среднее время запроса. */
+    double expansionsPerQuery {0};  /**< Среднее количество раскрытых узлов. */
+    double allocationsPerQuery {0}; /**< Среднее количество выделений памяти. */
+    long long peakBytes {0};        /**< Максимальный объем рабочей памяти одного запроса. */
+    double pathBytes {0};           /**< Средний размер компактного пути. */
+    double nodePathBytes {0};       /**< Средний размер того же пути в виде вектора узлов. */
+    double waypoints {0};           /**< Среднее количество опорных точек пути под любыми углами. */
+    double steps {0};               /**< Средняя длина найденного пути в шагах. */
+    double threadedNsPerQuery {0};  /**< Среднее время запроса при многопоточном прогоне (на весь пул). */
+};
+
+/**
+ * @brief Параметры запуска.
+ */
+struct Options {
+    std::vector<int> sizes {64, 256, 1024, 4096};   /**< Размеры карт. */
+    std::string filter;                             /**< Подстрока имени сценария. */
+    std::string jsonPath;                           /**< Файл для вывода JSON. */
+    std::string engine {"astar"};                   /**< Алгоритм: astar, theta или ara. */
+    int repetitions {3};                            /**< Количество повторов каждого сценария. */
+    int queries {0};                                /**< Запросов на сценарий (0 - по размеру карты). */
+    int threads {1};                                /**< Потоков в многопоточном прогоне (1 - без него). */
+    long long budget {0};                           /**< Бюджет раскрытий ARA* на запрос (0 - до кратчайшего пути). */
+    std::string tiledPath;                          /**< Файл плиточной сетки (пусто - обычные сценарии). */
+    int tiledSize {100000};                         /**< Сторона карты, создаваемой в файле плиточной сетки. */
+    int cacheTiles {256};                           /**< Емкость кэша плиток. */
+    bool arena {true};                              /**< Размещать состояние поиска в арене потока. */
+    bool firstMoves {false};                        /**< Измерять таблицы первых ходов вместо поиска. */
+    bool distances {false};                         /**< Измерять расстояния от одной ячейки вместо поиска. */
+    int delta {0};                                  /**< Ширина корзины дельта-шагов (0 - по умолчанию). */
+    uint64_t seed {20240601};                       /**< Начальное значение генераторов. */
+};
+
+void usage(const char *program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--sizes 64,256,...] [--filter substr] [--repetitions N]\n"
+                 "          [--queries N] [--seed N] [--threads N] [--no-arena] [--engine astar|theta|ara]\n"
+                 "          [--budget N] [--json file]\n"
+                 "       %s --tiled file [--tiled-size N] [--cache-tiles N] [--queries N] [--seed N]\n"
+                 "       %s --cpd [--sizes 64,256] [--filter substr] [--queries N] [--threads N] [--seed N]\n"
+                 "       %s --sssp [--sizes 1024,4096] [--threads N] [--delta N] [--repetitions N] [--seed N]\n",
+                 program, program, program, program);
+}
+
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *v = nullptr;
+        if (arg == "--sizes" && (v = value())) {
+            options.sizes.clear();
+            for (const char *p = v; *p; ) {
+                options.sizes.push_back(std::atoi(p));
+                p = std::strchr(p, ',');
+                if (p == nullptr)
+                    break;
+                ++p;
+            }
+        } else if (arg == "--filter" && (v = value())) {
+            options.filter = v;
+        } else if (arg == "--repetitions" && (v = value())) {
+            options.repetitions = std::max(1, std::atoi(v));
+        } else if (arg == "--queries" && (v = value())) {
+            options.queries = std::max(1, std::atoi(v));
+        } else if (arg == "--seed" && (v = value())) {
+            options.seed = std::strtoull(v, nullptr, 10);
+        } else if (arg == "--threads" && (v = value())) {
+            options.threads = std::max(1, std::atoi(v));
+        } else if (arg == "--engine" && (v = value())
+                   && (std::strcmp(v, "astar") == 0 || std::strcmp(v, "theta") == 0 || std::strcmp(v, "ara") == 0)) {
+            options.engine = v;
+        } else if (arg == "--budget" && (v = value())) {
+            options.budget = std::max(0ll, std::atoll(v));
+        } else if (arg == "--tiled" && (v = value())) {
+            options.tiledPath = v;
+        } else if (arg == "--tiled-size" && (v = value())) {
+            options.tiledSize = std::max(1, std::atoi(v));
+        } else if (arg == "--cache-tiles" && (v = value())) {
+            options.cacheTiles = std::max(1, std::atoi(v));
+        } else if (arg == "--cpd") {
+            options.firstMoves = true;
+        } else if (arg == "--sssp") {
+            options.distances = true;
+        } else if (arg == "--delta" && (v = value())) {
+            options.delta = std::max(0, std::atoi(v));
+        } else if (arg == "--no-arena") {
+            options.arena = false;
+        } else if (arg == "--json" && (v = value())) {
+            options.jsonPath = v;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Scenario> makeScenarios(const Options &options)
+{
+    std::vector<Scenario> scenarios;
+    for (int size : options.sizes) {
+        if (size <= 2)
+            continue;
+        const uint64_t seed = options.seed + uint64_t(size);
+        auto add = [&](const std::string &family, std::function<Grid()> make, bool unreachable = false) {
+            scenarios.push_back({family + "/" + std::to_string(size), family, size, std::move(make), unreachable});
+        };
+        add("random20", [=] { return MapGen::randomGrid(size, size, 0.2, seed); });
+        add("random30", [=] { return MapGen::randomGrid(size, size, 0.3, seed); });
+        add("random40", [=] { return MapGen::randomGrid(size, size, 0.4, seed); });
+        add("maze", [=] { return MapGen::mazeGrid(size, size, seed); });
+        add("open", [=] { return MapGen::randomGrid(size, size, 0.0, seed); });
+        add("unreachable", [=] { return MapGen::splitGrid(size, size, 0.2, seed); }, true);
+    }
+    return scenarios;
+}
+
+/**
+ * @brief Прогон сценария.
+ *
+ * Каждый запрос решается repetitions раз; время усредняется по всем прогонам, а
+ * выделения памяти и пиковый объем рабочей памяти считаются по первому прогону.
+ * Рабочая память - большее из прироста кучи и объема, выданного ареной поиска
+ * (арена переиспользует блоки, и после первых запросов куча не растет).
+ *
+ * Для A* количество опорных точек считается по спрямленному пути (pullString(),
+ * вне замера времени), для Theta* - по его результату; размер пути Theta* - размер
+ * вектора опорных точек.
+ *
+ * При threads > 1 те же запросы дополнительно решаются пулом потоков (запросы
+ * распределяются по потокам через общий счетчик) для оценки масштабируемости.
+ */
+Measurement run(const Scenario &scenario, const Options &options)
+{
+    const Grid grid = scenario.makeGrid();
+    const int count = options.queries > 0 ? options.queries : std::max(4, 16384 / scenario.size);
+    const uint64_t seed = options.seed ^ uint64_t(scenario.size) << 32;
+    const std::vector<Query> queries = scenario.unreachable ? MapGen::splitQueries(grid, count, seed)
+                                                            : MapGen::randomQueries(grid, count, seed);
+
+    Measurement m;
+    m.queries = int(queries.size());
+    if (queries.empty())
+        return m;
+
+    const bool theta = options.engine == "theta";
+    const bool ara = options.engine == "ara";
+    const SearchBudget budget {options.budget, 0};
+    long long expansions = 0;
+    long long allocations = 0;
+    std::chrono::nanoseconds elapsed {0};
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        for (const Query &query : queries) {
+            SearchStats stats;
+            const long long allocationsBefore = g_allocations.load();
+            const long long liveBefore = g_liveBytes.load();
+            g_peakBytes.store(liveBefore);
+
+            const auto begin = std::chrono::steady_clock::now();
+            CompactPath path;
+            std::vector<Node> waypoints;
+            if (theta)
+                waypoints = theta_star_search(grid, query.start, query.goal, &stats);
+            else if (ara)
+                path = ara_star_search(grid, query.start, query.goal, budget, &stats);
+            else
+                path = a_star_search_compact(grid, query.start, query.goal, &stats);
+            elapsed += std::chrono::steady_clock::now() - begin;
+
+            if (rep == 0) {
+                allocations += g_allocations.load() - allocationsBefore;
+                m.peakBytes = std::max({m.peakBytes, g_peakBytes.load() - liveBefore, stats.peakMemoryBytes});
+                expansions += stats.expansions;
+                if (!theta)
+                    waypoints = pullString(grid, path);
+                m.found += !waypoints.empty();
+                m.waypoints += double(waypoints.size());
+                m.steps += theta ? waypointLength(waypoints) : double(path.steps());
+                m.pathBytes += theta ? double(sizeof(waypoints) + waypoints.size() * sizeof(Node))
+                                     : double(path.memoryBytes());
+                m.nodePathBytes += double(sizeof(std::vector<Node>) + path.size() * sizeof(Node));
+            }
+        }
+    }
+
+    const double total = double(queries.size());
+    if (options.threads > 1) {
+        std::atomic<size_t> next {0};
+        const size_t jobs = queries.size() * size_t(options.repetitions);
+        const auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < options.threads; ++t) {
+            threads.emplace_back([&] {
+                for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < jobs; ) {
+                    const Query &query = queries[i % queries.size()];
+                    if (theta)
+                        theta_star_search(grid, query.start, query.goal);
+                    else if (ara)
+                        ara_star_search(grid, query.start, query.goal, budget);
+                    else
+                        a_star_search_compact(grid, query.start, query.goal);
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        const std::chrono::nanoseconds threadedElapsed = std::chrono::steady_clock::now() - begin;
+        m.threadedNsPerQuery = double(threadedElapsed.count()) / double(jobs);
+    }
+    m.nsPerQuery = double(elapsed.count()) / (total * options.repetitions);
+    m.expansionsPerQuery = double(expansions) / total;
+    m.allocationsPerQuery = double(allocations) / total;
+    m.pathBytes /= total;
+    m.nodePathBytes /= total;
+    m.waypoints /= total;
+    m.steps /= total;
+    return m;
+}
+
+/**
+ * @brief Отказы страниц процесса: с чтением с диска (major) и без него (minor).
+ */
+std::pair<long long, long long> pageFaults()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return {usage.ru_majflt, usage.ru_minflt};
+#endif
+    return {0, 0};
+}
+
+long long maxResidentBytes()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return usage.ru_maxrss;
+#else
+        return usage.ru_maxrss * 1024ll;
+#endif
+    }
+#endif
+    return 0;
+}
+
+const int TiledQueryRange = 4096;   // наибольшее смещение цели от начала в запросах на плиточной сетке
+const int FirstMoveMaxSize = 512;   // наибольшая сторона карты для таблицы первых ходов (построение O(N^2))
+
+/**
+ * @brief Прогон запросов на сетке во внешней памяти.
+ *
+ * Если файл не существует, в него записывается случайная карта tiledSize x tiledSize
+ * с плотностью 20% (без построения ее в памяти). Запросы - пары случайных свободных ячеек
+ * на расстоянии до TiledQueryRange по каждой оси (поиск через всю карту 100k x 100k
+ * раскрывает сотни миллионов узлов, и время определяется им, а не плитками), поэтому
+ * начала запросов разбросаны по всей карте, а каждый поиск охватывает ее малую часть.
+ * Для каждого запроса выводятся время, раскрытия, длина пути, счетчики кэша плиток и
+ * отказы страниц процесса (при отображении файла чтение с диска происходит именно при
+ * отказе), в конце - итоги и максимальный резидентный объем процесса.
+ */
+int runTiled(const Options &options)
+{
+    TiledGrid grid;
+    std::string error;
+    if (!grid.open(options.tiledPath, size_t(options.cacheTiles))) {
+        std::printf("Creating %s (%dx%d)...\n", options.tiledPath.c_str(), options.tiledSize, options.tiledSize);
+        std::fflush(stdout);
+        if (!TiledGrid::createRandom(options.tiledPath, options.tiledSize, options.tiledSize, 0.2, options.seed, &error)
+            || !grid.open(options.tiledPath, size_t(options.cacheTiles), &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    SplitMix64 rng(options.seed ^ 0x7469);
+    auto freeCell = [&](int x0, int y0, int range) {
+        for (;;) {
+            const Node node {x0 - range + rng.bounded(2 * range + 1), y0 - range + rng.bounded(2 * range + 1)};
+            if (grid.isFree(node.x, node.y))
+                return node;
+        }
+    };
+    std::vector<Query> queries;
+    for (int i = 0; i < (options.queries > 0 ? options.queries : 8); ++i) {
+        const Node start = freeCell(grid.width() / 2, grid.height() / 2, std::max(grid.width(), grid.height()));
+        queries.push_back({start, freeCell(start.x, start.y, TiledQueryRange)});
+    }
+
+    std::printf("%dx%d, cache %d tiles (%.1f MB), goals within %d cells of the start on each axis\n", grid.width(),
+                grid.height(), options.cacheTiles, double(options.cacheTiles) * TiledGrid::TileBytes / (1 << 20),
+                TiledQueryRange);
+    std::printf("%8s %14s %14s %10s %14s %10s %10s %10s %10s %10s %10s\n", "query", "ms", "expansions", "steps",
+                "state bytes", "hit rate", "misses", "evictions", "prefetches", "majflt", "minflt");
+    TiledGrid::Counters total;
+    const std::pair<long long, long long> faultsBefore = pageFaults();
+    for (size_t i = 0; i < queries.size(); ++i) {
+        grid.resetCounters();
+        SearchStats stats;
+        const std::pair<long long, long long> before = pageFaults();
+        const CompactPath path = tiled_a_star_search(grid, queries[i].start, queries[i].goal, &stats);
+        const std::pair<long long, long long> after = pageFaults();
+        const TiledGrid::Counters &c = grid.counters();
+        std::printf("%8zu %14.1f %14lld %10zu %14lld %9.4f%% %10lld %10lld %10lld %10lld %10lld\n", i,
+                    stats.elapsedNs / 1e6, stats.expansions, path.empty() ? size_t(0) : path.steps(),
+                    stats.peakMemoryBytes, 100.0 * c.hitRate(), c.misses, c.evictions, c.prefetches,
+                    after.first - before.first, after.second - before.second);
+        std::fflush(stdout);
+        total.hits += c.hits;
+        total.misses += c.misses;
+        total.evictions += c.evictions;
+        total.prefetches += c.prefetches;
+    }
+    const std::pair<long long, long long> faultsAfter = pageFaults();
+    std::printf("hit rate %.4f%%, misses %lld, evictions %lld, prefetches %lld, page faults %lld major / %lld minor, "
+                "resident tiles %zu, max RSS %lld bytes\n",
+                100.0 * total.hitRate(), total.misses, total.evictions, total.prefetches,
+                faultsAfter.first - faultsBefore.first, faultsAfter.second - faultsBefore.second, grid.residentTiles(),
+                maxResidentBytes());
+    return 0;
+}
+
+
+/**
+ * @brief Измерение таблиц первых ходов (--cpd).
+ *
+ * Для каждого сценария со стороной не больше FirstMoveMaxSize строится таблица (на
+ * --threads потоках, по умолчанию на всех ядрах) и выводятся время построения, количество
+ * серий, размер записи и среднее время извлечения пути из таблицы в сравнении с A* на тех
+ * же запросах.
+ */
+int runFirstMoves(const Options &options)
+{
+    std::printf("%-20s %10s %12s %10s %14s %14s %14s %10s\n", "scenario", "build s", "runs", "runs/cell",
+                "bytes", "ns/query cpd", "ns/query A*", "speedup");
+    for (const Scenario &scenario : makeScenarios(options)) {
+        if (scenario.size > FirstMoveMaxSize
+            || (!options.filter.empty() && scenario.name.find(options.filter) == std::string::npos))
+            continue;
+
+        const Grid grid = scenario.makeGrid();
+        const int count = options.queries > 0 ? options.queries : std::max(4, 16384 / scenario.size);
+        const uint64_t seed = options.seed ^ uint64_t(scenario.size) << 32;
+        const std::vector<Query> queries = scenario.unreachable ? MapGen::splitQueries(grid, count, seed)
+                                                                : MapGen::randomQueries(grid, count, seed);
+
+        const auto begin = std::chrono::steady_clock::now();
+        const FirstMoveTable table = FirstMoveTable::build(grid, options.threads > 1 ? options.threads : 0);
+        const double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        auto measure = [&](const std::function<CompactPath(const Query &)> &solve) {
+            size_t steps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < options.repetitions; ++r) {
+                for (const Query &query : queries)
+                    steps += solve(query).steps();
+            }
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            return std::make_pair(ns / (double(queries.size()) * options.repetitions), steps);
+        };
+        const auto cpd = measure([&](const Query &q) { return table.path(q.start, q.goal); });
+        const auto astar = measure([&](const Query &q) { return a_star_search_compact(grid, q.start, q.goal); });
+        if (cpd.second != astar.second)
+            std::fprintf(stderr, "%s: path lengths differ from A*\n", scenario.name.c_str());
+
+        std::printf("%-20s %10.2f %12zu %10.2f %14zu %14.0f %14.0f %10.1f\n", scenario.name.c_str(), buildSeconds,
+                    table.runCount(), double(table.runCount()) / double(grid.cellCount()), table.serialize().size(),
+                    cpd.first, astar.first, cpd.first > 0 ? astar.first / cpd.first : 0.0);
+        std::fflush(stdout);
+    }
+    return 0;
+}
+
+/**
+ * @brief Измерение расстояний от одной ячейки (--sssp).
+ *
+ * Для каждого размера строится карта местности со стоимостями 1..255 и 20% препятствий,
+ * и от ее центра (или ближайшей свободной ячейки) вычисляются расстояния до всех ячеек:
+ * алгоритмом Дейкстры и дельта-шагами на 1, 2, 4, ... --threads потоках. Выводятся
+ * лучшее из --repetitions время, ускорение относительно одного потока и относительно
+ * Дейкстры; результаты дельта-шагов сверяются с Дейкстрой.
+ */
+int runDistances(const Options &options)
+{
+    std::printf("%-12s %-16s %8s %12s %14s %10s %10s\n", "size", "engine", "threads", "ms", "relaxations",
+                "scaling", "vs dijkstra");
+    for (int size : options.sizes) {
+        const Grid grid = MapGen::terrainGrid(size, size, 0.2, 255, options.seed + uint64_t(size));
+        Node source {size / 2, size / 2};
+        while (source.x + 1 < size && !grid.isFree(source.x, source.y))
+            ++source.x;
+
+        auto measure = [&](const std::function<DistanceMap(SearchStats *)> &compute, DistanceMap &result,
+                           long long &relaxations) {
+            double best = 0;
+            for (int r = 0; r < options.repetitions; ++r) {
+                SearchStats stats;
+                const auto begin = std::chrono::steady_clock::now();
+                result = compute(&stats);
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                best = r == 0 ? ms : std::min(best, ms);
+                relaxations = stats.expansions;
+            }
+            return best;
+        };
+
+        const std::string name = std::to_string(size) + "x" + std::to_string(size);
+        DistanceMap reference;
+        long long relaxations = 0;
+        const double dijkstraMs = measure([&](SearchStats *stats) { return dijkstra_distances(grid, source, stats); },
+                                          reference, relaxations);
+        std::printf("%-12s %-16s %8d %12.1f %14lld %10s %10.2f\n", name.c_str(), "dijkstra", 1, dijkstraMs,
+                    relaxations, "-", 1.0);
+        std::fflush(stdout);
+
+        double singleMs = 0;
+        for (int threads = 1; ; threads = std::min(threads * 2, options.threads)) {
+            DistanceMap result;
+            const double ms = measure([&](SearchStats *stats) {
+                return delta_stepping_distances(grid, source, threads, uint32_t(options.delta), stats);
+            }, result, relaxations);
+            if (threads == 1)
+                singleMs = ms;
+            std::printf("%-12s %-16s %8d %12.1f %14lld %10.2f %10.2f\n", name.c_str(), "delta_stepping", threads, ms,
+                        relaxations, ms > 0 ? singleMs / ms : 0.0, ms > 0 ? dijkstraMs / ms : 0.0);
+            std::fflush(stdout);
+            if (result.distances != reference.distances || result.tree.directions != reference.tree.directions)
+                std::fprintf(stderr, "%s: delta stepping differs from Dijkstra\n", name.c_str());
+            if (threads >= options.threads)
+                break;
+        }
+    }
+    return 0;
+}
+}
+
+/**
+ * @brief Точка входа набора микробенчмарков ядра поиска.
+ *
+ * Генерирует воспроизводимые по seed карты (случайные с плотностью 20/30/40%,
+ * лабиринты, открытые поля, карты с недостижимыми целями) заданных размеров,
+ * измеряет время, количество раскрытых узлов, выделений памяти и пиковый объем кучи
+ * на запрос, а также количество опорных точек спрямленного пути. --engine theta заменяет
+ * A* на Lazy Theta*, --engine ara - на ARA* с бюджетом --budget раскрытий на запрос
+ * (столбец steps показывает, насколько путь в пределах бюджета длиннее кратчайшего).
+ * С --threads N дополнительно измеряется пропускная способность пула из N потоков
+ * и ускорение относительно одного потока; --no-arena отключает арены поиска для сравнения.
+ * --tiled file вместо сценариев измеряет поиск на сетке во внешней памяти (TiledGrid),
+ * --cpd - построение таблиц первых ходов и извлечение путей из них (FirstMoveTable),
+ * --sssp - расстояния от одной ячейки до всех (Дейкстра и параллельные дельта-шаги).
+ * Результаты печатаются таблицей и, при указании --json, сохраняются в JSON.
+ *
+ * @param argc Количество аргументов командной строки.
+ * @param argv Массив строковых аргументов командной строки.
+ * @return Код завершения.
+ */
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    SearchArena::setEnabled(options.arena);
+    if (!options.tiledPath.empty())
+        return runTiled(options);
+    if (options.firstMoves)
+        return runFirstMoves(options);
+    if (options.distances)
+        return runDistances(options);
+
+    std::string json = "{\n  \"context\": {\"seed\": " + std::to_string(options.seed)
+                       + ", \"repetitions\": " + std::to_string(options.repetitions)
+                       + ", \"threads\": " + std::to_string(options.threads)
+                       + ", \"arena\": " + (options.arena ? "true" : "false")
+                       + ", \"engine\": \"" + options.engine + "\""
+                       + ", \"budget\": " + std::to_string(options.budget) + "},\n  \"benchmarks\": [";
+    bool first = true;
+
+    std::printf("%-20s %8s %8s %14s %14s %12s %14s %12s %10s %10s",
+                "scenario", "queries", "found", "ns/query", "expansions/q", "allocs/q", "peak bytes", "path bytes",
+                "waypoints", "steps");
+    if (options.threads > 1)
+        std::printf(" %14s %8s", "ns/query@N", "scaling");
+    std::printf("\n");
+    for (const Scenario &scenario : makeScenarios(options)) {
+        if (!options.filter.empty() && scenario.name.find(options.filter) == std::string::npos)
+            continue;
+
+        const Measurement m = run(scenario, options);
+        const double scaling = m.threadedNsPerQuery > 0 ? m.nsPerQuery / m.threadedNsPerQuery : 1.0;
+        std::printf("%-20s %8d %8d %14.0f %14.1f %12.1f %14lld %12.0f %10.1f %10.1f", scenario.name.c_str(),
+                    m.queries, m.found, m.nsPerQuery, m.expansionsPerQuery, m.allocationsPerQuery, m.peakBytes,
+                    m.pathBytes, m.waypoints, m.steps);
+        if (options.threads > 1)
+            std::printf(" %14.0f %8.2f", m.threadedNsPerQuery, scaling);
+        std::printf("\n");
+        std::fflush(stdout);
+
+        char entry[512];
+        std::snprintf(entry, sizeof(entry),
+                      "%s\n    {\"name\": \"%s\", \"family\": \"%s\", \"size\": %d, \"queries\": %d, \"found\": %d, "
+                      "\"ns_per_query\": %.1f, \"expansions_per_query\": %.1f, \"allocations_per_query\": %.1f, "
+                      "\"peak_bytes\": %lld, \"path_bytes\": %.1f, \"node_path_bytes\": %.1f, \"waypoints\": %.1f, \"steps\": %.1f, "
+                      "\"threaded_ns_per_query\": %.1f, \"scaling\": %.2f}",
+                      first ? "" : ",", scenario.name.c_str(), scenario.family.c_str(), scenario.size, m.queries,
+                      m.found, m.nsPerQuery, m.expansionsPerQuery, m.allocationsPerQuery, m.peakBytes, m.pathBytes,
+                      m.nodePathBytes, m.waypoints, m.steps, m.threadedNsPerQuery, scaling);
+        json += entry;
+        first = false;
+    }
+    json += "\n  ],\n  \"max_rss_bytes\": " + std::to_string(maxResidentBytes()) + "\n}\n";
+
+    if (!options.jsonPath.empty()) {
+        FILE *file = std::fopen(options.jsonPath.c_str(), "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "Cannot open %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+        std::fputs(json.c_str(), file);
+        std::fclose(file);
+    }
+    return 0;
+}
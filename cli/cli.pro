@@ -0,0 +1,19 @@
+QT = core concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = findPathCli
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../console.h
+
+include(../core.pri)
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,356 @@
+#include "anyangle.h"
+#include "compactpath.h"
+#include "console.h"
+#include "firstmove.h"
+#include "mapformat.h"
+#include "pathfinding.h"
+#include "trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QtEndian>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const int ChunkSize = 4096; // количество запросов, решаемых параллельно за один проход
+
+/**
+ * @brief Результат решения одного запроса.
+ */
+struct QueryResult {
+    int index {0};              /**< Номер запроса. */
+    Query query;                /**< Сам запрос. */
+    int length {-1};            /**< Длина пути в шагах, -1 если путь не найден. */
+    long long expansions {0};   /**< Количество раскрытых узлов. */
+    qint64 latencyNs {0};       /**< Время решения запроса в наносекундах. */
+    CompactPath path;           /**< Найденный путь (сохраняется, только если нужен в выводе). */
+    std::vector<Node> waypoints;    /**< Опорные точки спрямленного пути (при выводе опорных точек). */
+};
+
+using Console::tr;
+
+/**
+ * @brief Решение одного запроса с замером времени.
+ *
+ * @param grid Сетка препятствий.
+ * @param result Результат, в котором уже заполнены номер и запрос.
+ * @param keepPath Сохранять ли найденный путь в результате.
+ * @param waypoints Спрямлять ли путь до опорных точек (pullString(); не входит в замер времени).
+ * @param table Таблица первых ходов: путь извлекается из нее без поиска (nullptr - поиск A*).
+ */
+void solve(const Grid &grid, QueryResult &result, bool keepPath, bool waypoints, const FirstMoveTable *table)
+{
+    Trace::QueryScope traceQuery(uint64_t(result.index) + 1);
+    Trace::Scope trace("solve");
+    const Query &query = result.query;
+    if (!grid.isFree(query.start.x, query.start.y) || !grid.isFree(query.goal.x, query.goal.y))
+        return;
+
+    SearchStats stats;
+    const auto begin = std::chrono::steady_clock::now();
+    CompactPath path = table != nullptr ? table->path(query.start, query.goal)
+                                        : a_star_search_compact(grid, query.start, query.goal, &stats);
+    const auto end = std::chrono::steady_clock::now();
+
+    result.length = path.empty() ? -1 : int(path.steps());
+    result.expansions = stats.expansions;
+    result.latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    if (keepPath && waypoints)
+        result.waypoints = pullString(grid, path);
+    else if (keepPath)
+        result.path = std::move(path);
+}
+
+/**
+ * @brief Загрузка списка запросов из сценария MovingAI (.scen) или файла карты findPath.
+ */
+bool loadQueries(const QString &path, std::vector<Query> &queries, QString *error)
+{
+    if (QFileInfo(path).suffix() == "scen")
+        return MapFormat::importMovingAiScenario(path, queries, error);
+
+    MapData map;
+    if (!MapFormat::load(path, map, error))
+        return false;
+    queries = map.queries;
+    return true;
+}
+
+/**
+ * @brief Запись результатов в формате CSV или в двоичном формате.
+ *
+ * Двоичный формат: магическое число "FPRS", версия (uint32), количество записей (uint64),
+ * затем записи по 40 байт: номер, sx, sy, gx, gy, длина (int32), раскрытия и время в
+ * наносекундах (int64). Все числа в порядке little-endian.
+ *
+ * При выводе путей в CSV добавляется столбец path - строка направлений шагов (R, D, L, U),
+ * а в двоичном формате за каждой записью следуют упакованные 2-битные коды шагов
+ * ((length + 3) / 4 байт, коды CompactPath::Direction, младшие биты - первый шаг).
+ *
+ * При выводе опорных точек спрямленного пути столбец path содержит точки "x:y",
+ * разделенные ';', а в двоичном формате (версия 2) за каждой записью следуют количество
+ * точек (uint32) и сами точки (x, y - int32).
+ */
+class ResultWriter
+{
+public:
+    ResultWriter(QIODevice *device, bool binary, bool paths, bool waypoints)
+        : m_device(device), m_binary(binary), m_paths(paths), m_waypoints(paths && waypoints) {}
+
+    void writeHeader(quint64 count)
+    {
+        if (m_binary) {
+            char header[16] = {'F', 'P', 'R', 'S'};
+            qToLittleEndian<quint32>(m_waypoints ? 2 : 1, header + 4);
+            qToLittleEndian<quint64>(count, header + 8);
+            m_device->write(header, sizeof(header));
+        } else {
+            m_device->write(m_paths ? "index,sx,sy,gx,gy,length,expansions,latency_ns,path\n"
+                                    : "index,sx,sy,gx,gy,length,expansions,latency_ns\n");
+        }
+    }
+
+    void write(const QueryResult &r)
+    {
+        if (m_binary) {
+            char record[40];
+            qToLittleEndian<qint32>(r.index, record);
+            qToLittleEndian<qint32>(r.query.start.x, record + 4);
+            qToLittleEndian<qint32>(r.query.start.y, record + 8);
+            qToLittleEndian<qint32>(r.query.goal.x, record + 12);
+            qToLittleEndian<qint32>(r.query.goal.y, record + 16);
+            qToLittleEndian<qint32>(r.length, record + 20);
+            qToLittleEndian<qint64>(r.expansions, record + 24);
+            qToLittleEndian<qint64>(r.latencyNs, record + 32);
+            m_device->write(record, sizeof(record));
+            if (m_waypoints) {
+                QByteArray points(4 + int(r.waypoints.size()) * 8, Qt::Uninitialized);
+                qToLittleEndian<quint32>(quint32(r.waypoints.size()), points.data());
+                for (size_t i = 0; i < r.waypoints.size(); ++i) {
+                    qToLittleEndian<qint32>(r.waypoints[i].x, points.data() + 4 + i * 8);
+                    qToLittleEndian<qint32>(r.waypoints[i].y, points.data() + 8 + i * 8);
+                }
+                m_device->write(points);
+            } else if (m_paths && !r.path.empty())
+                m_device->write(reinterpret_cast<const char *>(r.path.codes().data()), qint64(r.path.codes().size()));
+        } else {
+            QByteArray line = QString("%1,%2,%3,%4,%5,%6,%7,%8")
+                                  .arg(r.index).arg(r.query.start.x).arg(r.query.start.y)
+                                  .arg(r.query.goal.x).arg(r.query.goal.y).arg(r.length)
+                                  .arg(r.expansions).arg(r.latencyNs).toLatin1();
+            if (m_waypoints) {
+                line += ',';
+                for (size_t i = 0; i < r.waypoints.size(); ++i) {
+                    if (i > 0)
+                        line += ';';
+                    line += QByteArray::number(r.waypoints[i].x) + ':' + QByteArray::number(r.waypoints[i].y);
+                }
+            } else if (m_paths) {
+                static const char letters[4] = {'R', 'D', 'L', 'U'};
+                line += ',';
+                for (size_t i = 0; i < r.path.steps(); ++i)
+                    line += letters[r.path.direction(i)];
+            }
+            line += '\n';
+            m_device->write(line);
+        }
+    }
+
+private:
+    QIODevice *m_device;    /**< Устройство вывода. */
+    bool m_binary;          /**< Двоичный формат вместо CSV. */
+    bool m_paths;           /**< Выводить ли сами пути. */
+    bool m_waypoints;       /**< Выводить пути опорными точками. */
+};
+
+}
+
+/**
+ * @brief Точка входа консольного пакетного решателя.
+ *
+ * Загружает карту и список запросов, решает запросы параллельно в пуле потоков и
+ * выводит результаты по мере готовности порциями в исходном порядке. Итоговая
+ * статистика печатается в stderr. С --build-cpd вместо решения запросов строит таблицу
+ * первых ходов и сохраняет карту вместе с ней; с --cpd пути извлекаются из этой таблицы.
+ * С --trace этапы запросов записываются на временную шкалу (последние Trace::BufferEvents
+ * событий каждого потока) и сохраняются в файл Chrome trace.
+ *
+ * @param argc Количество аргументов командной строки.
+ * @param argv Массив строковых аргументов командной строки.
+ * @return Код завершения: 0 при успехе, 1 при ошибке.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("findPathCli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Пакетный поиск кратчайших путей без графического интерфейса."));
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", tr("Файл карты (.fpmap или MovingAI .map)."));
+    QCommandLineOption queriesOption({"q", "queries"}, tr("Файл запросов (.scen или .fpmap). По умолчанию - запросы из карты."), "file");
+    QCommandLineOption outputOption({"o", "output"}, tr("Файл результатов. По умолчанию - stdout."), "file");
+    QCommandLineOption formatOption({"f", "format"}, tr("Формат результатов: csv или binary."), "format", "csv");
+    QCommandLineOption threadsOption({"j", "threads"}, tr("Количество рабочих потоков."), "n");
+    QCommandLineOption pathsOption({"p", "paths"}, tr("Выводить найденные пути."));
+    QCommandLineOption waypointsOption({"w", "waypoints"}, tr("Выводить пути опорными точками спрямленного пути (вместе с -p)."));
+    QCommandLineOption buildCpdOption({"b", "build-cpd"}, tr("Построить таблицу первых ходов и сохранить карту с ней в файл."), "file");
+    QCommandLineOption cpdOption("cpd", tr("Извлекать пути из таблицы первых ходов, сохраненной в карте."));
+    QCommandLineOption traceOption("trace", tr("Записать трассировку этапов запросов в файл Chrome trace (JSON)."), "file");
+    parser.addOptions({queriesOption, outputOption, formatOption, threadsOption, pathsOption, waypointsOption,
+                       buildCpdOption, cpdOption, traceOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        err << parser.helpText();
+        return 1;
+    }
+
+    const QString format = parser.value(formatOption);
+    if (format != "csv" && format != "binary") {
+        err << tr("Неизвестный формат: %1").arg(format) << Qt::endl;
+        return 1;
+    }
+
+    MapData map;
+    QString error;
+    if (!MapFormat::loadAny(args.first(), map, &error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(queriesOption) && !loadQueries(parser.value(queriesOption), map.queries, &error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+
+    if (parser.isSet(threadsOption)) {
+        const int threads = parser.value(threadsOption).toInt();
+        if (threads > 0)
+            QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+
+    if (parser.isSet(buildCpdOption)) {
+        const auto begin = std::chrono::steady_clock::now();
+        const FirstMoveTable table = FirstMoveTable::build(map.grid, QThreadPool::globalInstance()->maxThreadCount());
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        const std::vector<uint8_t> data = table.serialize();
+        map.indices[MapFormat::FirstMoveTag] = QByteArray(reinterpret_cast<const char *>(data.data()), qsizetype(data.size()));
+        err << tr("Таблица первых ходов: %1 с, серий: %2 (%3 на ячейку), размер в файле: %4 МБ, в памяти: %5 МБ")
+                   .arg(seconds, 0, 'f', 2).arg(table.runCount())
+                   .arg(double(table.runCount()) / std::max<size_t>(1, map.grid.cellCount()), 0, 'f', 1)
+                   .arg(data.size() / 1048576.0, 0, 'f', 1).arg(table.memoryBytes() / 1048576.0, 0, 'f', 1)
+            << Qt::endl;
+        if (!MapFormat::save(parser.value(buildCpdOption), map, &error)) {
+            err << error << Qt::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    FirstMoveTable table;
+    if (parser.isSet(cpdOption)) {
+        const QByteArray data = map.indices.value(MapFormat::FirstMoveTag);
+        std::string message;
+        if (data.isEmpty()) {
+            err << tr("В карте нет таблицы первых ходов (постройте ее с --build-cpd)") << Qt::endl;
+            return 1;
+        }
+        if (!FirstMoveTable::deserialize(reinterpret_cast<const uint8_t *>(data.constData()), size_t(data.size()),
+                                         map.grid, table, &message)) {
+            err << QString::fromStdString(message) << Qt::endl;
+            return 1;
+        }
+    }
+
+    QFile output;
+    bool opened = false;
+    if (parser.isSet(outputOption)) {
+        output.setFileName(parser.value(outputOption));
+        opened = output.open(QIODevice::WriteOnly);
+    } else {
+        opened = output.open(stdout, QIODevice::WriteOnly);
+    }
+    if (!opened) {
+        err << tr("Не удалось открыть файл результатов: %1").arg(output.errorString()) << Qt::endl;
+        return 1;
+    }
+
+    const bool paths = parser.isSet(pathsOption);
+    const bool waypoints = parser.isSet(waypointsOption);
+    ResultWriter writer(&output, format == "binary", paths, waypoints);
+    writer.writeHeader(map.queries.size());
+
+    if (parser.isSet(traceOption)) {
+        Trace::setThreadName("main");
+        Trace::setEnabled(true);
+    }
+
+    const Grid &grid = map.grid;
+    const int total = int(map.queries.size());
+    int found = 0;
+    qint64 sumLatency = 0;
+    qint64 maxLatency = 0;
+    long long sumExpansions = 0;
+    const auto begin = std::chrono::steady_clock::now();
+
+    std::vector<QueryResult> chunk;
+    for (int first = 0; first < total; first += ChunkSize) {
+        const int count = std::min(ChunkSize, total - first);
+        chunk.assign(count, QueryResult());
+        for (int i = 0; i < count; ++i) {
+            chunk[i].index = first + i;
+            chunk[i].query = map.queries[first + i];
+        }
+
+        const FirstMoveTable *cpd = table.isEmpty() ? nullptr : &table;
+        {
+            Trace::Scope trace("solve chunk");
+            QtConcurrent::blockingMap(chunk, [&grid, paths, waypoints, cpd](QueryResult &result) {
+                solve(grid, result, paths, waypoints, cpd);
+            });
+        }
+
+        Trace::Scope trace("write results");
+        for (const QueryResult &result : chunk) {
+            writer.write(result);
+            found += result.length >= 0;
+            sumLatency += result.latencyNs;
+            maxLatency = std::max(maxLatency, result.latencyNs);
+            sumExpansions += result.expansions;
+        }
+        output.flush();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    err << tr("Запросов: %1, найдено путей: %2, время: %3 с, запросов в секунду: %4")
+               .arg(total).arg(found).arg(seconds, 0, 'f', 3).arg(seconds > 0 ? total / seconds : 0.0, 0, 'f', 1)
+        << Qt::endl;
+    if (total > 0) {
+        err << tr("Среднее время запроса: %1 мкс, максимальное: %2 мкс, раскрытий в среднем: %3")
+                   .arg(sumLatency / 1000.0 / total, 0, 'f', 1).arg(maxLatency / 1000.0, 0, 'f', 1)
+                   .arg(double(sumExpansions) / total, 0, 'f', 1)
+            << Qt::endl;
+    }
+
+    if (parser.isSet(traceOption)) {
+        Trace::setEnabled(false);
+        std::string message;
+        if (!Trace::writeChromeJson(parser.value(traceOption).toStdString(), &message)) {
+            err << QString::fromStdString(message) << Qt::endl;
+            return 1;
+        }
+        err << tr("Трассировка: %1 событий").arg(Trace::eventCount()) << Qt::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "compactpath.h"
+
+/**
+ * @brief Конструктор пути из одного узла.
+ *
+ * @param start Начальный (и пока конечный) узел пути.
+ */
+CompactPath::CompactPath(const Node &start)
+    : m_start{start.x, start.y},
+    m_end{start.x, start.y},
+    m_valid(true)
+{
+}
+
+/**
+ * @brief Построение компактного пути из вектора узлов.
+ *
+ * Соседние узлы должны отличаться ровно на один шаг по горизонтали или вертикали.
+ *
+ * @param nodes Узлы пути.
+ * @return Компактный путь; пустой, если вектор пуст.
+ */
+CompactPath CompactPath::fromNodes(const std::vector<Node> &nodes)
+{
+    if (nodes.empty())
+        return {};
+
+    CompactPath path(nodes.front());
+    path.reserve(nodes.size() - 1);
+    for (size_t i = 1; i < nodes.size(); ++i)
+        path.append(directionBetween(nodes[i - 1], nodes[i]));
+    return path;
+}
+
+/**
+ * @brief Восстановление пути по направлениям шагов, записанным для каждой ячейки.
+ *
+ * Для каждой ячейки directions хранит код направления шага, которым в нее пришли
+ * (y * width + x); в начальной ячейке записан код root. Путь восстанавливается от цели
+ * к началу в два прохода (подсчет шагов и запись кодов) без промежуточного буфера.
+ *
+ * @param directions Направления шагов для всех ячеек сетки.
+ * @param width Ширина сетки.
+ * @param start Начальный узел (ячейка с кодом root).
+ * @param goal Конечный узел.
+ * @param root Код начальной ячейки.
+ * @return Путь от start до goal.
+ */
+CompactPath CompactPath::fromParents(const uint8_t *directions, int width, const Node &start, const Node &goal,
+                                     uint8_t root)
+{
+    auto code = [&](const Node &cell) { return directions[size_t(cell.y) * width + cell.x]; };
+
+    size_t steps = 0;
+    for (Node cell{goal.x, goal.y}; code(cell) != root; ++steps) {
+        const uint8_t d = code(cell);
+        cell.x -= dx[d];
+        cell.y -= dy[d];
+    }
+
+    CompactPath path(start);
+    path.m_codes.assign((steps + 3) / 4, 0);
+    path.m_steps = steps;
+    path.m_end = Node{goal.x, goal.y};
+    Node cell{goal.x, goal.y};
+    for (size_t i = steps; i-- > 0; ) {
+        const uint8_t d = code(cell);
+        path.m_codes[i >> 2] |= uint8_t(d << ((i & 3) * 2));
+        cell.x -= dx[d];
+        cell.y -= dy[d];
+    }
+    return path;
+}
+
+/**
+ * @brief Начальный участок пути.
+ *
+ * По принципу оптимальности начальный участок кратчайшего пути сам является
+ * кратчайшим путем до своей последней ячейки.
+ *
+ * @param steps Количество шагов участка (не больше steps()).
+ * @return Путь из первых steps шагов.
+ */
+CompactPath CompactPath::prefix(size_t steps) const
+{
+    if (!m_valid)
+        return {};
+
+    CompactPath path(m_start);
+    path.reserve(steps);
+    for (size_t i = 0; i < steps && i < m_steps; ++i)
+        path.append(direction(i));
+    return path;
+}
+
+/**
+ * @brief Направление шага между соседними узлами.
+ *
+ * @param from Исходный узел.
+ * @param to Соседний узел.
+ * @return Направление шага.
+ */
+CompactPath::Direction CompactPath::directionBetween(const Node &from, const Node &to)
+{
+    if (to.x > from.x)
+        return Right;
+    if (to.x < from.x)
+        return Left;
+    return to.y > from.y ? Down : Up;
+}
+
+/**
+ * @brief Добавление шага в конец пути.
+ *
+ * @param direction Направление шага.
+ */
+void CompactPath::append(Direction direction)
+{
+    if ((m_steps & 3) == 0)
+        m_codes.push_back(0);
+    m_codes.back() |= uint8_t(direction << ((m_steps & 3) * 2));
+    ++m_steps;
+    m_end.x += dx[direction];
+    m_end.y += dy[direction];
+}
+
+/**
+ * @brief Развертывание пути в вектор узлов.
+ *
+ * @return Узлы пути от начального до конечного.
+ */
+std::vector<Node> CompactPath::toNodes() const
+{
+    return std::vector<Node>(begin(), end());
+}
+
+/**
+ * @brief Переход к следующему узлу пути.
+ */
+CompactPath::const_iterator &CompactPath::const_iterator::operator++()
+{
+    if (m_index < m_path->m_steps) {
+        const Direction d = m_path->direction(m_index);
+        m_node.x += dx[d];
+        m_node.y += dy[d];
+    }
+    ++m_index;
+    return *this;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "pathfinding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/**
+ * @brief Компактное представление пути (CompactPath).
+ *
+ * Путь хранится как начальная ячейка и последовательность направлений шагов,
+ * по 2 бита на шаг (4 шага в байте). Узлы пути восстанавливаются на лету
+ * итератором, поэтому путь можно отрисовать или выгрузить, не разворачивая его
+ * в вектор узлов.
+ */
+class CompactPath
+{
+public:
+    /**
+     * @brief Направление шага.
+     */
+    enum Direction : uint8_t {
+        Right = 0,  /**< x + 1 */
+        Down = 1,   /**< y + 1 */
+        Left = 2,   /**< x - 1 */
+        Up = 3      /**< y - 1 */
+    };
+
+    static constexpr int dx[4] = {1, 0, -1, 0};    /**< Смещение по x для каждого направления. */
+    static constexpr int dy[4] = {0, 1, 0, -1};    /**< Смещение по y для каждого направления. */
+
+    /**
+     * @brief Итератор по узлам пути.
+     *
+     * Каждый узел вычисляется из предыдущего и кода очередного шага.
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Node;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Node *;
+        using reference = const Node &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return m_node; }
+        pointer operator->() const { return &m_node; }
+        const_iterator &operator++();
+        const_iterator operator++(int) { const_iterator tmp = *this; ++*this; return tmp; }
+        bool operator==(const const_iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        friend class CompactPath;
+        const_iterator(const CompactPath *path, size_t index, const Node &node)
+            : m_path(path), m_index(index), m_node(node) {}
+
+        const CompactPath *m_path {nullptr};    /**< Путь, по которому идет итерация. */
+        size_t m_index {0};                     /**< Номер текущего узла. */
+        Node m_node {0, 0};                     /**< Текущий узел. */
+    };
+
+    CompactPath() = default;
+    explicit CompactPath(const Node &start);
+
+    static CompactPath fromNodes(const std::vector<Node> &nodes);
+    static CompactPath fromParents(const uint8_t *directions, int width, const Node &start, const Node &goal,
+                                   uint8_t root);
+    static Direction directionBetween(const Node &from, const Node &to);
+
+    void append(Direction direction);
+    void reserve(size_t steps) { m_codes.reserve((steps + 3) / 4); }
+    CompactPath prefix(size_t steps) const;
+
+    bool empty() const { return !m_valid; }                     /**< Путь не найден. */
+    size_t size() const { return m_valid ? m_steps + 1 : 0; }   /**< Количество узлов пути. */
+    size_t steps() const { return m_steps; }                    /**< Количество шагов пути. */
+    Node front() const { return m_start; }                     /**< Начальный узел. */
+    Node back() const { return m_end; }                         /**< Конечный узел. */
+
+    Direction direction(size_t step) const {
+        return Direction((m_codes[step >> 2] >> ((step & 3) * 2)) & 3u);
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0, m_start); }
+    const_iterator end() const { return const_iterator(this, size(), m_end); }
+
+    std::vector<Node> toNodes() const;
+    const std::vector<uint8_t> &codes() const { return m_codes; }   /**< Упакованные коды шагов. */
+    size_t memoryBytes() const { return sizeof(*this) + m_codes.capacity(); }
+
+private:
+    Node m_start {0, 0};            /**< Начальный узел. */
+    Node m_end {0, 0};              /**< Конечный узел. */
+    size_t m_steps {0};             /**< Количество шагов. */
+    bool m_valid {false};           /**< Найден ли путь. */
+    std::vector<uint8_t> m_codes;   /**< Коды шагов, по 2 бита. */
+};
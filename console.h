@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QString>
+
+/**
+ * @brief Общее для консольных программ (findPathCli, findPathServer, findPathLoad).
+ */
+namespace Console {
+
+/** @brief Перевод сообщения консольной программы (контекст "main"). */
+inline QString tr(const char *text)
+{
+    return QCoreApplication::translate("main", text);
+}
+
+}
@@ -0,0 +1,10 @@
+# Общее ядро поиска пути: сетка, форматы карт и алгоритмы поиска.
+# Подключается приложением с графическим интерфейсом и консольными целями.
+
+include(search.pri)
+
+SOURCES += \
+    $$PWD/mapformat.cpp
+
+HEADERS += \
+    $$PWD/mapformat.h
@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,21 +9,29 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    box.cpp \
+    framescheduler.cpp \
+    griditem.cpp \
+    gridpyramid.cpp \
     main.cpp \
     mainwindow.cpp \
-    pathfinding.cpp \
+    minimap.cpp \
+    pathserver.cpp \
     scene.cpp \
     view.cpp
 
 HEADERS += \
-    box.h \
-    box.h \
+    framescheduler.h \
+    griditem.h \
+    gridpyramid.h \
     mainwindow.h \
-    pathfinding.h \
+    minimap.h \
+    pathprotocol.h \
+    pathserver.h \
     scene.h \
     view.h
 
+include(core.pri)
+
 FORMS += \
     mainwindow.ui
 
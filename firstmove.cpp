@@ -0,0 +1,426 @@
+#include "firstmove.h"
+#include "parallel.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <numeric>
+
+namespace {
+
+const uint32_t FormatVersion = 1;
+const size_t HeaderBytes = 32;      // версия, ширина, высота, сумма серий, сумма сетки, число серий
+const uint32_t Unreached = UINT32_MAX;  // расстояние до ячейки, еще не достигнутой поиском
+
+/**
+ * @brief Направление с наименьшим номером из маски допустимых первых ходов.
+ */
+uint32_t lowestMove(uint8_t mask)
+{
+    uint32_t d = 0;
+    while ((mask & (1u << d)) == 0)
+        ++d;
+    return d;
+}
+
+/**
+ * @brief Номер точки вдоль кривой Гильберта в квадрате n x n (n - степень двойки).
+ */
+uint64_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y)
+{
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        const uint32_t rx = (x & s) > 0;
+        const uint32_t ry = (y & s) > 0;
+        d += uint64_t(s) * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+/**
+ * @brief Контрольная сумма маски блокировок (FNV-1a по словам строк).
+ */
+uint64_t checksum(const Grid &grid)
+{
+    uint64_t hash = 0xCBF29CE484222325ull ^ (uint64_t(uint32_t(grid.width())) << 32 | uint32_t(grid.height()));
+    for (int y = 0; y < grid.height(); ++y) {
+        const uint64_t *row = grid.rowBits(y);
+        for (int i = 0; i < grid.stride(); ++i)
+            hash = (hash ^ row[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint32_t getU32(const uint8_t *in)
+{
+    return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+/**
+ * @brief Контрольная сумма количеств и серий (FNV-1a по словам, свернутая до 32 бит).
+ */
+uint32_t runsChecksum(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i + 4 <= size; i += 4)
+        hash = (hash ^ getU32(data + i)) * 0x100000001B3ull;
+    return uint32_t(hash ^ hash >> 32);
+}
+
+void putU32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(uint8_t(value >> (8 * i)));
+}
+
+void putU64(std::vector<uint8_t> &out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        out.push_back(uint8_t(value >> (8 * i)));
+}
+
+uint64_t getU64(const uint8_t *in)
+{
+    return uint64_t(getU32(in)) | uint64_t(getU32(in + 4)) << 32;
+}
+
+bool fail(std::string *error, const char *message)
+{
+    if (error != nullptr)
+        *error = message;
+    return false;
+}
+
+}
+
+/**
+ * @brief Вычисление порядка ячеек вдоль кривой Гильберта и компонент связности.
+ *
+ * Эти данные однозначно определяются сеткой и не сохраняются в файле.
+ *
+ * @param grid Сетка препятствий.
+ */
+void FirstMoveTable::prepare(const Grid &grid)
+{
+    m_width = grid.width();
+    m_height = grid.height();
+    m_checksum = checksum(grid);
+
+    const size_t cells = grid.cellCount();
+    uint32_t n = 1;
+    while (n < uint32_t(std::max(m_width, m_height)))
+        n *= 2;
+    std::vector<uint64_t> keys(cells);
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x)
+            keys[size_t(y) * m_width + x] = hilbertIndex(n, uint32_t(x), uint32_t(y));
+    }
+    std::vector<uint32_t> order(cells);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    m_rank.assign(cells, 0);
+    for (size_t i = 0; i < cells; ++i)
+        m_rank[order[i]] = uint32_t(i);
+
+    m_component.assign(cells, -1);
+    std::vector<uint32_t> queue;
+    int32_t components = 0;
+    for (size_t cell = 0; cell < cells; ++cell) {
+        const int x = int(cell % m_width);
+        const int y = int(cell / m_width);
+        if (m_component[cell] >= 0 || grid.isBlocked(x, y))
+            continue;
+        m_component[cell] = components;
+        queue.assign(1, uint32_t(cell));
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const int cx = int(queue[head] % m_width);
+            const int cy = int(queue[head] / m_width);
+            for (int d = 0; d < 4; ++d) {
+                const int nx = cx + CompactPath::dx[d];
+                const int ny = cy + CompactPath::dy[d];
+                if (!grid.isFree(nx, ny) || m_component[size_t(ny) * m_width + nx] >= 0)
+                    continue;
+                m_component[size_t(ny) * m_width + nx] = components;
+                queue.push_back(uint32_t(size_t(ny) * m_width + nx));
+            }
+        }
+        ++components;
+    }
+}
+
+/**
+ * @brief Построение таблицы первых ходов.
+ *
+ * Из каждой свободной ячейки выполняется поиск в ширину, который собирает для каждой цели
+ * маску всех оптимальных первых ходов: объединение масок соседей, лежащих на один шаг
+ * ближе к началу (у соседей начальной ячейки - направление на них). Затем строка
+ * проходится в порядке кривой Гильберта; серия продолжается, пока у ее целей остается
+ * общий оптимальный ход (пересечение масок не пусто), и получает любой из общих ходов.
+ * Такой жадный выбор дает наименьшее число серий при заданном порядке целей. Цели без
+ * хода (заблокированные, недостижимые и само начало) пропускаются, а первая серия строки
+ * начинается с номера 0. Поиски из разных ячеек независимы и выполняются параллельно;
+ * рабочие массивы поиска размещаются в арене потока.
+ *
+ * @param grid Сетка препятствий (должна содержать не больше 2^30 ячеек).
+ * @param threads Количество потоков (0 - по числу ядер).
+ * @return Таблица; пустая, если сетка пуста.
+ */
+FirstMoveTable FirstMoveTable::build(const Grid &grid, int threads)
+{
+    FirstMoveTable table;
+    if (grid.isEmpty() || grid.cellCount() > (size_t(1) << 30))
+        return table;
+    table.prepare(grid);
+
+    const size_t cells = grid.cellCount();
+    const int width = grid.width();
+    std::vector<uint32_t> cellAt(cells);
+    for (size_t cell = 0; cell < cells; ++cell)
+        cellAt[table.m_rank[cell]] = uint32_t(cell);
+
+    std::vector<std::vector<uint32_t>> rows(cells);
+    Parallel::parallelFor(int(cells), Parallel::threadCount(threads), [&](int source) {
+        if (table.m_component[size_t(source)] < 0)
+            return;
+
+        ArenaScope arena;
+        std::pmr::vector<uint32_t> distance(cells, Unreached, arena.resource());
+        std::pmr::vector<uint8_t> moves(cells, 0, arena.resource());
+        std::pmr::vector<uint32_t> queue(arena.resource());
+        queue.reserve(cells);
+        queue.push_back(uint32_t(source));
+        distance[size_t(source)] = 0;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const uint32_t cell = queue[head];
+            const int x = int(cell % width);
+            const int y = int(cell / width);
+            const uint32_t next = distance[cell] + 1;
+            for (int d = 0; d < 4; ++d) {
+                const int nx = x + CompactPath::dx[d];
+                const int ny = y + CompactPath::dy[d];
+                if (!grid.isFree(nx, ny))
+                    continue;
+                const size_t neighbour = size_t(ny) * width + nx;
+                if (distance[neighbour] == Unreached) {
+                    distance[neighbour] = next;
+                    queue.push_back(uint32_t(neighbour));
+                } else if (distance[neighbour] != next) {
+                    continue;
+                }
+                moves[neighbour] |= head == 0 ? uint8_t(1u << d) : moves[cell];
+            }
+        }
+
+        std::vector<uint32_t> &row = rows[size_t(source)];
+        uint8_t allowed = 0;
+        uint32_t start = 0;
+        for (size_t rank = 0; rank < cells; ++rank) {
+            const uint8_t m = moves[cellAt[rank]];
+            if (m == 0)
+                continue;
+            if ((allowed & m) != 0) {
+                allowed &= m;
+                continue;
+            }
+            if (allowed != 0)
+                row.push_back(start << 2 | lowestMove(allowed));
+            start = allowed == 0 ? 0 : uint32_t(rank);
+            allowed = m;
+        }
+        if (allowed != 0)
+            row.push_back(start << 2 | lowestMove(allowed));
+        row.shrink_to_fit();
+    });
+
+    table.m_offsets.assign(cells + 1, 0);
+    for (size_t cell = 0; cell < cells; ++cell)
+        table.m_offsets[cell + 1] = table.m_offsets[cell] + rows[cell].size();
+    table.m_runs.reserve(table.m_offsets.back());
+    for (std::vector<uint32_t> &row : rows) {
+        table.m_runs.insert(table.m_runs.end(), row.begin(), row.end());
+        std::vector<uint32_t>().swap(row);
+    }
+    return table;
+}
+
+/**
+ * @brief Построена ли таблица для данной сетки (совпадают размеры и маска блокировок).
+ */
+bool FirstMoveTable::matches(const Grid &grid) const
+{
+    return !isEmpty() && grid.width() == m_width && grid.height() == m_height && checksum(grid) == m_checksum;
+}
+
+/**
+ * @brief Первый ход кратчайшего пути.
+ *
+ * Двоичный поиск последней серии строки from, начинающейся не позже цели to.
+ *
+ * @param from Текущая ячейка.
+ * @param to Цель.
+ * @return Направление (CompactPath::Direction) или -1, если ячейки совпадают, заблокированы
+ *         или цель недостижима.
+ */
+int FirstMoveTable::firstMove(const Node &from, const Node &to) const
+{
+    if (from.x < 0 || from.x >= m_width || from.y < 0 || from.y >= m_height || to.x < 0 || to.x >= m_width
+        || to.y < 0 || to.y >= m_height || from == to)
+        return -1;
+    const size_t source = size_t(from.y) * m_width + from.x;
+    const size_t target = size_t(to.y) * m_width + to.x;
+    if (m_component[source] < 0 || m_component[source] != m_component[target])
+        return -1;
+
+    const uint32_t *begin = m_runs.data() + m_offsets[source];
+    const uint32_t *end = m_runs.data() + m_offsets[source + 1];
+    const uint32_t *run = std::upper_bound(begin, end, m_rank[target] << 2 | 3u);
+    return run == begin ? -1 : int(run[-1] & 3u);
+}
+
+/**
+ * @brief Извлечение кратчайшего пути без поиска.
+ *
+ * @param start Начальная ячейка.
+ * @param goal Конечная ячейка.
+ * @return Кратчайший путь; пустой, если ячейки вне сетки, заблокированы, цель недостижима
+ *         или таблица не ведет к цели (нет хода или больше cellCount() шагов).
+ */
+CompactPath FirstMoveTable::path(const Node &start, const Node &goal) const
+{
+    if (start.x < 0 || start.x >= m_width || start.y < 0 || start.y >= m_height || goal.x < 0 || goal.x >= m_width
+        || goal.y < 0 || goal.y >= m_height)
+        return {};
+    const int32_t component = m_component[size_t(start.y) * m_width + start.x];
+    if (component < 0 || component != m_component[size_t(goal.y) * m_width + goal.x])
+        return {};
+
+    CompactPath path(start);
+    const size_t cells = size_t(m_width) * size_t(m_height);
+    size_t steps = 0;
+    for (Node node{start.x, start.y}; !(node == goal); ++steps) {
+        const int d = firstMove(node, goal);
+        if (d < 0 || steps == cells)
+            return {};
+        path.append(CompactPath::Direction(d));
+        node = Node{node.x + CompactPath::dx[d], node.y + CompactPath::dy[d]};
+    }
+    return path;
+}
+
+/**
+ * @brief Объем памяти таблицы вместе с порядком ячеек и компонентами.
+ */
+size_t FirstMoveTable::memoryBytes() const
+{
+    return sizeof(*this) + m_rank.capacity() * sizeof(uint32_t) + m_component.capacity() * sizeof(int32_t)
+           + m_offsets.capacity() * sizeof(uint64_t) + m_runs.capacity() * sizeof(uint32_t);
+}
+
+/**
+ * @brief Запись таблицы в двоичный вид для секции индекса файла карты.
+ *
+ * Формат (little-endian): версия, ширина, высота, контрольная сумма количеств и серий
+ * (uint32), контрольная сумма сетки, количество серий (uint64), затем количество серий
+ * каждой строки (uint32 на ячейку) и серии (uint32). Порядок ячеек и компоненты не записываются: они вычисляются по сетке
+ * при загрузке.
+ *
+ * @return Данные секции; пустые, если таблица пуста.
+ */
+std::vector<uint8_t> FirstMoveTable::serialize() const
+{
+    std::vector<uint8_t> out;
+    if (isEmpty())
+        return out;
+    const size_t cells = size_t(m_width) * size_t(m_height);
+    out.reserve(HeaderBytes + 4 * cells + 4 * m_runs.size());
+    putU32(out, FormatVersion);
+    putU32(out, uint32_t(m_width));
+    putU32(out, uint32_t(m_height));
+    putU32(out, 0);
+    putU64(out, m_checksum);
+    putU64(out, m_runs.size());
+    for (size_t cell = 0; cell < cells; ++cell)
+        putU32(out, uint32_t(m_offsets[cell + 1] - m_offsets[cell]));
+    for (uint32_t run : m_runs)
+        putU32(out, run);
+    const uint32_t sum = runsChecksum(out.data() + HeaderBytes, out.size() - HeaderBytes);
+    for (int i = 0; i < 4; ++i)
+        out[12 + i] = uint8_t(sum >> (8 * i));
+    return out;
+}
+
+/**
+ * @brief Загрузка таблицы из данных секции индекса.
+ *
+ * @param data Данные секции.
+ * @param size Размер данных.
+ * @param grid Сетка, для которой таблица была построена.
+ * @param table Загруженная таблица.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если данные корректны и таблица построена для этой сетки.
+ */
+bool FirstMoveTable::deserialize(const uint8_t *data, size_t size, const Grid &grid, FirstMoveTable &table,
+                                 std::string *error)
+{
+    if (size < HeaderBytes || getU32(data) != FormatVersion)
+        return fail(error, "Unsupported first-move table");
+    const int width = int(getU32(data + 4));
+    const int height = int(getU32(data + 8));
+    const uint64_t runs = getU64(data + 24);
+    if (width != grid.width() || height != grid.height() || getU64(data + 16) != checksum(grid))
+        return fail(error, "First-move table was built for another grid");
+    const size_t cells = grid.cellCount();
+    if (runs > (size - HeaderBytes) / 4 || size != HeaderBytes + 4 * cells + 4 * runs)
+        return fail(error, "Truncated first-move table");
+    if (getU32(data + 12) != runsChecksum(data + HeaderBytes, size - HeaderBytes))
+        return fail(error, "Corrupted first-move table");
+
+    FirstMoveTable result;
+    result.prepare(grid);
+    const uint8_t *counts = data + HeaderBytes;
+    result.m_offsets.assign(cells + 1, 0);
+    for (size_t cell = 0; cell < cells; ++cell)
+        result.m_offsets[cell + 1] = result.m_offsets[cell] + getU32(counts + 4 * cell);
+    if (result.m_offsets.back() != runs)
+        return fail(error, "Corrupted first-move table");
+
+    const uint8_t *in = counts + 4 * cells;
+    result.m_runs.resize(runs);
+    for (size_t i = 0; i < runs; ++i)
+        result.m_runs[i] = getU32(in + 4 * i);
+    // Строка ячейки, из которой достижима другая ячейка, не может быть пустой; строки должны
+    // начинаться с номера 0 и возрастать: иначе поиск серии вышел бы за строку
+    std::vector<uint32_t> componentCells;
+    for (int32_t component : result.m_component) {
+        if (component < 0)
+            continue;
+        if (size_t(component) >= componentCells.size())
+            componentCells.resize(size_t(component) + 1, 0);
+        ++componentCells[size_t(component)];
+    }
+    for (size_t cell = 0; cell < cells; ++cell) {
+        const uint64_t begin = result.m_offsets[cell];
+        const uint64_t end = result.m_offsets[cell + 1];
+        const int32_t component = result.m_component[cell];
+        if (begin == end) {
+            if (component >= 0 && componentCells[size_t(component)] > 1)
+                return fail(error, "Corrupted first-move table");
+            continue;
+        }
+        if ((result.m_runs[begin] >> 2) != 0)
+            return fail(error, "Corrupted first-move table");
+        for (uint64_t i = begin + 1; i < end; ++i) {
+            if ((result.m_runs[i] >> 2) <= (result.m_runs[i - 1] >> 2))
+                return fail(error, "Corrupted first-move table");
+        }
+    }
+    table = std::move(result);
+    return true;
+}
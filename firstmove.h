@@ -0,0 +1,65 @@
+#pragma once
+
+#include "compactpath.h"
+#include "grid.h"
+#include "pathfinding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Сжатая таблица первых ходов (FirstMoveTable).
+ *
+ * Для каждой свободной начальной ячейки хранится направление первого шага кратчайшего
+ * пути к каждой цели. Путь извлекается без поиска: шаг по первому ходу, затем первый
+ * ход из следующей ячейки к той же цели и так далее, по одному поиску в строке таблицы
+ * на шаг.
+ *
+ * Строка таблицы (одна начальная ячейка) сжимается кодированием длин серий: цели
+ * упорядочены вдоль кривой Гильберта, поэтому соседние на карте цели идут подряд и
+ * обычно имеют тот же первый ход. Заблокированные и недостижимые цели не влияют на
+ * серии (достижимость проверяется по компонентам связности), поэтому серии получаются
+ * длиннее. Если оптимальных первых ходов несколько, выбирается тот, что продлевает
+ * текущую серию. Серия хранится одним 32-битным словом: номер первой цели серии в порядке
+ * кривой и направление хода.
+ *
+ * Таблица строится один раз для неизменной карты: по поиску в ширину из каждой
+ * начальной ячейки, параллельно на всех ядрах. Построение требует O(N^2) времени для
+ * N свободных ячеек и рассчитано на карты, к которым выполняются миллионы запросов.
+ * Таблица сохраняется в секции индекса файла карты (serialize()/deserialize()).
+ */
+class FirstMoveTable
+{
+public:
+    FirstMoveTable() = default;
+
+    static FirstMoveTable build(const Grid &grid, int threads = 0);
+
+    bool isEmpty() const { return m_width <= 0; }
+    int width() const { return m_width; }      /**< Ширина сетки. */
+    int height() const { return m_height; }    /**< Высота сетки. */
+    bool matches(const Grid &grid) const;
+
+    int firstMove(const Node &from, const Node &to) const;
+    CompactPath path(const Node &start, const Node &goal) const;
+
+    size_t runCount() const { return m_runs.size(); }  /**< Количество серий во всех строках. */
+    size_t memoryBytes() const;
+
+    std::vector<uint8_t> serialize() const;
+    static bool deserialize(const uint8_t *data, size_t size, const Grid &grid, FirstMoveTable &table,
+                            std::string *error = nullptr);
+
+private:
+    int m_width {0};                    /**< Ширина сетки. */
+    int m_height {0};                   /**< Высота сетки. */
+    uint64_t m_checksum {0};            /**< Контрольная сумма сетки, для которой построена таблица. */
+    std::vector<uint32_t> m_rank;       /**< Номер ячейки вдоль кривой Гильберта. */
+    std::vector<int32_t> m_component;   /**< Компонента связности ячейки (-1 у заблокированной). */
+    std::vector<uint64_t> m_offsets;    /**< Начало строки каждой ячейки в m_runs (cellCount + 1). */
+    std::vector<uint32_t> m_runs;       /**< Серии: (номер первой цели << 2) | направление. */
+
+    void prepare(const Grid &grid);
+};
@@ -0,0 +1,104 @@
+#include "framescheduler.h"
+
+#include <QtMath>
+
+/**
+ * @brief Конструктор класса FrameScheduler.
+ *
+ * @param parent Указатель на родительский объект.
+ */
+FrameScheduler::FrameScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FrameScheduler::tryDispatch);
+}
+
+/**
+ * @brief Установка частоты кадров.
+ *
+ * Обычно равна частоте обновления экрана; поиски не запускаются чаще этой частоты.
+ *
+ * @param fps Количество кадров в секунду.
+ */
+void FrameScheduler::setFrameRate(qreal fps)
+{
+    if (fps > 0)
+        m_frameMs = qMax(1, qCeil(1000.0 / fps));
+}
+
+/**
+ * @brief Запрос нового поиска.
+ *
+ * Цель считывается в момент запуска, поэтому несколько запросов подряд объединяются
+ * в один поиск к последней цели.
+ */
+void FrameScheduler::schedule()
+{
+    m_pending = true;
+    ++m_issued;
+    tryDispatch();
+}
+
+/**
+ * @brief Завершение выполнявшегося поиска.
+ *
+ * Освобождает планировщик для следующего запуска (он произойдет в следующем кадре,
+ * если есть новая цель).
+ *
+ * @return true, если результат актуален и его нужно отобразить; false, если после запуска
+ * поиска появилась новая цель или запросы были отменены.
+ */
+bool FrameScheduler::finish()
+{
+    if (!m_busy)
+        return false;
+
+    m_busy = false;
+    const bool current = !m_pending && m_inFlight == m_issued;
+    if (m_pending)
+        QMetaObject::invokeMethod(this, &FrameScheduler::tryDispatch, Qt::QueuedConnection);
+    return current;
+}
+
+/**
+ * @brief Отмена всех ожидающих и выполняющихся запросов.
+ *
+ * Результат уже запущенного поиска после отмены считается устаревшим.
+ */
+void FrameScheduler::cancel()
+{
+    m_timer.stop();
+    m_pending = false;
+    m_busy = false;
+    ++m_issued;
+}
+
+/**
+ * @brief Попытка запуска поиска.
+ *
+ * Поиск запускается, если есть новая цель, предыдущий поиск завершен и с момента
+ * предыдущего запуска прошел хотя бы один кадр. Иначе запуск откладывается до начала
+ * следующего кадра.
+ */
+void FrameScheduler::tryDispatch()
+{
+    if (!m_pending || m_busy)
+        return;
+
+    if (m_lastLaunch.isValid()) {
+        const qint64 remaining = m_frameMs - m_lastLaunch.elapsed();
+        if (remaining > 0) {
+            if (!m_timer.isActive())
+                m_timer.start(int(remaining));
+            return;
+        }
+    }
+
+    m_pending = false;
+    m_busy = true;
+    m_inFlight = m_issued;
+    m_lastLaunch.start();
+    emit dispatch();
+}
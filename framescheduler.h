@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @brief Планировщик запросов поиска с привязкой к частоте кадров (FrameScheduler).
+ *
+ * Объединяет запросы, пришедшие в течение одного кадра, в один, запускает не более
+ * одного поиска одновременно и не чаще одного раза за кадр. Промежуточные цели
+ * пропускаются: к моменту запуска используется только последняя. Результат поиска
+ * считается актуальным, только если за время его выполнения не появилось новой цели.
+ */
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameScheduler(QObject *parent = nullptr);
+
+    void setFrameRate(qreal fps);
+    void schedule();
+    bool finish();
+    void cancel();
+
+    int frameMs() const { return m_frameMs; }       /**< Длительность кадра в миллисекундах. */
+    bool isPending() const { return m_pending; }    /**< Есть ли новая цель, для которой поиск еще не запущен. */
+
+signals:
+    void dispatch();
+
+private slots:
+    void tryDispatch();
+
+private:
+    QTimer m_timer;             /**< Таймер ожидания начала следующего кадра. */
+    QElapsedTimer m_lastLaunch; /**< Время с момента последнего запуска поиска. */
+    int m_frameMs {16};         /**< Длительность кадра в миллисекундах. */
+    bool m_pending {false};     /**< Есть ли новая цель, для которой поиск еще не запущен. */
+    bool m_busy {false};        /**< Выполняется ли поиск. */
+    quint64 m_issued {0};       /**< Номер последнего поколения запросов. */
+    quint64 m_inFlight {0};     /**< Поколение выполняющегося поиска. */
+};
@@ -0,0 +1,273 @@
+#include "grid.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+std::atomic<uint64_t> g_lastVersion {0};    // последняя выданная версия сетки
+
+}
+
+/**
+ * @brief Конструктор сетки заданного размера.
+ *
+ * Создаёт сетку с собственным буфером, все ячейки свободны, слой стоимостей отсутствует.
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ */
+Grid::Grid(int width, int height)
+    : m_width(width > 0 ? width : 0),
+    m_height(height > 0 ? height : 0),
+    m_stride((m_width + 63) / 64)
+{
+    m_ownBits.assign(size_t(m_stride) * m_height, 0);
+    m_bits = m_ownBits.data();
+    touch();
+}
+
+/**
+ * @brief Конструктор копирования.
+ *
+ * Собственные буферы копируются, внешний буфер разделяется между копиями.
+ */
+Grid::Grid(const Grid &other)
+    : m_width(other.m_width),
+    m_height(other.m_height),
+    m_stride(other.m_stride),
+    m_version(other.m_version),
+    m_ownBits(other.m_ownBits),
+    m_ownCosts(other.m_ownCosts),
+    m_keepAlive(other.m_keepAlive)
+{
+    m_bits = other.m_bits == other.m_ownBits.data() ? m_ownBits.data() : other.m_bits;
+    m_costs = (other.m_costs && other.m_costs == other.m_ownCosts.data()) ? m_ownCosts.data() : other.m_costs;
+}
+
+/**
+ * @brief Конструктор перемещения.
+ */
+Grid::Grid(Grid &&other) noexcept
+    : m_width(other.m_width),
+    m_height(other.m_height),
+    m_stride(other.m_stride),
+    m_version(other.m_version),
+    m_bits(other.m_bits),
+    m_costs(other.m_costs),
+    m_ownBits(std::move(other.m_ownBits)),
+    m_ownCosts(std::move(other.m_ownCosts)),
+    m_keepAlive(std::move(other.m_keepAlive))
+{
+    other = Grid();
+}
+
+/**
+ * @brief Оператор присваивания копированием.
+ */
+Grid &Grid::operator=(const Grid &other)
+{
+    if (this != &other) {
+        Grid copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+/**
+ * @brief Оператор присваивания перемещением.
+ */
+Grid &Grid::operator=(Grid &&other) noexcept
+{
+    if (this != &other) {
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_stride = other.m_stride;
+        m_version = other.m_version;
+        m_bits = other.m_bits;
+        m_costs = other.m_costs;
+        m_ownBits = std::move(other.m_ownBits);
+        m_ownCosts = std::move(other.m_ownCosts);
+        m_keepAlive = std::move(other.m_keepAlive);
+
+        other.m_width = other.m_height = other.m_stride = 0;
+        other.m_version = 0;
+        other.m_bits = nullptr;
+        other.m_costs = nullptr;
+        other.m_ownBits.clear();
+        other.m_ownCosts.clear();
+        other.m_keepAlive.reset();
+    }
+    return *this;
+}
+
+/**
+ * @brief Создание сетки поверх внешнего буфера.
+ *
+ * Данные не копируются: сетка читает маску и стоимости прямо из переданной памяти,
+ * а keepAlive удерживает владельца этой памяти, пока жива хотя бы одна копия сетки.
+ * При первом изменении сетка копирует данные в собственный буфер.
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param bits Битовая маска блокировок (stride слов на строку).
+ * @param costs Слой стоимостей или nullptr.
+ * @param keepAlive Владелец внешнего буфера.
+ * @return Сетка, ссылающаяся на внешний буфер.
+ */
+Grid Grid::fromView(int width, int height, const uint64_t *bits, const uint8_t *costs,
+                    std::shared_ptr<const void> keepAlive)
+{
+    Grid grid;
+    grid.m_width = width;
+    grid.m_height = height;
+    grid.m_stride = (width + 63) / 64;
+    grid.m_bits = bits;
+    grid.m_costs = costs;
+    grid.m_keepAlive = std::move(keepAlive);
+    grid.touch();
+    return grid;
+}
+
+/**
+ * @brief Перенос данных во владение сетки.
+ *
+ * Если сетка ссылается на внешний буфер, его содержимое копируется в собственный.
+ */
+void Grid::detach()
+{
+    if (m_bits != m_ownBits.data() || m_ownBits.empty()) {
+        m_ownBits.assign(m_bits, m_bits + size_t(m_stride) * m_height);
+        m_bits = m_ownBits.data();
+    }
+    if (m_costs != nullptr && m_costs != m_ownCosts.data()) {
+        m_ownCosts.assign(m_costs, m_costs + cellCount());
+        m_costs = m_ownCosts.data();
+    }
+    m_keepAlive.reset();
+}
+
+/**
+ * @brief Присвоение сетке новой версии после изменения содержимого.
+ */
+void Grid::touch()
+{
+    m_version = g_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief Проверка, что все ячейки отрезка строки свободны.
+ *
+ * Проверяет по 64 ячейки за одно сравнение со словом маски.
+ *
+ * @param y Строка (внутри сетки).
+ * @param x0 Первая ячейка отрезка (внутри сетки).
+ * @param x1 Последняя ячейка отрезка (x0 <= x1 < width()).
+ * @return true, если в отрезке нет заблокированных ячеек.
+ */
+bool Grid::isSpanFree(int y, int x0, int x1) const
+{
+    const uint64_t *row = rowBits(y);
+    const int first = x0 >> 6;
+    const int last = x1 >> 6;
+    for (int w = first; w <= last; ++w) {
+        uint64_t mask = ~uint64_t(0);
+        if (w == first)
+            mask &= ~uint64_t(0) << (x0 & 63);
+        if (w == last)
+            mask &= ~uint64_t(0) >> (63 - (x1 & 63));
+        if (row[w] & mask)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Установка блокировки ячейки.
+ *
+ * @param x Координата x.
+ * @param y Координата y.
+ * @param blocked Новое состояние ячейки.
+ */
+void Grid::setBlocked(int x, int y, bool blocked)
+{
+    if (!contains(x, y))
+        return;
+
+    detach();
+    uint64_t &word = m_ownBits[size_t(y) * m_stride + (x >> 6)];
+    const uint64_t mask = uint64_t(1) << (x & 63);
+    word = blocked ? (word | mask) : (word & ~mask);
+    touch();
+}
+
+/**
+ * @brief Замена всей строки маски блокировок.
+ *
+ * Версия сетки меняется один раз на строку, поэтому генераторы и загрузчики карт
+ * собирают биты строки локально и передают ее целиком вместо поячеечных setBlocked().
+ *
+ * @param y Строка (внутри сетки).
+ * @param bits stride() слов маски строки; биты за пределами ширины игнорируются.
+ */
+void Grid::setRow(int y, const uint64_t *bits)
+{
+    if (y < 0 || y >= m_height)
+        return;
+
+    detach();
+    uint64_t *row = m_ownBits.data() + size_t(y) * m_stride;
+    std::copy(bits, bits + m_stride, row);
+    if (m_width & 63)
+        row[m_width / 64] &= (uint64_t(1) << (m_width & 63)) - 1;
+    touch();
+}
+
+/**
+ * @brief Установка стоимости ячейки.
+ *
+ * При первом вызове создаётся слой стоимостей, заполненный единицами.
+ *
+ * @param x Координата x.
+ * @param y Координата y.
+ * @param cost Стоимость входа в ячейку (0 трактуется как 1).
+ */
+void Grid::setCost(int x, int y, uint8_t cost)
+{
+    if (!contains(x, y))
+        return;
+
+    detach();
+    if (m_costs == nullptr) {
+        m_ownCosts.assign(cellCount(), 1);
+        m_costs = m_ownCosts.data();
+    }
+    m_ownCosts[size_t(y) * m_width + x] = cost == 0 ? 1 : cost;
+    touch();
+}
+
+/**
+ * @brief Заполнение всей сетки одним состоянием.
+ *
+ * Биты выравнивания в конце строк всегда остаются нулевыми.
+ *
+ * @param blocked Состояние, которое получат все ячейки.
+ */
+void Grid::fill(bool blocked)
+{
+    if (isEmpty())
+        return;
+
+    detach();
+    touch();
+    std::fill(m_ownBits.begin(), m_ownBits.end(), 0);
+    if (!blocked)
+        return;
+
+    for (int y = 0; y < m_height; ++y) {
+        uint64_t *row = m_ownBits.data() + size_t(y) * m_stride;
+        std::fill(row, row + m_width / 64, ~uint64_t(0));
+        if (m_width & 63)
+            row[m_width / 64] = (uint64_t(1) << (m_width & 63)) - 1;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Плоская сетка препятствий (Grid).
+ *
+ * Ячейки хранятся построчно в виде битовой маски: один бит на ячейку, строка выровнена
+ * по 64-битным словам. Дополнительно может храниться слой стоимостей (1..255 на ячейку).
+ * Сетка может как владеть своими данными, так и ссылаться на внешний буфер
+ * (например, на отображённый в память файл карты) без копирования.
+ */
+class Grid
+{
+public:
+    Grid() = default;
+    Grid(int width, int height);
+    Grid(const Grid &other);
+    Grid(Grid &&other) noexcept;
+    Grid &operator=(const Grid &other);
+    Grid &operator=(Grid &&other) noexcept;
+
+    static Grid fromView(int width, int height, const uint64_t *bits, const uint8_t *costs,
+                         std::shared_ptr<const void> keepAlive);
+
+    int width() const { return m_width; }      /**< Ширина сетки (количество ячеек по x). */
+    int height() const { return m_height; }    /**< Высота сетки (количество ячеек по y). */
+    int stride() const { return m_stride; }    /**< Количество 64-битных слов в одной строке. */
+    bool isEmpty() const { return m_width <= 0 || m_height <= 0; }
+    size_t cellCount() const { return size_t(m_width) * size_t(m_height); }
+
+    /** @brief Проверка принадлежности координат сетке. */
+    bool contains(int x, int y) const { return x >= 0 && x < m_width && y >= 0 && y < m_height; }
+
+    /** @brief Проверка блокировки ячейки (координаты должны лежать внутри сетки). */
+    bool isBlocked(int x, int y) const {
+        return (m_bits[size_t(y) * m_stride + (x >> 6)] >> (x & 63)) & 1u;
+    }
+
+    /** @brief Ячейка внутри сетки и не заблокирована. */
+    bool isFree(int x, int y) const { return contains(x, y) && !isBlocked(x, y); }
+
+    bool isSpanFree(int y, int x0, int x1) const;
+
+    /** @brief Стоимость входа в ячейку (1, если слой стоимостей отсутствует). */
+    int cost(int x, int y) const { return m_costs ? m_costs[size_t(y) * m_width + x] : 1; }
+
+    bool hasCosts() const { return m_costs != nullptr; }
+
+    /**
+     * @brief Версия содержимого сетки.
+     *
+     * Уникальна для каждого состояния: меняется при любом изменении сетки и у каждой
+     * новой сетки; копии сетки сохраняют версию. Используется как ключ кэшей результатов.
+     */
+    uint64_t version() const { return m_version; }
+
+    void setBlocked(int x, int y, bool blocked);
+    void setRow(int y, const uint64_t *bits);
+    void setCost(int x, int y, uint8_t cost);
+    void fill(bool blocked);
+
+    const uint64_t *bits() const { return m_bits; }        /**< Битовая маска блокировок. */
+    const uint64_t *rowBits(int y) const { return m_bits + size_t(y) * m_stride; }
+    const uint8_t *costs() const { return m_costs; }       /**< Слой стоимостей или nullptr. */
+    size_t bitsSize() const { return size_t(m_stride) * m_height * sizeof(uint64_t); }
+
+private:
+    int m_width {0};    /**< Ширина сетки. */
+    int m_height {0};   /**< Высота сетки. */
+    int m_stride {0};   /**< Количество слов на строку. */
+    uint64_t m_version {0};             /**< Версия содержимого (0 у пустой сетки). */
+    const uint64_t *m_bits {nullptr};   /**< Текущие данные маски (свои или внешние). */
+    const uint8_t *m_costs {nullptr};   /**< Текущие данные стоимостей (свои или внешние). */
+    std::vector<uint64_t> m_ownBits;    /**< Собственный буфер маски. */
+    std::vector<uint8_t> m_ownCosts;    /**< Собственный буфер стоимостей. */
+    std::shared_ptr<const void> m_keepAlive;    /**< Владелец внешнего буфера. */
+
+    void detach();
+    void touch();
+};
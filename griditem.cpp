@@ -0,0 +1,223 @@
+#include "griditem.h"
+#include "gridpyramid.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+
+#include <cmath>
+
+namespace {
+
+const qreal MinCellPixels = 3;      // при меньшем размере ячейки на экране рисуется пирамида изображений
+const qreal MinBorderPixels = 5;    // при меньшем размере ячейки границы ячеек не рисуются
+
+}
+
+/**
+ * @brief Конструктор класса GridItem.
+ *
+ * Создание элемента не зависит от размера сетки: ячейки рисуются по сетке при отрисовке.
+ *
+ * @param grid Отображаемая сетка.
+ * @param pyramid Уменьшенные изображения сетки (обновляются владельцем вместе с сеткой).
+ * @param cellSize Размер ячейки на сцене.
+ * @param parent Указатель на родительский графический элемент.
+ */
+GridItem::GridItem(const Grid *grid, const GridPyramid *pyramid, int cellSize, QGraphicsItem *parent)
+    : QGraphicsItem(parent),
+    m_grid(grid),
+    m_pyramid(pyramid),
+    m_cellSize(cellSize)
+{
+    // Нужен exposedRect, чтобы рисовать только видимые ячейки
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+/**
+ * @brief Получение ограничивающего прямоугольника сетки.
+ *
+ * @return Прямоугольник, занимаемый всеми ячейками сетки.
+ */
+QRectF GridItem::boundingRect() const
+{
+    return QRectF(-m_cellSize, -m_cellSize, qreal(m_grid->width()) * m_cellSize, qreal(m_grid->height()) * m_cellSize);
+}
+
+/**
+ * @brief Поиск ячейки под точкой.
+ *
+ * @param pos Точка в координатах элемента.
+ * @return Ячейка под точкой или (-1, -1), если точка вне сетки.
+ */
+QPoint GridItem::cellAt(const QPointF &pos) const
+{
+    const QPoint cell(int(std::floor(pos.x() / m_cellSize)) + 1, int(std::floor(pos.y() / m_cellSize)) + 1);
+    return contains(cell) ? cell : QPoint(-1, -1);
+}
+
+/**
+ * @brief Прямоугольник ячейки в координатах элемента.
+ *
+ * @param cell Ячейка сетки.
+ * @return Квадрат, занимаемый ячейкой.
+ */
+QRectF GridItem::cellRect(const QPoint &cell) const
+{
+    return QRectF(qreal(cell.x() - 1) * m_cellSize, qreal(cell.y() - 1) * m_cellSize, m_cellSize, m_cellSize);
+}
+
+/**
+ * @brief Проверка принадлежности ячейки сетке.
+ */
+bool GridItem::contains(const QPoint &cell) const
+{
+    return m_grid->contains(cell.x(), cell.y());
+}
+
+/**
+ * @brief Проверка занятости ячейки.
+ *
+ * @param cell Ячейка сетки.
+ * @return true, если ячейка лежит в сетке и заблокирована.
+ */
+bool GridItem::isBlocked(const QPoint &cell) const
+{
+    return contains(cell) && m_grid->isBlocked(cell.x(), cell.y());
+}
+
+/**
+ * @brief Перерисовка измененных ячеек.
+ *
+ * Вызывается после изменения сетки; перерисовывается только прямоугольник ячеек.
+ *
+ * @param cells Прямоугольник измененных ячеек.
+ */
+void GridItem::updateCells(const QRect &cells)
+{
+    const QRect valid = cells & QRect(0, 0, m_grid->width(), m_grid->height());
+    if (valid.isEmpty())
+        return;
+    update(cellRect(valid.topLeft()).united(cellRect(valid.bottomRight())));
+}
+
+/**
+ * @brief Установка начальной ячейки пути.
+ *
+ * @param cell Ячейка или (-1, -1), чтобы снять отметку.
+ */
+void GridItem::setStart(const QPoint &cell)
+{
+    if (contains(m_start))
+        update(cellRect(m_start));
+    m_start = cell;
+    if (contains(m_start))
+        update(cellRect(m_start));
+}
+
+/**
+ * @brief Установка конечных ячеек (целей) пути.
+ *
+ * @param cells Ячейки, отмечаемые буквой "B" (пустой список снимает отметки).
+ */
+void GridItem::setEnds(const std::vector<QPoint> &cells)
+{
+    for (const QPoint &cell : m_ends) {
+        if (contains(cell))
+            update(cellRect(cell));
+    }
+    m_ends = cells;
+    for (const QPoint &cell : m_ends) {
+        if (contains(cell))
+            update(cellRect(cell));
+    }
+}
+
+/**
+ * @brief Отрисовка буквы в ячейке.
+ *
+ * @param painter Указатель на объект QPainter для рисования.
+ * @param cell Ячейка сетки.
+ * @param text Текст отметки.
+ */
+void GridItem::drawMarker(QPainter *painter, const QPoint &cell, const QString &text)
+{
+    // Устанавливаем шрифт с учетом размера ячейки
+    QFont font = painter->font();
+    const qreal psize = m_cellSize / 2.0;
+    font.setPointSizeF((psize <= 0) ? 2 : psize);
+    painter->setFont(font);
+    painter->setPen(Qt::black);
+    painter->drawText(cellRect(cell).adjusted(1, 1, -1, -1), Qt::AlignCenter, text);
+}
+
+/**
+ * @brief Отрисовка видимой части сетки.
+ *
+ * Рисуются только ячейки, попадающие в exposedRect: фон, отрезки подряд идущих занятых
+ * ячеек строки, границы ячеек (если ячейки достаточно крупные) и отметки начала и
+ * конца пути. При сильном уменьшении рисуется видимая часть уровня пирамиды, в котором
+ * пиксель покрывает примерно столько ячеек, сколько приходится на пиксель экрана.
+ *
+ * @param painter Указатель на объект QPainter для рисования.
+ * @param option Параметры отрисовки с видимой областью элемента.
+ * @param widget Указатель на виджет (не используется в данном контексте).
+ */
+void GridItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    const QRectF exposed = option->exposedRect & boundingRect();
+    if (exposed.isEmpty())
+        return;
+
+    // Диапазон видимых ячеек
+    const int x0 = qMax(0, int(std::floor(exposed.left() / m_cellSize)) + 1);
+    const int y0 = qMax(0, int(std::floor(exposed.top() / m_cellSize)) + 1);
+    const int x1 = qMin(m_grid->width() - 1, int(std::ceil(exposed.right() / m_cellSize)));
+    const int y1 = qMin(m_grid->height() - 1, int(std::ceil(exposed.bottom() / m_cellSize)));
+    if (x0 > x1 || y0 > y1)
+        return;
+    const QRectF area = cellRect(QPoint(x0, y0)).united(cellRect(QPoint(x1, y1)));
+
+    const qreal pixels = m_cellSize * QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if (pixels < MinCellPixels && !m_pyramid->isEmpty()) {
+        const int level = m_pyramid->levelFor(1 / pixels);
+        const qreal scale = 1 << level;
+        painter->drawImage(area, m_pyramid->level(level),
+                           QRectF(x0 / scale, y0 / scale, (x1 - x0 + 1) / scale, (y1 - y0 + 1) / scale));
+        return;
+    }
+
+    painter->fillRect(area, m_freeColor);
+    const qreal size = m_cellSize;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ) {
+            if (!m_grid->isBlocked(x, y)) {
+                ++x;
+                continue;
+            }
+            const int from = x;
+            while (x <= x1 && m_grid->isBlocked(x, y))
+                ++x;
+            painter->fillRect(QRectF((from - 1) * size, (y - 1) * size, (x - from) * size, size), m_busyColor);
+        }
+    }
+
+    if (pixels >= MinBorderPixels) {
+        QVector<QLineF> lines;
+        lines.reserve(x1 - x0 + y1 - y0 + 4);
+        for (int x = x0; x <= x1 + 1; ++x)
+            lines.append(QLineF((x - 1) * size, area.top(), (x - 1) * size, area.bottom()));
+        for (int y = y0; y <= y1 + 1; ++y)
+            lines.append(QLineF(area.left(), (y - 1) * size, area.right(), (y - 1) * size));
+        painter->setPen(Qt::black);
+        painter->drawLines(lines);
+    }
+
+    const QRect visible(QPoint(x0, y0), QPoint(x1, y1));
+    if (visible.contains(m_start))
+        drawMarker(painter, m_start, "A");
+    for (const QPoint &cell : m_ends) {
+        if (visible.contains(cell))
+            drawMarker(painter, cell, "B");
+    }
+}
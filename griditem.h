@@ -0,0 +1,58 @@
+#pragma once
+
+#include "grid.h"
+
+#include <QColor>
+#include <QGraphicsItem>
+
+#include <vector>
+
+class GridPyramid;
+
+/**
+ * @brief Графический элемент сетки (GridItem).
+ *
+ * Вся сетка представлена на сцене одним элементом: ячейки не создаются как отдельные
+ * объекты, а рисуются при отрисовке только в пределах видимой области
+ * (QStyleOptionGraphicsItem::exposedRect) прямо по сетке препятствий. Поэтому время
+ * создания элемента и объем памяти сцены не зависят от размера сетки. При сильном
+ * уменьшении, когда ячейка меньше нескольких пикселей, вместо ячеек рисуется уровень
+ * пирамиды уменьшенных изображений (GridPyramid), соответствующий масштабу.
+ *
+ * Ячейка (x, y) занимает на сцене квадрат от ((x - 1) * size, (y - 1) * size) до
+ * (x * size, y * size). Сетка и пирамида должны существовать, пока существует элемент.
+ */
+class GridItem : public QGraphicsItem
+{
+public:
+    GridItem(const Grid *grid, const GridPyramid *pyramid, int cellSize, QGraphicsItem *parent = nullptr);
+
+    enum { Type = UserType + 2 };
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+    int type() const override { return Type; }  /**< Получение типа графического элемента. */
+
+    int cellSize() const { return m_cellSize; } /**< Размер ячейки на сцене. */
+    QPoint cellAt(const QPointF &pos) const;
+    QRectF cellRect(const QPoint &cell) const;
+    bool contains(const QPoint &cell) const;
+    bool isBlocked(const QPoint &cell) const;
+    void updateCells(const QRect &cells);
+
+    QPoint start() const { return m_start; }    /**< Начальная ячейка пути ((-1, -1), если не выбрана). */
+    void setStart(const QPoint &cell);
+    const std::vector<QPoint> &ends() const { return m_ends; }  /**< Конечные ячейки (цели) пути. */
+    void setEnds(const std::vector<QPoint> &cells);
+
+private:
+    const Grid *m_grid;                 /**< Отображаемая сетка. */
+    const GridPyramid *m_pyramid;       /**< Уменьшенные изображения сетки. */
+    int m_cellSize;                     /**< Размер ячейки на сцене. */
+    QPoint m_start {-1, -1};            /**< Начальная ячейка пути. */
+    std::vector<QPoint> m_ends;         /**< Конечные ячейки (цели) пути. */
+    QColor m_busyColor {QColor(Qt::darkGray)};  /**< Цвет занятой ячейки. */
+    QColor m_freeColor {QColor(Qt::white)};     /**< Цвет свободной ячейки. */
+
+    void drawMarker(QPainter *painter, const QPoint &cell, const QString &text);
+};
@@ -0,0 +1,165 @@
+#include "gridpyramid.h"
+
+#include <QtConcurrent/QtConcurrent>
+
+namespace {
+
+const uchar BusyShade = 128;    // яркость занятой ячейки (Qt::darkGray)
+const uchar FreeShade = 255;    // яркость свободной ячейки
+const int BandRows = 64;        // строк в полосе при параллельной обработке
+
+/**
+ * @brief Параллельная обработка диапазона строк полосами по BandRows строк.
+ *
+ * @param rows Количество строк.
+ * @param function Обработчик полосы [y0, y1).
+ */
+template <typename Function>
+void forBands(int rows, Function function)
+{
+    if (rows <= BandRows) {
+        function(0, rows);
+        return;
+    }
+    std::vector<int> bands;
+    for (int y = 0; y < rows; y += BandRows)
+        bands.push_back(y);
+    QtConcurrent::blockingMap(bands, [&](int y0) { function(y0, qMin(rows, y0 + BandRows)); });
+}
+
+/**
+ * @brief Заполнение пикселей уровня 0 по сетке.
+ *
+ * @param grid Сетка препятствий.
+ * @param bits Данные изображения уровня 0.
+ * @param stride Байт на строку изображения.
+ * @param cells Прямоугольник ячеек.
+ */
+void fillBase(const Grid &grid, uchar *bits, qsizetype stride, const QRect &cells)
+{
+    for (int y = cells.top(); y <= cells.bottom(); ++y) {
+        uchar *line = bits + y * stride;
+        for (int x = cells.left(); x <= cells.right(); ++x)
+            line[x] = grid.isBlocked(x, y) ? BusyShade : FreeShade;
+    }
+}
+
+/**
+ * @brief Вычисление пикселей уровня по предыдущему уровню.
+ *
+ * Пиксель получает среднюю яркость существующих пикселей квадрата 2 x 2 предыдущего
+ * уровня (на правом и нижнем краях их может быть меньше четырех).
+ *
+ * @param source Предыдущий уровень.
+ * @param target Вычисляемый уровень.
+ * @param bits Данные вычисляемого уровня.
+ * @param pixels Прямоугольник вычисляемых пикселей.
+ */
+void downsample(const QImage &source, const QImage &target, uchar *bits, const QRect &pixels)
+{
+    const uchar *sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    const qsizetype stride = target.bytesPerLine();
+    for (int y = pixels.top(); y <= pixels.bottom(); ++y) {
+        const int sy = 2 * y;
+        const bool lastRow = sy + 1 >= source.height();
+        const uchar *row0 = sourceBits + sy * sourceStride;
+        const uchar *row1 = lastRow ? row0 : row0 + sourceStride;
+        uchar *line = bits + y * stride;
+        for (int x = pixels.left(); x <= pixels.right(); ++x) {
+            const int sx = 2 * x;
+            const int sx1 = sx + 1 < source.width() ? sx + 1 : sx;
+            line[x] = uchar((row0[sx] + row0[sx1] + row1[sx] + row1[sx1] + 2) / 4);
+        }
+    }
+}
+
+}
+
+/**
+ * @brief Построение пирамиды по сетке.
+ *
+ * Уровень 0 и каждый следующий уровень заполняются параллельно по полосам строк.
+ * Данные изображений получаются до запуска потоков, поэтому потоки не изменяют сами QImage.
+ *
+ * @param grid Сетка препятствий.
+ */
+void GridPyramid::build(const Grid &grid)
+{
+    clear();
+    if (grid.isEmpty())
+        return;
+
+    m_width = grid.width();
+    m_height = grid.height();
+    m_levels.emplace_back(m_width, m_height, QImage::Format_Grayscale8);
+    {
+        uchar *bits = m_levels.back().bits();
+        const qsizetype stride = m_levels.back().bytesPerLine();
+        const int width = m_width;
+        forBands(m_height, [&](int y0, int y1) { fillBase(grid, bits, stride, QRect(0, y0, width, y1 - y0)); });
+    }
+
+    int width = m_width;
+    int height = m_height;
+    while (width > 1 || height > 1) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        m_levels.emplace_back(width, height, QImage::Format_Grayscale8);
+        const QImage &source = m_levels[m_levels.size() - 2];
+        const QImage &target = m_levels.back();
+        uchar *bits = m_levels.back().bits();
+        forBands(height, [&](int y0, int y1) { downsample(source, target, bits, QRect(0, y0, width, y1 - y0)); });
+    }
+}
+
+/**
+ * @brief Обновление пирамиды после правки сетки.
+ *
+ * Пересчитываются пиксели уровня 0 в прямоугольнике ячеек и покрывающие его пиксели
+ * остальных уровней. Если размеры сетки изменились, пирамида строится заново.
+ *
+ * @param grid Сетка препятствий.
+ * @param cells Прямоугольник измененных ячеек.
+ */
+void GridPyramid::update(const Grid &grid, const QRect &cells)
+{
+    if (grid.width() != m_width || grid.height() != m_height) {
+        build(grid);
+        return;
+    }
+
+    QRect rect = cells & QRect(0, 0, m_width, m_height);
+    if (rect.isEmpty())
+        return;
+
+    fillBase(grid, m_levels[0].bits(), m_levels[0].bytesPerLine(), rect);
+    for (size_t level = 1; level < m_levels.size(); ++level) {
+        rect = QRect(QPoint(rect.left() / 2, rect.top() / 2), QPoint(rect.right() / 2, rect.bottom() / 2));
+        downsample(m_levels[level - 1], m_levels[level], m_levels[level].bits(), rect);
+    }
+}
+
+/**
+ * @brief Удаление всех уровней.
+ */
+void GridPyramid::clear()
+{
+    m_levels.clear();
+    m_width = 0;
+    m_height = 0;
+}
+
+/**
+ * @brief Выбор уровня для отрисовки.
+ *
+ * @param cellsPerPixel Сколько ячеек приходится на пиксель экрана.
+ * @return Самый мелкий уровень, пиксель которого покрывает не больше cellsPerPixel ячеек.
+ */
+int GridPyramid::levelFor(qreal cellsPerPixel) const
+{
+    int level = 0;
+    while (level + 1 < levelCount() && qreal(1 << (level + 1)) <= cellsPerPixel)
+        ++level;
+    return level;
+}
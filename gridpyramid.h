@@ -0,0 +1,40 @@
+#pragma once
+
+#include "grid.h"
+
+#include <QImage>
+#include <QRect>
+
+#include <vector>
+
+/**
+ * @brief Пирамида уменьшенных изображений сетки (GridPyramid).
+ *
+ * Уровень 0 - изображение в оттенках серого с пикселем на ячейку (занятая ячейка темная,
+ * свободная белая). Каждый следующий уровень вдвое меньше предыдущего: пиксель уровня L
+ * покрывает квадрат 2^L x 2^L ячеек, его яркость - средняя яркость четырех пикселей
+ * предыдущего уровня. Последний уровень имеет размер 1 x 1.
+ *
+ * Уровни строятся параллельно по полосам строк. После правки сетки пересчитывается
+ * только прямоугольник измененных ячеек и соответствующие ему пиксели всех уровней.
+ * Используется для отрисовки сетки при сильном уменьшении и миникарты.
+ */
+class GridPyramid
+{
+public:
+    void build(const Grid &grid);
+    void update(const Grid &grid, const QRect &cells);
+    void clear();
+
+    bool isEmpty() const { return m_levels.empty(); }
+    int width() const { return m_width; }       /**< Ширина сетки в ячейках. */
+    int height() const { return m_height; }     /**< Высота сетки в ячейках. */
+    int levelCount() const { return int(m_levels.size()); }
+    const QImage &level(int index) const { return m_levels[size_t(index)]; }   /**< Изображение уровня. */
+    int levelFor(qreal cellsPerPixel) const;
+
+private:
+    int m_width {0};                /**< Ширина сетки в ячейках. */
+    int m_height {0};               /**< Высота сетки в ячейках. */
+    std::vector<QImage> m_levels;   /**< Уровни пирамиды, начиная с полного разрешения. */
+};
@@ -0,0 +1,20 @@
+QT = core network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = findPathLoad
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../console.h \
+    ../pathprotocol.h
+
+include(../core.pri)
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
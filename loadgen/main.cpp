@@ -0,0 +1,224 @@
+#include "compactpath.h"
+#include "console.h"
+#include "mapformat.h"
+#include "mapgen.h"
+#include "pathfinding.h"
+#include "pathprotocol.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QTextStream>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Console::tr;
+
+/**
+ * @brief Генератор нагрузки на сервер запросов путей.
+ *
+ * Открывает несколько соединений; в каждом поддерживается заданное количество запросов
+ * без ответа (конвейер), и каждый ответ сразу освобождает место для следующего запроса.
+ * Задержка запроса - время от записи запроса в сокет до получения ответа.
+ */
+class LoadRun : public QObject
+{
+public:
+    LoadRun(const std::vector<Query> &queries, quint16 map, bool paths, int depth)
+        : m_queries(queries), m_map(map), m_flags(paths ? PathProtocol::WantPath : 0), m_depth(depth),
+          m_sent(queries.size(), 0), m_lengths(queries.size(), PathProtocol::BadRequest)
+    {
+        m_latencies.reserve(queries.size());
+    }
+
+    /** @brief Подключение connections соединений и начало отправки запросов. */
+    void start(const QString &name, int connections)
+    {
+        m_clock.start();
+        for (int i = 0; i < connections; ++i) {
+            Connection *connection = &m_connections.emplace_back(Connection {new QLocalSocket(this), QByteArray()});
+            connect(connection->socket, &QLocalSocket::connected, this, [this, connection] {
+                for (int k = 0; k < m_depth; ++k)
+                    send(connection);
+            });
+            connect(connection->socket, &QLocalSocket::readyRead, this, [this, connection] { receive(connection); });
+            connect(connection->socket, &QLocalSocket::errorOccurred, this, [connection] {
+                QTextStream(stderr) << connection->socket->errorString() << Qt::endl;
+                QCoreApplication::exit(1);
+            });
+            connection->socket->connectToServer(name);
+        }
+    }
+
+    const std::vector<qint64> &latencies() const { return m_latencies; }   /**< Задержки в наносекундах. */
+    const std::vector<qint32> &lengths() const { return m_lengths; }       /**< Длины из ответов. */
+    qint64 elapsedNs() const { return m_elapsed; }                          /**< Время всего прогона. */
+    long long pathBytes() const { return m_pathBytes; }                     /**< Получено байт кодов шагов. */
+
+private:
+    /**
+     * @brief Соединение и буфер непрочитанного ответа.
+     */
+    struct Connection {
+        QLocalSocket *socket;   /**< Соединение с сервером. */
+        QByteArray buffer;      /**< Полученные, но еще не разобранные данные. */
+    };
+
+    std::vector<Query> m_queries;       /**< Запросы. */
+    quint16 m_map;                      /**< Номер карты на сервере. */
+    quint8 m_flags;                     /**< Флаги запросов. */
+    int m_depth;                        /**< Запросов без ответа на соединение. */
+    std::deque<Connection> m_connections;   /**< Соединения (адреса элементов не меняются). */
+    QElapsedTimer m_clock;              /**< Часы прогона. */
+    size_t m_next {0};                  /**< Номер следующего отправляемого запроса. */
+    std::vector<qint64> m_sent;         /**< Моменты отправки запросов. */
+    std::vector<qint32> m_lengths;      /**< Длины путей из ответов. */
+    std::vector<qint64> m_latencies;    /**< Задержки полученных ответов. */
+    long long m_pathBytes {0};          /**< Получено байт кодов шагов. */
+    qint64 m_elapsed {0};               /**< Время всего прогона. */
+
+    void send(Connection *connection)
+    {
+        if (m_next >= m_queries.size())
+            return;
+        const size_t index = m_next++;
+        char record[PathProtocol::RequestSize];
+        PathProtocol::writeRequest({quint32(index), m_map, m_flags, m_queries[index]}, record);
+        m_sent[index] = m_clock.nsecsElapsed();
+        connection->socket->write(record, sizeof(record));
+    }
+
+    void receive(Connection *connection)
+    {
+        connection->buffer += connection->socket->readAll();
+        qsizetype offset = 0;
+        while (connection->buffer.size() - offset >= PathProtocol::ResponseSize) {
+            const PathProtocol::Response response = PathProtocol::readResponse(connection->buffer.constData() + offset);
+            const qsizetype size = PathProtocol::ResponseSize + qsizetype(response.codeBytes);
+            if (connection->buffer.size() - offset < size)
+                break;
+            offset += size;
+            if (response.id >= m_queries.size())
+                continue;
+            m_latencies.push_back(m_clock.nsecsElapsed() - m_sent[response.id]);
+            m_lengths[response.id] = response.length;
+            m_pathBytes += response.codeBytes;
+            send(connection);
+        }
+        connection->buffer.remove(0, offset);
+
+        if (m_latencies.size() == m_queries.size()) {
+            m_elapsed = m_clock.nsecsElapsed();
+            QCoreApplication::quit();
+        }
+    }
+};
+
+/**
+ * @brief Значение перцентиля отсортированного ряда.
+ */
+qint64 percentile(const std::vector<qint64> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    const size_t index = std::min(sorted.size() - 1, size_t(p * double(sorted.size())));
+    return sorted[index];
+}
+
+}
+
+/**
+ * @brief Точка входа генератора нагрузки на сервер запросов путей.
+ *
+ * Загружает ту же карту, что и сервер, генерирует случайные запросы между свободными
+ * ячейками, отправляет их через несколько соединений с конвейером и печатает
+ * количество запросов в секунду и перцентили задержки. С --verify сравнивает длины
+ * путей из ответов с локальным поиском.
+ *
+ * @param argc Количество аргументов командной строки.
+ * @param argv Массив строковых аргументов командной строки.
+ * @return Код завершения: 0 при успехе, 1 при ошибке или расхождении.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("findPathLoad");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Генератор нагрузки на сервер запросов путей (findPathServer)."));
+    parser.addHelpOption();
+    parser.addPositionalArgument("map", tr("Файл карты, загруженной на сервере (.fpmap или MovingAI .map)."));
+    QCommandLineOption nameOption({"n", "name"}, tr("Имя сервера."), "name", "findpath");
+    QCommandLineOption mapIdOption("map-id", tr("Номер карты на сервере."), "id", "0");
+    QCommandLineOption queriesOption({"q", "queries"}, tr("Количество запросов."), "n", "100000");
+    QCommandLineOption connectionsOption({"c", "connections"}, tr("Количество соединений."), "n", "4");
+    QCommandLineOption depthOption({"d", "depth"}, tr("Запросов без ответа на соединение."), "n", "32");
+    QCommandLineOption seedOption("seed", tr("Начальное значение генератора запросов."), "n");
+    QCommandLineOption pathsOption({"p", "paths"}, tr("Запрашивать сами пути."));
+    QCommandLineOption verifyOption("verify", tr("Проверить длины путей локальным поиском."));
+    parser.addOptions({nameOption, mapIdOption, queriesOption, connectionsOption, depthOption, seedOption,
+                       pathsOption, verifyOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        err << parser.helpText();
+        return 1;
+    }
+
+    MapData map;
+    QString error;
+    if (!MapFormat::loadAny(args.first(), map, &error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    const uint64_t seed = parser.isSet(seedOption) ? parser.value(seedOption).toULongLong() : std::random_device()();
+    const std::vector<Query> queries = MapGen::randomQueries(map.grid, qMax(1, parser.value(queriesOption).toInt()), seed);
+    if (queries.empty()) {
+        err << tr("На карте нет свободных ячеек") << Qt::endl;
+        return 1;
+    }
+
+    LoadRun run(queries, quint16(parser.value(mapIdOption).toUInt()), parser.isSet(pathsOption),
+                qMax(1, parser.value(depthOption).toInt()));
+    run.start(parser.value(nameOption), qMax(1, parser.value(connectionsOption).toInt()));
+    const int code = app.exec();
+    if (code != 0)
+        return code;
+
+    std::vector<qint64> latencies = run.latencies();
+    std::sort(latencies.begin(), latencies.end());
+    const double seconds = double(run.elapsedNs()) / 1e9;
+    const long long found = std::count_if(run.lengths().begin(), run.lengths().end(), [](qint32 l) { return l >= 0; });
+    err << tr("Запросов: %1, найдено путей: %2, время: %3 с, запросов в секунду: %4")
+               .arg(queries.size()).arg(found).arg(seconds, 0, 'f', 3)
+               .arg(seconds > 0 ? double(queries.size()) / seconds : 0.0, 0, 'f', 1)
+        << Qt::endl;
+    err << tr("Задержка: p50 %1 мкс, p99 %2 мкс, максимальная %3 мкс")
+               .arg(percentile(latencies, 0.50) / 1000.0, 0, 'f', 1)
+               .arg(percentile(latencies, 0.99) / 1000.0, 0, 'f', 1)
+               .arg(latencies.back() / 1000.0, 0, 'f', 1)
+        << Qt::endl;
+    if (parser.isSet(pathsOption))
+        err << tr("Получено кодов шагов: %1 байт").arg(run.pathBytes()) << Qt::endl;
+
+    if (parser.isSet(verifyOption)) {
+        int mismatches = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const CompactPath path = a_star_search_compact(map.grid, queries[i].start, queries[i].goal);
+            const qint32 expected = path.empty() ? PathProtocol::NotFound : qint32(path.steps());
+            mismatches += run.lengths()[i] != expected;
+        }
+        err << tr("Проверка: расхождений %1").arg(mismatches) << Qt::endl;
+        if (mismatches > 0)
+            return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "trace.h"
 
 #include <QApplication>
 #include <QSettings>
@@ -18,6 +19,7 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Trace::setThreadName("GUI");
     MainWindow w;
     w.show();
     return a.exec();
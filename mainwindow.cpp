@@ -1,15 +1,35 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "box.h"
+#include "anyangle.h"
+#include "framescheduler.h"
+#include "griditem.h"
+#include "mapgen.h"
+#include "minimap.h"
+#include "pathserver.h"
 #include "scene.h"
+#include "trace.h"
 #include "view.h"
 
+#include <algorithm>
 #include <random>
 #include <vector>
 #include <QDir>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QValidator>
 #include <QMessageBox>
 #include <QHBoxLayout>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsPixmapItem>
+#include <QInputDialog>
+#include <QPainterPath>
+#include <QTimer>
+#include <QImage>
+#include <QPixmap>
+#include <QProgressBar>
+#include <QScreen>
 #include <QFuture>
 #include <QPromise>
 #include <QFutureWatcher>
@@ -46,8 +66,43 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->pbPathFinding->setEnabled(false);
 
+    m_scheduler = new FrameScheduler(this);
+    m_agentTimer = new QTimer(this);
+    m_agentTimer->setInterval(200);
+    m_progress = new QProgressBar(this);
+    m_progress->setMaximumWidth(200);
+    m_progress->hide();
+    ui->statusbar->addPermanentWidget(m_progress);
+
+    m_miniMap = new MiniMap(this);
+    QDockWidget *miniMapDock = new QDockWidget(tr("Миникарта"), this);
+    miniMapDock->setObjectName("miniMapDock");
+    miniMapDock->setWidget(m_miniMap);
+    addDockWidget(Qt::RightDockWidgetArea, miniMapDock);
+    ui->menuView->addSeparator();
+    ui->menuView->addAction(miniMapDock->toggleViewAction());
+
     connect(m_scene, &Scene::animated,this, &MainWindow::startAnimatedPath);
-    connect(&m_watcher, &QFutureWatcher<pathNodes>::finished,this, [this] { finish(); });
+    connect(m_scheduler, &FrameScheduler::dispatch, this, &MainWindow::runAnimatedPath);
+    connect(m_scene, &Scene::cellPainted, this, &MainWindow::paintCells);
+    connect(m_view, &View::viewportChanged, this, &MainWindow::updateMiniMapView);
+    connect(m_miniMap, &MiniMap::jumpRequested, this, [this](const QPointF &pos) { m_view->centerOn(pos); });
+    connect(this, &MainWindow::gridEdited, this, [this] { m_pathCache.evictOtherVersions(m_grid.version()); });
+    connect(this, &MainWindow::gridEdited, this, &MainWindow::publishGrid);
+    connect(&m_watcher, &QFutureWatcher<SearchResult>::finished,this, [this] { finish(); });
+    connect(&m_watcher, &QFutureWatcher<SearchResult>::resultReadyAt, this, &MainWindow::showAnytimeResult);
+    connect(&m_agentWatcher, &QFutureWatcher<MultiAgentPlan>::finished, this, [this] { finishAgents(); });
+    connect(&m_gridWatcher, &QFutureWatcher<Grid>::progressRangeChanged, m_progress, &QProgressBar::setRange);
+    connect(&m_gridWatcher, &QFutureWatcher<Grid>::progressValueChanged, m_progress, &QProgressBar::setValue);
+    connect(&m_gridWatcher, &QFutureWatcher<Grid>::finished, this, &MainWindow::finishGenerate);
+    connect(m_agentTimer, &QTimer::timeout, this, &MainWindow::stepAgents);
+    connect(this, &MainWindow::gridEdited, this, [this] {
+        // План построен для прежней сетки: показываются только точки агентов
+        if (!m_plan.paths.empty()) {
+            m_plan = MultiAgentPlan();
+            paintAgents();
+        }
+    });
     showHint(tr("Введите количество квадратов (поля ввода - \"W\", \"H\")...."));
     readSettings();
 }
@@ -59,59 +114,117 @@ MainWindow::~MainWindow()
 {
     m_watcher.cancel();
     m_watcher.waitForFinished();
+    m_gridWatcher.cancel();
+    m_gridWatcher.waitForFinished();
+    m_agentWatcher.waitForFinished();
     delete ui;
 }
 
 /**
- * @brief Заполнение сцены квадратами.
+ * @brief Отображение текущей сетки на сцене.
  *
- * Создает и добавляет на сцену квадраты в соответствии с заданными размерами сетки.
- *
- * @param w Ширина сетки.
- * @param h Высота сетки.
+ * Подбирает размер ячейки по размеру представления и добавляет на сцену один элемент
+ * сетки (GridItem), который рисует только видимые ячейки. Пирамида уменьшенных
+ * изображений для уменьшенного масштаба и миникарты строится параллельно.
  */
-void MainWindow::fillScene(int w, int h)
+void MainWindow::showGrid()
 {
-    int ww = m_view->width()/w - 5;
-    int hh = m_view->height()/h - 5;
+    int ww = m_view->width()/m_grid.width() - 5;
+    int hh = m_view->height()/m_grid.height() - 5;
     m_boxSize = (ww > hh)? hh : ww;
 
     if (m_boxSize < m_minBoxSize)
         m_boxSize = m_minBoxSize;
 
-    // Заполнение сцены квадратами
-    for (int i = 0; i < w; ++i) {
-        for (int j = 0; j < h; ++j) {
-            // Создание нового квадрата с заданными параметрами
-            QGraphicsItem *item = new Box(m_boxSize);
-            item->setData(2,QPoint(i,j));
-            item->setPos(i*m_boxSize,j*m_boxSize);
-            m_boxes[{i,j}] = qgraphicsitem_cast<Box*>(item);
-            m_scene->addItem(item);
-        }
-    }
-    createWall();
+    m_pyramid.build(m_grid);
+    m_gridItem = new GridItem(&m_grid, &m_pyramid, m_boxSize);
+    m_scene->addItem(m_gridItem);
+    m_scene->setGridItem(m_gridItem);
+    m_scene->setSceneRect(m_gridItem->boundingRect());
+    m_miniMap->setPyramid(&m_pyramid, m_boxSize);
+    updateMiniMapView();
     m_view->update();
+    publishGrid();
 }
 
 /**
- * @brief Создание препятствий.
+ * @brief Передача текущей сетки серверу запросов (карта 0), если он запущен.
  *
- * Генерирует случайные препятствия на сцене с вероятностью 20%.
+ * Запросы, полученные раньше, решаются на прежней копии сетки.
  */
-void MainWindow::createWall()
+void MainWindow::publishGrid()
 {
-    std::random_device rd; // Создаем объект для получения случайного начального значения
-    std::mt19937 gen(rd()); //Инициализируем генератор случайных чисел значением, полученным от std::random_device
+    if (m_server == nullptr || !m_server->isListening())
+        return;
+    if (m_grid.isEmpty()) {
+        m_server->removeMap(0);
+        return;
+    }
+    MapData map;
+    map.grid = m_grid;
+    map.queries = m_queries;
+    m_server->setMap(0, map);
+}
 
-    // Создаем распределение Бернулли с вероятностью генерации значения  true = 0.2
-    std::bernoulli_distribution dist(0.2);
+/**
+ * @brief Обновление рамки видимой области на миникарте.
+ *
+ * Вызывается при прокрутке, изменении масштаба и размера представления.
+ */
+void MainWindow::updateMiniMapView()
+{
+    if (m_gridItem != nullptr)
+        m_miniMap->setViewRect(m_view->mapToScene(m_view->viewport()->rect()).boundingRect());
+}
 
-    QList<QGraphicsItem*> items = m_scene->items();
-    for (const auto &item : m_boxes) {
-        bool random_value = dist(gen); // Генерируем случайное булево значение
-        item.second->setIsBusy(random_value);
+/**
+ * @brief Генерация случайной сетки в рабочем потоке.
+ *
+ * Каждая ячейка блокируется с заданной вероятностью. Прогресс публикуется по строкам;
+ * при отмене генерация прекращается без результата.
+ *
+ * @param promise Обещание для публикации прогресса и результата и проверки отмены.
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param density Вероятность того, что ячейка заблокирована.
+ * @param seed Начальное значение генератора.
+ */
+void MainWindow::generateGrid(QPromise<Grid> &promise, int width, int height, double density, uint64_t seed)
+{
+    promise.setProgressRange(0, height);
+    Grid grid(width, height);
+    SplitMix64 rng(seed);
+    std::vector<uint64_t> row(size_t(grid.stride()));
+    for (int y = 0; y < height; ++y) {
+        if (promise.isCanceled())
+            return;
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < width; ++x) {
+            if (rng.chance(density))
+                row[size_t(x >> 6)] |= uint64_t(1) << (x & 63);
+        }
+        grid.setRow(y, row.data());
+        promise.setProgressValue(y + 1);
     }
+    promise.addResult(std::move(grid));
+}
+
+/**
+ * @brief Обработчик завершения фоновой генерации карты.
+ *
+ * Переносит сгенерированную сетку в окно и показывает ее на сцене.
+ */
+void MainWindow::finishGenerate()
+{
+    m_progress->hide();
+    if (m_gridWatcher.isCanceled() || m_gridWatcher.future().resultCount() == 0)
+        return;
+
+    m_grid = m_gridWatcher.result();
+    m_pathCache.evictOtherVersions(m_grid.version());
+    showGrid();
+    ui->pbPathFinding->setEnabled(true);
+    showHint(tr("Выберете начальную и конечную точку маршрута. Нажмите кнопку \"Найти путь\""));
 }
 
 /**
@@ -171,6 +284,221 @@ void MainWindow::deletePath()
         delete line;
     }
     m_currentPath.clear();
+    m_path = CompactPath();
+    m_pathCells.clear();
+    m_pathFailed = false;
+    m_miniMap->setPath(m_path);
+}
+
+/**
+ * @brief Показ результата запроса, для которого путь не найден.
+ *
+ * Удаляет прежний путь и запоминает, что показан неудачный запрос: если потом убрать
+ * стены, запрос будет повторен (paintCells()).
+ */
+void MainWindow::showNoPath()
+{
+    deletePath();
+    ui->lbResult->setText("0");
+    m_pathFailed = true;
+}
+
+/**
+ * @brief Удаление тепловой карты.
+ *
+ * Удаляет со сцены слой тепловой карты раскрытых ячеек.
+ */
+void MainWindow::deleteHeatmap()
+{
+    if (m_heatmap != nullptr) {
+        m_scene->removeItem(m_heatmap);
+        delete m_heatmap;
+        m_heatmap = nullptr;
+    }
+}
+
+/**
+ * @brief Отрисовка тепловой карты.
+ *
+ * Раскрытые ячейки окрашиваются по порядку раскрытия от синего (первые) к красному
+ * (последние). Вся карта рисуется одним изображением, масштабированным до размера
+ * квадратов, и размещается над квадратами, но под линиями пути.
+ *
+ * @param stats Статистика поиска с порядком раскрытия ячеек.
+ */
+void MainWindow::paintHeatmap(const SearchStats &stats)
+{
+    deleteHeatmap();
+    if (stats.expansionOrder.empty() || m_grid.isEmpty())
+        return;
+
+    QImage image(m_grid.width(), m_grid.height(), QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    const qsizetype count = stats.expansionOrder.size();
+    for (qsizetype i = 0; i < count; ++i) {
+        const int cell = stats.expansionOrder[i];
+        const int hue = int(240 - 240 * i / qMax<qsizetype>(1, count - 1));
+        image.setPixelColor(cell % m_grid.width(), cell / m_grid.width(), QColor::fromHsv(hue, 255, 255, 140));
+    }
+
+    m_heatmap = m_scene->addPixmap(QPixmap::fromImage(image));
+    m_heatmap->setTransformationMode(Qt::FastTransformation);
+    m_heatmap->setScale(m_boxSize);
+    m_heatmap->setPos(-m_boxSize, -m_boxSize);
+    m_heatmap->setZValue(1);
+}
+
+/**
+ * @brief Отображение статистики поиска.
+ *
+ * Выводит показатели поиска и счетчики кэша путей в строке статуса и обновляет тепловую карту.
+ *
+ * @param result Результат поиска.
+ */
+void MainWindow::showStats(const SearchResult &result)
+{
+    const SearchStats &stats = result.stats;
+    const PathCache::Counters cache = m_pathCache.counters();
+    const long long hits = cache.hits + cache.prefixHits + cache.treeHits;
+    if (stats.cacheHits > 0) {
+        showHint(tr("Путь взят из кэша, время: %1 мс, кэш: попаданий %2, промахов %3")
+                     .arg(stats.elapsedNs / 1e6, 0, 'f', 3).arg(hits).arg(cache.misses));
+    } else {
+        showHint(tr("Раскрыто: %1, добавлено: %2, повторных: %3, открытый список: %4, память: %5 КБ, время: %6 мс, "
+                    "кэш: %7/%8")
+                     .arg(stats.expansions).arg(stats.pushes).arg(stats.duplicatePops).arg(stats.peakOpenSize)
+                     .arg(stats.peakMemoryBytes / 1024).arg(stats.elapsedNs / 1e6, 0, 'f', 2).arg(hits)
+                     .arg(cache.misses));
+    }
+    if (result.goals > 1)
+        ui->statusbar->showMessage(ui->statusbar->currentMessage()
+                                   + tr(", целей: %1 (путь до ближайшей)").arg(result.goals));
+    if (result.epsilon > 1.0)
+        ui->statusbar->showMessage(ui->statusbar->currentMessage()
+                                   + tr(", путь длиннее кратчайшего не более чем в %1 раза (уточняется)")
+                                         .arg(result.epsilon, 0, 'f', 2));
+
+    if (ui->actionHeatmap->isChecked())
+        paintHeatmap(stats);
+    else
+        deleteHeatmap();
+}
+
+/**
+ * @brief Поиск пути со сбором статистики.
+ *
+ * Выполняется в рабочем потоке, поэтому использует только переданные аргументы.
+ * Ответ сначала ищется в кэше путей (кэш потокобезопасен); при записи тепловой карты
+ * поиск выполняется всегда.
+ *
+ * @param cache Кэш путей.
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param end Конечный узел.
+ * @param heatmap Записывать ли порядок раскрытия ячеек для тепловой карты.
+ * @return Найденный путь и статистика поиска.
+ */
+MainWindow::SearchResult MainWindow::search(PathCache *cache, const Grid &grid, const Node &start, const Node &end,
+                                            bool heatmap)
+{
+    SearchResult result;
+    result.stats.recordExpansions = heatmap;
+    result.path = cache->find(grid, start, end, &result.stats);
+    return result;
+}
+
+/**
+ * @brief Поиск пути до ближайшей из нескольких целей со сбором статистики.
+ *
+ * Выполняет один поиск multi_goal_search() вместо поиска до каждой цели. Результат
+ * зависит от набора целей, поэтому кэш путей не используется.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goals Цели.
+ * @param heatmap Записывать ли порядок раскрытия ячеек для тепловой карты.
+ * @return Найденный путь и статистика поиска.
+ */
+MainWindow::SearchResult MainWindow::searchNearest(const Grid &grid, const Node &start, const std::vector<Node> &goals,
+                                                   bool heatmap)
+{
+    SearchResult result;
+    result.stats.recordExpansions = heatmap;
+    result.goals = int(goals.size());
+    result.path = multi_goal_search(grid, start, goals, &result.stats);
+    return result;
+}
+
+/**
+ * @brief Цели, выбранные на сцене.
+ *
+ * @return Конечная ячейка пути и дополнительные цели.
+ */
+std::vector<Node> MainWindow::selectedGoals() const
+{
+    std::vector<Node> goals;
+    for (const QPoint &cell : m_scene->endCells())
+        goals.push_back(toNode(cell));
+    return goals;
+}
+
+/**
+ * @brief Поиск пути с уточнением (ARA*) для динамического режима.
+ *
+ * Выполняется в рабочем потоке. Первым результатом публикуется лучший путь, найденный
+ * за бюджет времени (если за бюджет путь не найден - первый найденный путь), затем
+ * публикуется каждое уточнение, пока путь не станет кратчайшим или поиск не будет
+ * отменен. Кратчайший путь сохраняется в кэше, а ответ из кэша публикуется сразу.
+ *
+ * @param promise Обещание для публикации результатов и проверки отмены.
+ * @param cache Кэш путей.
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param end Конечный узел.
+ * @param heatmap Записывать ли порядок раскрытия ячеек для тепловой карты.
+ * @param budgetNs Бюджет времени первого результата в наносекундах.
+ */
+void MainWindow::searchAnytime(QPromise<SearchResult> &promise, PathCache *cache, const Grid &grid, const Node &start,
+                               const Node &end, bool heatmap, long long budgetNs)
+{
+    SearchResult result;
+    result.stats.recordExpansions = heatmap;
+    if (!heatmap && cache->lookup(grid, start, end, result.path)) {
+        result.stats.cacheHits = 1;
+        promise.addResult(result);
+        return;
+    }
+    result.stats.cacheMisses = 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    AnytimeSearch search(grid, start, end);
+    const SearchBudget slice {0, budgetNs};
+    auto publish = [&] {
+        result.path = search.path();
+        result.epsilon = search.epsilon();
+        result.stats.elapsedNs = timer.nsecsElapsed();
+        promise.addResult(result);
+    };
+
+    // Лучший путь в пределах бюджета
+    while (!search.isFinished() && !promise.isCanceled()) {
+        const long long remaining = budgetNs - timer.nsecsElapsed();
+        if (remaining <= 0 && !search.path().empty())
+            break;
+        search.improve(SearchBudget{0, qMax(remaining, budgetNs / 4)}, &result.stats);
+    }
+    if (promise.isCanceled())
+        return;
+    publish();
+
+    // Уточнения; отмена проверяется после каждой порции работы
+    while (!search.isFinished() && !promise.isCanceled()) {
+        if (search.improve(slice, &result.stats))
+            publish();
+    }
+    if (search.isFinished())
+        cache->insert(grid, start, end, search.path());
 }
 
 /**
@@ -188,87 +516,173 @@ void MainWindow::showHint(const QString &msg)
 /**
  * @brief Отрисовка пути.
  *
- * Рисует на сцене путь, представленный вектором узлов.
+ * Рисует на сцене путь, читая узлы прямо из компактного представления.
+ * Каждый прямолинейный участок пути рисуется одной линией. В режиме "Путь под любыми
+ * углами" путь предварительно спрямляется (pullString()) и рисуется по опорным точкам.
  *
- * @param path Вектор узлов, представляющий путь.
+ * @param path Компактный путь.
  */
-void MainWindow::paintPath(pathNodes &path)
+void MainWindow::paintPath(const CompactPath &path)
 {
+    Trace::Scope trace("paintPath");
+
     // Удаляем старый путь
     deletePath();
     ui->lbResult->setText(QString("%1").arg(path.size()));
 
+    m_path = path;
+    for (const Node &node : path)
+        m_pathCells.insert(node.y * m_grid.width() + node.x);
+    m_miniMap->setPath(path);
+
     // Рисуем путь
     QPen pen(Qt::red, 2);
-    for (size_t i = 1; i < path.size(); ++i) {
-        std::pair xy1 = std::make_pair(path[i-1].x,path[i-1].y);
-        std::pair xy2 = std::make_pair(path[i].x,path[i].y);
+    if (ui->actionAnyAngle->isChecked()) {
+        const std::vector<Node> waypoints = pullString(m_grid, path);
+        for (size_t i = 1; i < waypoints.size(); ++i) {
+            QPointF p1(cellCenter(waypoints[i - 1]));
+            QPointF p2(cellCenter(waypoints[i]));
+            m_currentPath.push_back(m_scene->addLine(p1.x(), p1.y(), p2.x(), p2.y(), pen));
+        }
+        m_view->update();
+        return;
+    }
+
+    Node from = path.front();
+    for (size_t i = 0; i < path.steps(); ) {
+        const CompactPath::Direction d = path.direction(i);
+        size_t run = 1;
+        while (i + run < path.steps() && path.direction(i + run) == d)
+            ++run;
+        const Node to{from.x + CompactPath::dx[d] * int(run), from.y + CompactPath::dy[d] * int(run)};
 
-        QPointF p1(m_boxes[xy1]->scenePos()-QPointF(m_boxSize/2,m_boxSize/2));  // Вычисляем начальную точку линии
-        QPointF p2(m_boxes[xy2]->scenePos()-QPointF(m_boxSize/2,m_boxSize/2));  // Вычисляем конечную точку линии
+        QPointF p1(cellCenter(from));   // Вычисляем начальную точку линии
+        QPointF p2(cellCenter(to));     // Вычисляем конечную точку линии
 
         QGraphicsLineItem *line = m_scene->addLine(p1.x(), p1.y(), p2.x(), p2.y(), pen);
         m_currentPath.push_back(line);
+        from = to;
+        i += run;
     }
     m_view->update();
 }
 
 /**
- * @brief Получение узла конца пути.
- *
- * Находит и возвращает узел, соответствующий конечному элементу пути.
+ * @brief Получение узла сетки по ячейке сцены.
  *
- * @param box Конечный элемент пути.
- * @return Узел, соответствующий конечному элементу пути.
+ * @param cell Ячейка сцены.
+ * @return Узел, соответствующий ячейке.
  */
-const Node MainWindow::getEndNode(Box *box)
+Node MainWindow::toNode(const QPoint &cell)
 {
-    return Node{box->data(2).toPoint().x(),box->data(2).toPoint().y()};
+    return Node{cell.x(), cell.y()};
 }
 
 /**
- * @brief Получение узла начала пути.
+ * @brief Отображение загруженной карты.
  *
- * Находит и возвращает узел, соответствующий начальному элементу пути.
+ * Пересоздает сцену по размерам карты, переносит на нее препятствия и выбирает
+ * первый запрос карты в качестве начальной и конечной точек маршрута.
  *
- * @param box Начальный элемент пути.
- * @return Узел, соответствующий начальному элементу пути.
+ * @param map Загруженная карта.
  */
-const Node MainWindow::getStartNode(Box *box)
+void MainWindow::showMap(MapData &map)
 {
-    return Node{box->data(2).toPoint().x(),box->data(2).toPoint().y()};
+    m_scheduler->cancel();
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+    m_gridWatcher.cancel();
+    deletePath();
+    deleteHeatmap();
+    deleteAgents();
+    m_agents.clear();
+    m_plan = MultiAgentPlan();
+    m_scene->clearScene();
+    m_gridItem = nullptr;
+    m_pyramid.clear();
+    m_miniMap->setPyramid(nullptr, 1);
+    m_view->resetZoom();
+    ui->lbResult->setText("0");
+
+    ui->leW->setText(QString::number(map.grid.width()));
+    ui->leH->setText(QString::number(map.grid.height()));
+
+    m_grid = map.grid;
+    m_queries = map.queries;
+    m_pathCache.evictOtherVersions(m_grid.version());
+    showGrid();
+
+    if (!m_queries.empty()) {
+        const Query &query = m_queries.front();
+        m_scene->selectPath(QPoint(query.start.x, query.start.y), QPoint(query.goal.x, query.goal.y));
+    }
+
+    ui->pbPathFinding->setEnabled(true);
+    showHint(tr("Карта загружена: %1 x %2, запросов: %3").arg(m_grid.width()).arg(m_grid.height()).arg(m_queries.size()));
 }
 
 /**
- * @brief Создание сетки для поиска пути.
+ * @brief Запрос поиска пути для анимированного отображения пути.
  *
- * Создает сетку, представляющую состояние блокировки ячеек, на основе текущих квадратов на сцене.
+ * Передает запрос планировщику, который объединяет смены цели в пределах кадра
+ * и запускает поиск не чаще частоты обновления экрана.
  */
-void MainWindow::createGrid()
+void MainWindow::startAnimatedPath()
 {
-    int row = ui->leW->text().toInt();
-    int col = ui->leH->text().toInt();
-
-    m_grid.resize(row, std::vector<bool>(col));
-
-    for (int i = 0; i < row; ++i) {
-        for (int j = 0; j < col; ++j) {
-            m_grid[i][j] = m_boxes[{i,j}]->isBusy();
-        }
-    }
+    m_scheduler->schedule();
 }
 
 /**
  * @brief Запуск поиска пути для анимированного отображения пути.
  *
- * Использует алгоритм A* для поиска пути.
+ * Вызывается планировщиком; использует алгоритм A* для поиска пути к текущей цели.
  */
-void MainWindow::startAnimatedPath()
+void MainWindow::runAnimatedPath()
 {
-    Node start = getStartNode(m_scene->startItem());
-    Node end = getEndNode(m_scene->endItem());
+    if (!m_scene->hasStart() || !m_scene->hasEnd()) {
+        m_scheduler->finish();
+        return;
+    }
+
+    Node start = toNode(m_scene->startCell());
+    Node end = toNode(m_scene->endCell());
+
+    const bool heatmap = ui->actionHeatmap->isChecked();
+    // Уточнение пути к прежней цели больше не нужно
+    m_watcher.cancel();
+    m_anytime = ui->actionAnytime->isChecked();
 
-    m_watcher.setFuture(QtConcurrent::run(a_star_search,m_grid, start, end));
+    // Поиск получает собственную копию сетки; ожидание в пуле потоков - от запуска задачи
+    // до начала ее выполнения
+    const uint64_t query = Trace::isEnabled() ? Trace::newQuery() : 0;
+    m_traceQuery = query;
+    Grid grid;
+    {
+        Trace::Scope trace("grid copy", query);
+        grid = m_grid;
+    }
+    const uint64_t submitted = query != 0 ? Trace::now() : 0;
+
+    if (m_anytime) {
+        const long long budgetNs = m_scheduler->frameMs() * 1000000ll;
+        m_watcher.setFuture(QtConcurrent::run([cache = &m_pathCache, grid = std::move(grid), start, end, heatmap,
+                                               budgetNs, query, submitted](QPromise<SearchResult> &promise) {
+            if (query != 0)
+                Trace::complete("thread pool wait", submitted, Trace::now(), query);
+            Trace::QueryScope traceQuery(query);
+            Trace::Scope trace("searchAnytime");
+            searchAnytime(promise, cache, grid, start, end, heatmap, budgetNs);
+        }));
+        return;
+    }
+    m_watcher.setFuture(QtConcurrent::run([cache = &m_pathCache, grid = std::move(grid), start, end, heatmap, query,
+                                           submitted] {
+        if (query != 0)
+            Trace::complete("thread pool wait", submitted, Trace::now(), query);
+        Trace::QueryScope traceQuery(query);
+        Trace::Scope trace("search");
+        return search(cache, grid, start, end, heatmap);
+    }));
 }
 
 /**
@@ -278,19 +692,65 @@ void MainWindow::startAnimatedPath()
  */
 void MainWindow::finish()
 {
-    if (m_watcher.isCanceled())
+    Trace::QueryScope traceQuery(m_traceQuery);
+    Trace::Scope trace("MainWindow::finish");
+
+    // Результаты поиска с уточнением обрабатываются по мере поступления (showAnytimeResult());
+    // здесь планировщик освобождается, только если поиск отменен до первого результата
+    if (m_anytime) {
+        if (m_watcher.future().resultCount() == 0)
+            m_scheduler->finish();
+        return;
+    }
+
+    // Результат устарел, если после запуска поиска цель сменилась или выбор был сброшен
+    const bool current = m_scheduler->finish();
+    if (m_watcher.isCanceled() || !current || !m_scene->hasStart())
         return;
 
     //ui->progressBar->setValue(0);
-    pathNodes path = m_watcher.result();
-    if (path.empty()) {
+    SearchResult result = m_watcher.result();
+    showStats(result);
+    if (result.path.empty()) {
+        showNoPath();
         return;
     }
 
-    paintPath(path);
+    paintPath(result.path);
 }
 
 
+/**
+ * @brief Обработчик очередного результата поиска с уточнением.
+ *
+ * Первый результат - лучший путь, найденный за бюджет кадра: он завершает поиск для
+ * планировщика, поэтому следующая смена цели может запустить новый поиск, не дожидаясь
+ * уточнений. Последующие результаты - уточнения; они отрисовываются, пока цель не
+ * сменилась. Устаревший поиск отменяется.
+ *
+ * @param index Номер результата.
+ */
+void MainWindow::showAnytimeResult(int index)
+{
+    Trace::QueryScope traceQuery(m_traceQuery);
+    Trace::Scope trace("MainWindow::showAnytimeResult");
+
+    if (!m_anytime)
+        return;
+    const bool current = index == 0 ? m_scheduler->finish() : !m_scheduler->isPending();
+    if (!current || !m_scene->hasStart()) {
+        m_watcher.cancel();
+        return;
+    }
+
+    const SearchResult result = m_watcher.resultAt(index);
+    showStats(result);
+    if (!result.path.empty())
+        paintPath(result.path);
+    else if (index == 0)
+        showNoPath();
+}
+
 /**
  * @brief Обработчик нажатия кнопки "Найти путь".
  *
@@ -299,17 +759,27 @@ void MainWindow::finish()
 void MainWindow::on_pbPathFinding_clicked()
 {
     if (ui->rbManually->isChecked()) {
-        Node start = getStartNode(m_scene->startItem());
-        Node end = getEndNode(m_scene->endItem());
-        QFuture<std::vector<Node>> future = QtConcurrent::run(a_star_search,m_grid, start, end);
-        std::vector<Node> path = future.result();
+        if (!m_scene->hasStart() || !m_scene->hasEnd()) {
+            QMessageBox::warning(this, tr("Внимание!"), tr("Выберите начальную и конечную точку маршрута."));
+            return;
+        }
+        Node start = toNode(m_scene->startCell());
+        const std::vector<Node> goals = selectedGoals();
+        const bool heatmap = ui->actionHeatmap->isChecked();
+        QFuture<SearchResult> future = QtConcurrent::run([this, start, goals, heatmap] {
+            return goals.size() == 1 ? search(&m_pathCache, m_grid, start, goals.front(), heatmap)
+                                     : searchNearest(m_grid, start, goals, heatmap);
+        });
+        SearchResult result = future.result();
+        showStats(result);
 
-        if (path.empty()) {
+        if (result.path.empty()) {
+            showNoPath();
             QMessageBox::warning(this, tr("Внимание!"),tr("Невозможно найти путь."));
             return;
         }
 
-        paintPath(path);
+        paintPath(result.path);
         return;
     }
 }
@@ -332,29 +802,54 @@ void MainWindow::on_leW_textChanged(const QString &arg1)
 /**
  * @brief Обработчик нажатия кнопки "Генерировать".
  *
- * Генерирует новую сетку квадратов на сцене и включает кнопку "Найти путь".
+ * Очищает сцену и запускает генерацию новой сетки в рабочем потоке, поэтому сразу
+ * возвращает управление; ход генерации показывается в строке статуса. Сетка
+ * появляется на сцене и кнопка "Найти путь" включается по завершении (finishGenerate()).
+ * Повторное нажатие отменяет незавершенную генерацию.
  */
 void MainWindow::on_pbGenerate_clicked()
 {
-    if (!m_boxes.empty()) m_boxes.clear();
-    if (!m_grid.empty()) m_grid.clear();
+    m_gridWatcher.cancel();
+    m_scheduler->cancel();
+    m_watcher.cancel();
+    m_grid = Grid();
+    m_queries.clear();
+    deleteAgents();
+    m_agents.clear();
+    m_plan = MultiAgentPlan();
     m_scene->clearScene();
+    m_gridItem = nullptr;
+    m_pyramid.clear();
+    m_miniMap->setPyramid(nullptr, 1);
     m_view->resetZoom();
     m_currentPath.clear();
+    m_path = CompactPath();
+    m_pathCells.clear();
+    m_pathFailed = false;
+    m_heatmap = nullptr;
     ui->lbResult->setText("0");
 
-    auto textW = ui->leW->text();
-    auto textH = ui->leH->text();
+    ui->pbPathFinding->setEnabled(false);
+
+    const int width = ui->leW->text().toInt();
+    const int height = ui->leH->text().toInt();
 
-    if (textW.isEmpty() || textH.isEmpty()) {
+    if (width <= 0 || height <= 0) {
+        m_progress->hide();
         QMessageBox::warning(this, tr("Внимание!"),tr("Введите количество квадратов (поля ввода - \"W\", \"H\")....\n"));
         return;
     }
 
-    fillScene(textW.toInt(), textH.toInt());
-    createGrid();
-    ui->pbPathFinding->setEnabled(true);
-    showHint(tr("Выберете начальную и конечную точку маршрута. Нажмите кнопку \"Найти путь\""));
+    // Генерируем препятствия с вероятностью 20%
+    std::random_device rd;
+    const uint64_t seed = (uint64_t(rd()) << 32) | rd();
+    m_progress->setRange(0, height);
+    m_progress->setValue(0);
+    m_progress->show();
+    m_gridWatcher.setFuture(QtConcurrent::run([width, height, seed](QPromise<Grid> &promise) {
+        generateGrid(promise, width, height, 0.2, seed);
+    }));
+    showHint(tr("Генерация карты %1 x %2...").arg(width).arg(height));
 }
 
 /**
@@ -367,6 +862,8 @@ void MainWindow::on_pbGenerate_clicked()
 void MainWindow::on_rdAnimated_clicked(bool checked)
 {
     if (checked) {
+        if (screen() != nullptr)
+            m_scheduler->setFrameRate(screen()->refreshRate());
         m_scene->startAnimated(true);
         showHint(tr("Выберете начальную точку маршрута. Для отмены выбора нажмите правую кнопку мыши."));
     }
@@ -382,6 +879,7 @@ void MainWindow::on_rdAnimated_clicked(bool checked)
 void MainWindow::on_rbManually_clicked(bool checked)
 {
     if (checked) {
+        m_scheduler->cancel();
         m_watcher.cancel();
         m_watcher.waitForFinished();
         //ui->progressBar->setValue(0);
@@ -390,3 +888,495 @@ void MainWindow::on_rbManually_clicked(bool checked)
     }
 }
 
+
+/**
+ * @brief Обработчик пункта меню "Открыть карту".
+ *
+ * Загружает карту в двоичном формате findPath и отображает ее на сцене.
+ */
+void MainWindow::on_actionOpenMap_triggered()
+{
+    const QString path = QFileDialog::getOpenFileName(this, tr("Открыть карту"), QDir::currentPath(),
+                                                      tr("Карты findPath (*.fpmap);;Все файлы (*)"));
+    if (path.isEmpty())
+        return;
+
+    MapData map;
+    QString error;
+    if (!MapFormat::load(path, map, &error)) {
+        QMessageBox::warning(this, tr("Внимание!"), error);
+        return;
+    }
+    showMap(map);
+}
+
+/**
+ * @brief Обработчик пункта меню "Сохранить карту".
+ *
+ * Сохраняет текущую сетку и запросы в двоичном формате findPath. Выбранный на сцене
+ * маршрут записывается первым запросом.
+ */
+void MainWindow::on_actionSaveMap_triggered()
+{
+    if (m_grid.isEmpty()) {
+        QMessageBox::warning(this, tr("Внимание!"), tr("Сначала сгенерируйте или загрузите карту."));
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, tr("Сохранить карту"), QDir::currentPath(),
+                                                      tr("Карты findPath (*.fpmap)"));
+    if (path.isEmpty())
+        return;
+
+    MapData map;
+    map.grid = m_grid;
+    map.queries = m_queries;
+    if (m_scene->hasStart() && m_scene->hasEnd()) {
+        Query query{toNode(m_scene->startCell()), toNode(m_scene->endCell())};
+        if (map.queries.empty() || !(map.queries.front().start == query.start && map.queries.front().goal == query.goal))
+            map.queries.insert(map.queries.begin(), query);
+    }
+
+    QString error;
+    if (!MapFormat::save(path, map, &error))
+        QMessageBox::warning(this, tr("Внимание!"), error);
+}
+
+/**
+ * @brief Обработчик пункта меню "Сервер запросов".
+ *
+ * Запускает или останавливает сервер запросов путей (PathServer) на локальном сокете
+ * findpath. Сервер отвечает по текущей сетке (карта 0) и получает ее копию после
+ * каждой генерации, загрузки и правки.
+ *
+ * @param checked Запустить ли сервер.
+ */
+void MainWindow::on_actionServer_toggled(bool checked)
+{
+    if (!checked) {
+        if (m_server != nullptr)
+            m_server->close();
+        showHint(tr("Сервер запросов остановлен"));
+        return;
+    }
+
+    if (m_server == nullptr) {
+        m_server = new PathServer(this);
+        connect(m_server, &PathServer::batchFinished, this, [this](int size, qint64 elapsedNs) {
+            showHint(tr("Сервер запросов: пакет из %1 запросов за %2 мс, всего запросов: %3")
+                         .arg(size).arg(elapsedNs / 1e6, 0, 'f', 2).arg(m_server->counters().queries));
+        });
+    }
+    QString error;
+    if (!m_server->listen("findpath", &error)) {
+        QMessageBox::warning(this, tr("Внимание!"), error);
+        ui->actionServer->setChecked(false);
+        return;
+    }
+    publishGrid();
+    showHint(tr("Сервер запросов запущен: %1").arg(m_server->fullServerName()));
+}
+
+/**
+ * @brief Обработчик пункта меню "Трассировка запросов".
+ *
+ * Включает запись этапов обработки запросов динамического режима на временную шкалу.
+ * При включении ранее записанные события удаляются.
+ *
+ * @param checked Включить ли трассировку.
+ */
+void MainWindow::on_actionTrace_toggled(bool checked)
+{
+    if (checked)
+        Trace::clear();
+    Trace::setEnabled(checked);
+    showHint(checked ? tr("Трассировка включена") : tr("Трассировка выключена, событий: %1").arg(Trace::eventCount()));
+}
+
+/**
+ * @brief Обработчик пункта меню "Сохранить трассировку".
+ *
+ * Сохраняет записанные события в JSON формата Chrome trace events; файл открывается
+ * в chrome://tracing или Perfetto.
+ */
+void MainWindow::on_actionSaveTrace_triggered()
+{
+    if (Trace::eventCount() == 0) {
+        QMessageBox::warning(this, tr("Внимание!"), tr("Событий нет: включите трассировку и постройте несколько путей."));
+        return;
+    }
+    const QString path = QFileDialog::getSaveFileName(this, tr("Сохранить трассировку"), QDir::currentPath(),
+                                                      tr("Chrome trace (*.json)"));
+    if (path.isEmpty())
+        return;
+
+    std::string error;
+    if (!Trace::writeChromeJson(path.toStdString(), &error))
+        QMessageBox::warning(this, tr("Внимание!"), QString::fromStdString(error));
+}
+
+/**
+ * @brief Обработчик пункта меню "Импорт MovingAI".
+ *
+ * Загружает карту в формате MovingAI (.map). Если рядом лежит сценарий с тем же именем
+ * (файл .map.scen), его запросы также загружаются.
+ */
+void MainWindow::on_actionImportMovingAi_triggered()
+{
+    const QString path = QFileDialog::getOpenFileName(this, tr("Импорт карты MovingAI"), QDir::currentPath(),
+                                                      tr("Карты MovingAI (*.map);;Все файлы (*)"));
+    if (path.isEmpty())
+        return;
+
+    MapData map;
+    QString error;
+    if (!MapFormat::importMovingAiMap(path, map.grid, &error)) {
+        QMessageBox::warning(this, tr("Внимание!"), error);
+        return;
+    }
+
+    const QString scenario = path + ".scen";
+    if (QFileInfo::exists(scenario) && !MapFormat::importMovingAiScenario(scenario, map.queries, &error)) {
+        QMessageBox::warning(this, tr("Внимание!"), error);
+        return;
+    }
+    showMap(map);
+}
+
+/**
+ * @brief Обработчик пункта меню "Тепловая карта раскрытий".
+ *
+ * При выключении удаляет тепловую карту со сцены; при включении она появится после
+ * следующего поиска.
+ *
+ * @param checked Состояние пункта меню.
+ */
+void MainWindow::on_actionHeatmap_toggled(bool checked)
+{
+    if (!checked)
+        deleteHeatmap();
+}
+
+/**
+ * @brief Обработчик пункта меню "Путь под любыми углами".
+ *
+ * Перерисовывает текущий путь в выбранном представлении.
+ *
+ * @param checked Состояние пункта меню.
+ */
+void MainWindow::on_actionAnyAngle_toggled(bool checked)
+{
+    Q_UNUSED(checked);
+    if (m_path.empty())
+        return;
+    const CompactPath path = m_path;
+    paintPath(path);
+}
+
+/**
+ * @brief Обработчик флажка "Рисовать стены".
+ *
+ * Включает или выключает режим рисования стен на сцене.
+ *
+ * @param checked Состояние флажка.
+ */
+void MainWindow::on_cbEditWalls_toggled(bool checked)
+{
+    m_scene->setEditMode(checked);
+    if (checked)
+        showHint(tr("Левая кнопка мыши ставит стены, правая - убирает. Размер кисти задается справа."));
+}
+
+/**
+ * @brief Рисование стен кистью.
+ *
+ * Изменяет только ячейки под кистью (квадрат со стороной, заданной в поле "Кисть"),
+ * обновляет соответствующие квадраты на сцене и испускает сигнал gridEdited() с
+ * прямоугольником измененных ячеек. Начальная ячейка и цели пути не закрашиваются.
+ *
+ * Отображаемый путь перестраивается, только если правка может его изменить:
+ * новая стена легла на путь, или убрана стена, через которую, судя по манхэттенскому
+ * расстоянию, может пройти более короткий путь (к любой из целей). Иначе путь остается корректным и кратчайшим.
+ * Если показан запрос, для которого путь не найден, он повторяется при удалении любой стены.
+ *
+ * @param cell Ячейка в центре кисти.
+ * @param blocked true - поставить стены, false - убрать.
+ */
+void MainWindow::paintCells(const QPoint &cell, bool blocked)
+{
+    if (m_grid.isEmpty())
+        return;
+
+    const int size = ui->sbBrush->value();
+    const int x0 = cell.x() - (size - 1) / 2;
+    const int y0 = cell.y() - (size - 1) / 2;
+    const int length = int(m_path.size()) - 1;
+    const std::vector<QPoint> ends = m_scene->endCells();
+    QRect dirty;
+    bool invalidated = false;
+
+    for (int y = y0; y < y0 + size; ++y) {
+        for (int x = x0; x < x0 + size; ++x) {
+            if (!m_grid.contains(x, y) || m_grid.isBlocked(x, y) == blocked)
+                continue;
+
+            if (blocked && (QPoint(x, y) == m_scene->startCell() || std::count(ends.begin(), ends.end(), QPoint(x, y))))
+                continue;
+
+            m_grid.setBlocked(x, y, blocked);
+            dirty |= QRect(x, y, 1, 1);
+
+            if (m_path.empty()) {
+                invalidated |= !blocked && m_pathFailed;
+                continue;
+            }
+            if (blocked) {
+                invalidated |= m_pathCells.count(y * m_grid.width() + x) > 0;
+            } else {
+                const Node &from = m_path.front();
+                int toGoal = qAbs(m_path.back().x - x) + qAbs(m_path.back().y - y);
+                for (const QPoint &end : ends)
+                    toGoal = qMin(toGoal, qAbs(end.x() - x) + qAbs(end.y() - y));
+                invalidated |= qAbs(from.x - x) + qAbs(from.y - y) + toGoal < length;
+            }
+        }
+    }
+
+    if (dirty.isNull())
+        return;
+
+    m_pyramid.update(m_grid, dirty);
+    m_gridItem->updateCells(dirty);
+    m_miniMap->update();
+    emit gridEdited(dirty);
+    if (invalidated) {
+        refreshPath();
+    } else if (blocked && !m_path.empty() && ui->actionAnyAngle->isChecked()) {
+        // Путь по ячейкам не задет, но новая стена могла перекрыть спрямленный отрезок
+        const CompactPath path = m_path;
+        paintPath(path);
+    }
+}
+
+/**
+ * @brief Перестроение отображаемого пути после правки сетки.
+ *
+ * В динамическом режиме запрос передается планировщику, в ручном режиме поиск
+ * выполняется сразу.
+ */
+void MainWindow::refreshPath()
+{
+    if (!m_scene->hasStart() || !m_scene->hasEnd()) {
+        deletePath();
+        return;
+    }
+
+    if (ui->rdAnimated->isChecked()) {
+        m_scheduler->schedule();
+        return;
+    }
+
+    const std::vector<Node> goals = selectedGoals();
+    SearchResult result = goals.size() == 1
+                              ? search(&m_pathCache, m_grid, toNode(m_scene->startCell()), goals.front(),
+                                       ui->actionHeatmap->isChecked())
+                              : searchNearest(m_grid, toNode(m_scene->startCell()), goals,
+                                              ui->actionHeatmap->isChecked());
+    showStats(result);
+    if (result.path.empty()) {
+        showNoPath();
+        showHint(tr("Путь перекрыт: невозможно найти путь."));
+        return;
+    }
+    paintPath(result.path);
+}
+
+/**
+ * @brief Центр ячейки в координатах сцены.
+ *
+ * @param cell Ячейка сетки.
+ * @return Точка, в которой сходятся линии путей.
+ */
+QPointF MainWindow::cellCenter(const Node &cell) const
+{
+    return QPointF(cell.x * m_boxSize - m_boxSize / 2, cell.y * m_boxSize - m_boxSize / 2);
+}
+
+/**
+ * @brief Удаление агентов и их путей со сцены.
+ *
+ * Останавливает пошаговый показ плана. Сами начальные и конечные точки агентов сохраняются.
+ */
+void MainWindow::deleteAgents()
+{
+    m_agentTimer->stop();
+    for (QGraphicsItem *item : m_agentItems) {
+        m_scene->removeItem(item);
+        delete item;
+    }
+    m_agentItems.clear();
+    m_agentMarkers.clear();
+}
+
+/**
+ * @brief Отрисовка агентов.
+ *
+ * Каждый агент рисуется своим цветом: квадрат на цели, круг в текущем положении и,
+ * если план построен, линия пути. Агент, для которого путь не найден, рисуется
+ * незакрашенным кругом. Положения кругов соответствуют моменту m_agentTime.
+ */
+void MainWindow::paintAgents()
+{
+    deleteAgents();
+    const qreal radius = m_boxSize * 0.35;
+    for (size_t i = 0; i < m_agents.size(); ++i) {
+        const QColor color = QColor::fromHsv(int(i * 137 % 360), 220, 230);
+        const std::vector<Node> *path = i < m_plan.paths.size() ? &m_plan.paths[i] : nullptr;
+
+        QGraphicsRectItem *goal = m_scene->addRect(-radius, -radius, 2 * radius, 2 * radius, QPen(color, 2));
+        goal->setPos(cellCenter(m_agents[i].goal));
+        goal->setZValue(2);
+        m_agentItems.push_back(goal);
+
+        if (path != nullptr && !path->empty()) {
+            QPainterPath line(cellCenter(path->front()));
+            for (size_t t = 1; t < path->size(); ++t) {
+                if (!((*path)[t] == (*path)[t - 1]))
+                    line.lineTo(cellCenter((*path)[t]));
+            }
+            QGraphicsPathItem *item = m_scene->addPath(line, QPen(color, 2));
+            item->setZValue(2);
+            m_agentItems.push_back(item);
+        }
+
+        const bool failed = path != nullptr && path->empty();
+        QGraphicsEllipseItem *marker = m_scene->addEllipse(-radius, -radius, 2 * radius, 2 * radius, QPen(color, 2),
+                                                           failed ? QBrush(Qt::NoBrush) : QBrush(color));
+        marker->setPos(cellCenter(path != nullptr && !failed ? positionAt(*path, m_agentTime) : m_agents[i].start));
+        marker->setZValue(3);
+        m_agentItems.push_back(marker);
+        m_agentMarkers.push_back(marker);
+    }
+    m_view->update();
+}
+
+/**
+ * @brief Запуск планирования путей агентов в рабочем потоке.
+ *
+ * @param conflictBased true - поиск на основе конфликтов (CBS), false - приоритетное планирование.
+ */
+void MainWindow::planAgents(bool conflictBased)
+{
+    if (m_agents.empty()) {
+        QMessageBox::warning(this, tr("Внимание!"), tr("Сначала расставьте агентов."));
+        return;
+    }
+    if (m_agentWatcher.isRunning())
+        return;
+
+    m_agentTimer->stop();
+    m_agentVersion = m_grid.version();
+    m_agentWatcher.setFuture(QtConcurrent::run([grid = m_grid, agents = m_agents, conflictBased] {
+        return conflictBased ? conflict_based_search(grid, agents) : prioritized_planning(grid, agents);
+    }));
+    showHint(tr("Планирование путей агентов..."));
+}
+
+/**
+ * @brief Обработчик завершения планирования путей агентов.
+ *
+ * Отрисовывает пути и запускает пошаговый показ движения агентов. Результат
+ * отбрасывается, если за время планирования сетка или агенты изменились.
+ */
+void MainWindow::finishAgents()
+{
+    MultiAgentPlan plan = m_agentWatcher.result();
+    if (m_agentVersion != m_grid.version() || plan.paths.size() != m_agents.size())
+        return;
+
+    m_plan = std::move(plan);
+    m_agentTime = 0;
+    paintAgents();
+    stepAgents();
+    m_agentTimer->start();
+}
+
+/**
+ * @brief Шаг пошагового показа плана.
+ *
+ * Перемещает агентов в положения следующего момента времени и выводит показатели плана.
+ */
+void MainWindow::stepAgents()
+{
+    if (m_agentTimer->isActive())
+        ++m_agentTime;
+    if (m_agentTime >= m_plan.makespan) {
+        m_agentTime = m_plan.makespan;
+        m_agentTimer->stop();
+    }
+
+    for (size_t i = 0; i < m_agentMarkers.size() && i < m_plan.paths.size(); ++i) {
+        if (!m_plan.paths[i].empty())
+            m_agentMarkers[i]->setPos(cellCenter(positionAt(m_plan.paths[i], m_agentTime)));
+    }
+
+    QString hint = tr("Шаг %1 из %2, сумма стоимостей: %3, без пути: %4, раскрыто: %5, время: %6 мс")
+                       .arg(m_agentTime).arg(m_plan.makespan).arg(m_plan.sumOfCosts).arg(m_plan.failed)
+                       .arg(m_plan.expansions).arg(m_plan.elapsedNs / 1e6, 0, 'f', 2);
+    if (m_plan.highLevelNodes > 0)
+        hint += m_plan.fallback ? tr(", CBS: %1 узлов, использовано приоритетное планирование").arg(m_plan.highLevelNodes)
+                                : tr(", CBS: %1 узлов").arg(m_plan.highLevelNodes);
+    showHint(hint);
+}
+
+/**
+ * @brief Обработчик пункта меню "Расставить агентов".
+ *
+ * Запрашивает количество агентов и выбирает для них случайные различные начальные
+ * и конечные точки на свободных ячейках.
+ */
+void MainWindow::on_actionPlaceAgents_triggered()
+{
+    if (m_grid.isEmpty()) {
+        QMessageBox::warning(this, tr("Внимание!"), tr("Сначала сгенерируйте или загрузите карту."));
+        return;
+    }
+
+    bool ok = false;
+    const int count = QInputDialog::getInt(this, tr("Агенты"), tr("Количество агентов:"), 10, 1, 1000, 1, &ok);
+    if (!ok)
+        return;
+
+    std::random_device rd;
+    m_agents = MapGen::agentQueries(m_grid, count, (uint64_t(rd()) << 32) | rd());
+    m_plan = MultiAgentPlan();
+    m_agentTime = 0;
+    paintAgents();
+    showHint(tr("Агентов: %1. Выберите способ планирования в меню \"Агенты\".").arg(m_agents.size()));
+}
+
+/**
+ * @brief Обработчик пункта меню "Приоритетное планирование".
+ */
+void MainWindow::on_actionPlanPrioritized_triggered()
+{
+    planAgents(false);
+}
+
+/**
+ * @brief Обработчик пункта меню "Поиск на основе конфликтов (CBS)".
+ */
+void MainWindow::on_actionPlanCbs_triggered()
+{
+    planAgents(true);
+}
+
+/**
+ * @brief Обработчик пункта меню "Убрать агентов".
+ */
+void MainWindow::on_actionClearAgents_triggered()
+{
+    deleteAgents();
+    m_agents.clear();
+    m_plan = MultiAgentPlan();
+}
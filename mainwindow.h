@@ -1,21 +1,39 @@
 #pragma once
 
+#include "anytime.h"
+#include "compactpath.h"
+#include "gridpyramid.h"
+#include "mapformat.h"
+#include "multiagent.h"
+#include "multigoal.h"
+#include "pathcache.h"
 #include "pathfinding.h"
 #include "qfuturewatcher.h"
 
 #include <QMainWindow>
+#include <QPromise>
 #include <QSettings>
 #include <QString>
 #include <QGraphicsScene>
 #include <QSharedPointer>
 
+#include <unordered_set>
+
+class QGraphicsPixmapItem;
+class QGraphicsEllipseItem;
+class QProgressBar;
+class QTimer;
+
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class MainWindow;
 }
 QT_END_NAMESPACE
 
-class Box;
+class FrameScheduler;
+class GridItem;
+class MiniMap;
+class PathServer;
 class Scene;
 class View;
 
@@ -27,21 +45,51 @@ class View;
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
-    using pathNodes = std::vector<Node>;
+    /**
+     * @brief Результат поиска пути вместе со статистикой.
+     */
+    struct SearchResult {
+        CompactPath path;   /**< Найденный путь. */
+        SearchStats stats;  /**< Статистика поиска. */
+        double epsilon {1.0};   /**< Во сколько раз путь может быть длиннее кратчайшего. */
+        int goals {1};          /**< Количество целей (путь ведет к ближайшей). */
+    };
 
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+signals:
+    void gridEdited(const QRect &region);
+
 private slots:
     void closeEvent(QCloseEvent *event);
     void on_pbGenerate_clicked();
     void on_pbPathFinding_clicked();
     void on_leW_textChanged(const QString &arg1);
     void startAnimatedPath();
+    void runAnimatedPath();
     void on_rdAnimated_clicked(bool checked);
     void on_rbManually_clicked(bool checked);
+    void on_actionOpenMap_triggered();
+    void on_actionSaveMap_triggered();
+    void on_actionImportMovingAi_triggered();
+    void on_actionServer_toggled(bool checked);
+    void on_actionTrace_toggled(bool checked);
+    void on_actionSaveTrace_triggered();
+    void on_actionHeatmap_toggled(bool checked);
+    void on_actionAnyAngle_toggled(bool checked);
+    void on_cbEditWalls_toggled(bool checked);
+    void on_actionPlaceAgents_triggered();
+    void on_actionPlanPrioritized_triggered();
+    void on_actionPlanCbs_triggered();
+    void on_actionClearAgents_triggered();
+    void stepAgents();
+    void paintCells(const QPoint &cell, bool blocked);
     void finish();
+    void finishGenerate();
+    void updateMiniMapView();
+    void showAnytimeResult(int index);
 
 private:
     Ui::MainWindow *ui; /**< Указатель на интерфейс пользователя. */
@@ -51,19 +99,57 @@ private:
     Scene *m_scene;             /**< Указатель на графическую сцену (Scene). */
     int m_boxSize;              /**< Размер квадратов на сцене. */
     const int m_minBoxSize = 6;             /**< Минимальный размер квадрата. */
-    std::vector<std::vector<bool>> m_grid;  /**< Сетка, представляющая блокировки ячеек. */
-    std::map<std::pair<int,int>, Box*> m_boxes;  /**< Карта квадратов на сцене. */
+    Grid m_grid;                            /**< Сетка, представляющая блокировки ячеек. */
+    std::vector<Query> m_queries;           /**< Запросы, загруженные вместе с картой. */
+    GridItem *m_gridItem {nullptr};         /**< Элемент сетки на сцене. */
+    GridPyramid m_pyramid;                  /**< Уменьшенные изображения сетки для сцены и миникарты. */
+    MiniMap *m_miniMap;                     /**< Миникарта. */
+    QProgressBar *m_progress;               /**< Индикатор фоновой генерации карты. */
+    QFutureWatcher<Grid> m_gridWatcher;     /**< Монитор фоновой генерации карты. */
     std::vector<QGraphicsLineItem *> m_currentPath;             /**< Текущий путь на сцене. */
-    QFutureWatcher<pathNodes> m_watcher;    /** < Монитор для отслеживания выполнения поиска пути. */
+    CompactPath m_path;                     /**< Текущий путь. */
+    std::unordered_set<int> m_pathCells;    /**< Индексы ячеек текущего пути (y * width + x). */
+    bool m_pathFailed {false};              /**< Показан запрос, для которого путь не найден. */
+    PathCache m_pathCache;                  /**< Кэш найденных путей для повторных запросов. */
+    FrameScheduler *m_scheduler;            /**< Планировщик поисков в динамическом режиме. */
+    QGraphicsPixmapItem *m_heatmap {nullptr};   /**< Тепловая карта раскрытых ячеек. */
+    QFutureWatcher<SearchResult> m_watcher;    /** < Монитор для отслеживания выполнения поиска пути. */
+    bool m_anytime {false};                 /**< Выполняется ли поиск с уточнением (ARA*). */
+    uint64_t m_traceQuery {0};              /**< Номер выполняющегося запроса в трассировке (0 - без трассировки). */
+    std::vector<Query> m_agents;            /**< Начальные и конечные точки агентов. */
+    MultiAgentPlan m_plan;                  /**< План агентов. */
+    std::vector<QGraphicsItem *> m_agentItems;              /**< Отметки агентов и линии их путей на сцене. */
+    std::vector<QGraphicsEllipseItem *> m_agentMarkers;     /**< Текущие положения агентов на сцене. */
+    QTimer *m_agentTimer;                   /**< Таймер пошагового показа плана. */
+    int m_agentTime {0};                    /**< Показываемый момент времени плана. */
+    uint64_t m_agentVersion {0};            /**< Версия сетки, для которой запущено планирование. */
+    QFutureWatcher<MultiAgentPlan> m_agentWatcher;  /**< Монитор для отслеживания планирования агентов. */
+    PathServer *m_server {nullptr};         /**< Сервер запросов путей других процессов. */
 
     void readSettings();
     void writeSettings();
-    void fillScene(int w, int h);
-    void createWall();
-    void createGrid();
-    void paintPath(pathNodes &path);
-    const Node getEndNode(Box*);
-    const Node getStartNode(Box*);
+    void showGrid();
+    void publishGrid();
+    static void generateGrid(QPromise<Grid> &promise, int width, int height, double density, uint64_t seed);
+    void showMap(MapData &map);
+    void paintPath(const CompactPath &path);
+    static Node toNode(const QPoint &cell);
     void deletePath();
+    void showNoPath();
+    void refreshPath();
+    void deleteHeatmap();
+    void paintHeatmap(const SearchStats &stats);
+    void showStats(const SearchResult &result);
+    static SearchResult search(PathCache *cache, const Grid &grid, const Node &start, const Node &end, bool heatmap);
+    static SearchResult searchNearest(const Grid &grid, const Node &start, const std::vector<Node> &goals,
+                                      bool heatmap);
+    std::vector<Node> selectedGoals() const;
+    static void searchAnytime(QPromise<SearchResult> &promise, PathCache *cache, const Grid &grid, const Node &start,
+                              const Node &end, bool heatmap, long long budgetNs);
     void showHint(const QString &msg);
+    void planAgents(bool conflictBased);
+    void finishAgents();
+    void paintAgents();
+    void deleteAgents();
+    QPointF cellCenter(const Node &cell) const;
 };
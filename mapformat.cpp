@@ -0,0 +1,353 @@
+#include "mapformat.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char Magic[4] = {'F', 'P', 'M', 'P'};
+const quint16 Version = 1;
+const int HeaderSize = 32;      // magic, версия, число секций, ширина, высота, резерв
+const int SectionEntrySize = 24; // тег, флаги, смещение, размер
+const int Alignment = 64;
+
+/**
+ * @brief Описание секции в таблице секций.
+ */
+struct Section {
+    quint32 tag;
+    const char *data;
+    quint64 size;
+};
+
+QString translate(const char *text)
+{
+    return QCoreApplication::translate("MapFormat", text);
+}
+
+bool fail(QString *error, const QString &msg)
+{
+    if (error != nullptr)
+        *error = msg;
+    return false;
+}
+
+quint64 alignUp(quint64 value)
+{
+    return (value + Alignment - 1) / Alignment * Alignment;
+}
+
+/**
+ * @brief Хранилище содержимого файла, если отображение в память недоступно.
+ */
+struct Buffer {
+    QByteArray bytes;
+};
+
+}
+
+namespace MapFormat {
+
+/**
+ * @brief Загрузка карты из двоичного файла.
+ *
+ * Файл отображается в память через QFile::map, сетка и секции индексов ссылаются на
+ * отображённую область без копирования. Если отображение невозможно, файл читается целиком.
+ *
+ * @param path Путь к файлу.
+ * @param data Структура, в которую загружается карта.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если карта загружена; false в противном случае.
+ */
+bool load(const QString &path, MapData &data, QString *error)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly))
+        return fail(error, translate("Не удалось открыть файл: %1").arg(file->errorString()));
+
+    const qint64 size = file->size();
+    if (size < HeaderSize)
+        return fail(error, translate("Файл повреждён: слишком короткий заголовок."));
+
+    const uchar *base = file->map(0, size);
+    std::shared_ptr<const void> storage;
+    if (base != nullptr) {
+        storage = file;
+    } else {
+        auto buffer = std::make_shared<Buffer>();
+        buffer->bytes = file->readAll();
+        if (buffer->bytes.size() != size)
+            return fail(error, translate("Не удалось прочитать файл: %1").arg(file->errorString()));
+        base = reinterpret_cast<const uchar *>(buffer->bytes.constData());
+        storage = buffer;
+        file->close();
+    }
+
+    if (std::memcmp(base, Magic, sizeof(Magic)) != 0)
+        return fail(error, translate("Неизвестный формат файла."));
+    if (qFromLittleEndian<quint16>(base + 4) != Version)
+        return fail(error, translate("Неподдерживаемая версия формата."));
+
+    const quint16 sectionCount = qFromLittleEndian<quint16>(base + 6);
+    const quint32 width = qFromLittleEndian<quint32>(base + 8);
+    const quint32 height = qFromLittleEndian<quint32>(base + 12);
+    if (width == 0 || height == 0 || width > INT_MAX / 2 || height > INT_MAX / 2)
+        return fail(error, translate("Некорректный размер карты."));
+    if (HeaderSize + quint64(sectionCount) * SectionEntrySize > quint64(size))
+        return fail(error, translate("Файл повреждён: таблица секций обрезана."));
+
+    const quint64 stride = (width + 63) / 64;
+    const quint64 bitsSize = stride * height * sizeof(quint64);
+    const uint64_t *bits = nullptr;
+    const uint8_t *costs = nullptr;
+    MapData result;
+
+    for (int i = 0; i < sectionCount; ++i) {
+        const uchar *entry = base + HeaderSize + i * SectionEntrySize;
+        const quint32 tag = qFromLittleEndian<quint32>(entry);
+        const quint64 offset = qFromLittleEndian<quint64>(entry + 8);
+        const quint64 length = qFromLittleEndian<quint64>(entry + 16);
+        if (offset > quint64(size) || length > quint64(size) - offset || offset % Alignment != 0)
+            return fail(error, translate("Файл повреждён: секция выходит за пределы файла."));
+
+        const uchar *ptr = base + offset;
+        if (tag == BitsTag) {
+            if (length != bitsSize)
+                return fail(error, translate("Файл повреждён: неверный размер маски."));
+            bits = reinterpret_cast<const uint64_t *>(ptr);
+        } else if (tag == CostTag) {
+            if (length != quint64(width) * height)
+                return fail(error, translate("Файл повреждён: неверный размер слоя стоимостей."));
+            costs = ptr;
+        } else if (tag == QueriesTag) {
+            if (length % 16 != 0)
+                return fail(error, translate("Файл повреждён: неверный размер списка запросов."));
+            result.queries.reserve(length / 16);
+            for (quint64 q = 0; q < length; q += 16) {
+                Query query;
+                query.start = Node{qFromLittleEndian<qint32>(ptr + q), qFromLittleEndian<qint32>(ptr + q + 4)};
+                query.goal = Node{qFromLittleEndian<qint32>(ptr + q + 8), qFromLittleEndian<qint32>(ptr + q + 12)};
+                result.queries.push_back(query);
+            }
+        } else {
+            result.indices.insert(tag, QByteArray::fromRawData(reinterpret_cast<const char *>(ptr), qsizetype(length)));
+        }
+    }
+
+    if (bits == nullptr)
+        return fail(error, translate("Файл повреждён: отсутствует маска препятствий."));
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    result.grid = Grid::fromView(int(width), int(height), bits, costs, storage);
+#else
+    // На big-endian платформах слова маски приходится переставлять, поэтому данные копируются
+    result.grid = Grid(int(width), int(height));
+    std::vector<uint64_t> row(stride);
+    for (quint32 y = 0; y < height; ++y) {
+        for (quint32 w = 0; w < stride; ++w)
+            row[w] = qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(bits + quint64(y) * stride + w));
+        result.grid.setRow(int(y), row.data());
+        for (quint32 x = 0; costs != nullptr && x < width; ++x)
+            result.grid.setCost(int(x), int(y), costs[quint64(y) * width + x]);
+    }
+#endif
+    result.storage = storage;
+    data = std::move(result);
+    return true;
+}
+
+/**
+ * @brief Сохранение карты в двоичный файл.
+ *
+ * Файл записывается атомарно через QSaveFile. Байты выравнивания заполняются нулями,
+ * порядок секций фиксирован, поэтому результат детерминирован.
+ *
+ * @param path Путь к файлу.
+ * @param data Сохраняемая карта.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если карта сохранена; false в противном случае.
+ */
+bool save(const QString &path, const MapData &data, QString *error)
+{
+    const Grid &grid = data.grid;
+    if (grid.isEmpty())
+        return fail(error, translate("Карта пуста."));
+
+    QByteArray bits(qsizetype(grid.bitsSize()), Qt::Uninitialized);
+    for (size_t i = 0; i < grid.bitsSize() / sizeof(quint64); ++i)
+        qToLittleEndian<quint64>(grid.bits()[i], bits.data() + i * sizeof(quint64));
+
+    QByteArray queries(qsizetype(data.queries.size() * 16), Qt::Uninitialized);
+    for (size_t i = 0; i < data.queries.size(); ++i) {
+        char *ptr = queries.data() + i * 16;
+        qToLittleEndian<qint32>(data.queries[i].start.x, ptr);
+        qToLittleEndian<qint32>(data.queries[i].start.y, ptr + 4);
+        qToLittleEndian<qint32>(data.queries[i].goal.x, ptr + 8);
+        qToLittleEndian<qint32>(data.queries[i].goal.y, ptr + 12);
+    }
+
+    std::vector<Section> sections;
+    sections.push_back({BitsTag, bits.constData(), quint64(bits.size())});
+    if (grid.hasCosts())
+        sections.push_back({CostTag, reinterpret_cast<const char *>(grid.costs()), quint64(grid.cellCount())});
+    if (!queries.isEmpty())
+        sections.push_back({QueriesTag, queries.constData(), quint64(queries.size())});
+    for (auto it = data.indices.cbegin(); it != data.indices.cend(); ++it) {
+        if (it.key() != BitsTag && it.key() != CostTag && it.key() != QueriesTag)
+            sections.push_back({it.key(), it.value().constData(), quint64(it.value().size())});
+    }
+
+    QByteArray header(HeaderSize + int(sections.size()) * SectionEntrySize, '\0');
+    std::memcpy(header.data(), Magic, sizeof(Magic));
+    qToLittleEndian<quint16>(Version, header.data() + 4);
+    qToLittleEndian<quint16>(quint16(sections.size()), header.data() + 6);
+    qToLittleEndian<quint32>(quint32(grid.width()), header.data() + 8);
+    qToLittleEndian<quint32>(quint32(grid.height()), header.data() + 12);
+
+    quint64 offset = alignUp(quint64(header.size()));
+    for (size_t i = 0; i < sections.size(); ++i) {
+        char *entry = header.data() + HeaderSize + i * SectionEntrySize;
+        qToLittleEndian<quint32>(sections[i].tag, entry);
+        qToLittleEndian<quint64>(offset, entry + 8);
+        qToLittleEndian<quint64>(sections[i].size, entry + 16);
+        offset = alignUp(offset + sections[i].size);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, translate("Не удалось открыть файл: %1").arg(file.errorString()));
+
+    const QByteArray padding(Alignment, '\0');
+    quint64 written = 0;
+    auto write = [&](const char *ptr, quint64 len) {
+        if (len > 0 && file.write(ptr, qint64(len)) != qint64(len))
+            return false;
+        written += len;
+        return true;
+    };
+    auto pad = [&]() { return write(padding.constData(), alignUp(written) - written); };
+
+    bool ok = write(header.constData(), quint64(header.size())) && pad();
+    for (const Section &section : sections)
+        ok = ok && write(section.data, section.size) && pad();
+
+    if (!ok || !file.commit())
+        return fail(error, translate("Не удалось записать файл: %1").arg(file.errorString()));
+    return true;
+}
+
+/**
+ * @brief Загрузка карты в формате findPath или MovingAI (по расширению .map).
+ *
+ * Используется консольными программами, которые принимают карты обоих форматов.
+ *
+ * @param path Путь к файлу.
+ * @param data Структура, в которую загружается карта (у карты MovingAI - только сетка).
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если карта загружена; false в противном случае.
+ */
+bool loadAny(const QString &path, MapData &data, QString *error)
+{
+    if (QFileInfo(path).suffix() == "map")
+        return importMovingAiMap(path, data.grid, error);
+    return load(path, data, error);
+}
+
+/**
+ * @brief Импорт карты в формате MovingAI (.map).
+ *
+ * Проходимыми считаются ячейки '.', 'G' и 'S', остальные символы ('@', 'O', 'T', 'W')
+ * считаются препятствиями.
+ *
+ * @param path Путь к файлу .map.
+ * @param grid Сетка, в которую загружается карта.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если карта загружена; false в противном случае.
+ */
+bool importMovingAiMap(const QString &path, Grid &grid, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return fail(error, translate("Не удалось открыть файл: %1").arg(file.errorString()));
+
+    QTextStream in(&file);
+    int width = 0;
+    int height = 0;
+    while (!in.atEnd()) {
+        const QStringList parts = in.readLine().simplified().split(' ');
+        if (parts.isEmpty())
+            continue;
+        if (parts[0] == "height" && parts.size() > 1)
+            height = parts[1].toInt();
+        else if (parts[0] == "width" && parts.size() > 1)
+            width = parts[1].toInt();
+        else if (parts[0] == "map")
+            break;
+    }
+    if (width <= 0 || height <= 0)
+        return fail(error, translate("Некорректный заголовок карты MovingAI."));
+
+    Grid result(width, height);
+    std::vector<uint64_t> row(size_t(result.stride()));
+    for (int y = 0; y < height; ++y) {
+        if (in.atEnd())
+            return fail(error, translate("Карта MovingAI обрезана: строка %1.").arg(y + 1));
+        const QString line = in.readLine();
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < width; ++x) {
+            const QChar c = x < line.size() ? line[x] : QChar('@');
+            if (c != '.' && c != 'G' && c != 'S')
+                row[size_t(x >> 6)] |= uint64_t(1) << (x & 63);
+        }
+        result.setRow(y, row.data());
+    }
+    grid = std::move(result);
+    return true;
+}
+
+/**
+ * @brief Импорт сценария в формате MovingAI (.scen).
+ *
+ * Каждая строка сценария содержит: номер группы, имя карты, размеры карты,
+ * координаты начала, координаты конца и длину оптимального пути.
+ *
+ * @param path Путь к файлу .scen.
+ * @param queries Список, в который загружаются запросы.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если сценарий загружен; false в противном случае.
+ */
+bool importMovingAiScenario(const QString &path, std::vector<Query> &queries, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return fail(error, translate("Не удалось открыть файл: %1").arg(file.errorString()));
+
+    QTextStream in(&file);
+    std::vector<Query> result;
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QStringList parts = in.readLine().simplified().split(' ', Qt::SkipEmptyParts);
+        ++lineNumber;
+        if (parts.isEmpty() || parts[0] == "version")
+            continue;
+        if (parts.size() < 8)
+            return fail(error, translate("Некорректная строка сценария: %1.").arg(lineNumber));
+
+        Query query;
+        query.start = Node{parts[4].toInt(), parts[5].toInt()};
+        query.goal = Node{parts[6].toInt(), parts[7].toInt()};
+        result.push_back(query);
+    }
+    queries = std::move(result);
+    return true;
+}
+
+}
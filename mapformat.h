@@ -0,0 +1,58 @@
+#pragma once
+
+#include "grid.h"
+#include "pathfinding.h"
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Содержимое файла карты.
+ *
+ * Сетка и секции индексов, загруженные из файла, ссылаются на отображённую в память
+ * область файла; storage удерживает её, пока жив объект MapData или копии сетки.
+ */
+struct MapData {
+    Grid grid;                              /**< Сетка препятствий. */
+    std::vector<Query> queries;             /**< Список запросов. */
+    QMap<quint32, QByteArray> indices;      /**< Секции предвычисленных индексов по тегу. */
+    std::shared_ptr<const void> storage;    /**< Владелец отображённой памяти. */
+};
+
+/**
+ * @brief Двоичный формат карт findPath и импорт карт MovingAI.
+ *
+ * Файл состоит из заголовка, таблицы секций и самих секций, каждая из которых выровнена
+ * по 64 байтам. Все числа записываются в порядке little-endian. Секции:
+ *  - BITS — битовая маска блокировок, stride 64-битных слов на строку;
+ *  - COST — стоимости ячеек, по байту на ячейку (необязательная);
+ *  - QRYS — запросы, по четыре int32 (sx, sy, gx, gy) на запрос (необязательная);
+ *  - любые другие теги — предвычисленные индексы (необязательные), например FMOV —
+ *    таблица первых ходов (FirstMoveTable::serialize()).
+ * Запись детерминирована: одинаковые данные всегда дают одинаковый файл.
+ */
+namespace MapFormat {
+
+/** @brief Построение тега секции из четырёх символов. */
+constexpr quint32 tag(char a, char b, char c, char d)
+{
+    return quint32(quint8(a)) | (quint32(quint8(b)) << 8) | (quint32(quint8(c)) << 16) | (quint32(quint8(d)) << 24);
+}
+
+constexpr quint32 BitsTag = tag('B', 'I', 'T', 'S');     /**< Тег секции маски. */
+constexpr quint32 CostTag = tag('C', 'O', 'S', 'T');     /**< Тег секции стоимостей. */
+constexpr quint32 QueriesTag = tag('Q', 'R', 'Y', 'S');  /**< Тег секции запросов. */
+constexpr quint32 FirstMoveTag = tag('F', 'M', 'O', 'V');    /**< Тег индекса: таблица первых ходов (FirstMoveTable). */
+
+bool load(const QString &path, MapData &data, QString *error = nullptr);
+bool save(const QString &path, const MapData &data, QString *error = nullptr);
+bool loadAny(const QString &path, MapData &data, QString *error = nullptr);
+
+bool importMovingAiMap(const QString &path, Grid &grid, QString *error = nullptr);
+bool importMovingAiScenario(const QString &path, std::vector<Query> &queries, QString *error = nullptr);
+
+}
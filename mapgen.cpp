@@ -0,0 +1,260 @@
+#include "mapgen.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Поиск случайной свободной ячейки в полосе [x0, x1) сетки.
+ *
+ * @return Свободная ячейка или ячейка {-1, -1}, если найти ее не удалось.
+ */
+Node randomFreeCell(const Grid &grid, SplitMix64 &rng, int x0, int x1)
+{
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        int x = x0 + rng.bounded(x1 - x0);
+        int y = rng.bounded(grid.height());
+        if (!grid.isBlocked(x, y))
+            return Node{x, y};
+    }
+    return Node{-1, -1};
+}
+
+}
+
+namespace MapGen {
+
+/**
+ * @brief Случайная карта с заданной плотностью препятствий.
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param density Вероятность того, что ячейка заблокирована.
+ * @param seed Начальное значение генератора.
+ * @return Сгенерированная сетка.
+ */
+Grid randomGrid(int width, int height, double density, uint64_t seed)
+{
+    Grid grid(width, height);
+    SplitMix64 rng(seed);
+    std::vector<uint64_t> row(size_t(grid.stride()));
+    for (int y = 0; y < height; ++y) {
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < width; ++x) {
+            if (rng.chance(density))
+                row[size_t(x >> 6)] |= uint64_t(1) << (x & 63);
+        }
+        grid.setRow(y, row.data());
+    }
+    return grid;
+}
+
+/**
+ * @brief Лабиринт, построенный обходом в глубину.
+ *
+ * Проходы лежат в ячейках с четными координатами, между ними прорубаются стены.
+ * Все свободные ячейки лабиринта связаны, а путь между ними единственный.
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param seed Начальное значение генератора.
+ * @return Сгенерированная сетка.
+ */
+Grid mazeGrid(int width, int height, uint64_t seed)
+{
+    Grid grid(width, height);
+    grid.fill(true);
+    if (grid.isEmpty())
+        return grid;
+
+    SplitMix64 rng(seed);
+    const int cw = (width + 1) / 2;
+    const int ch = (height + 1) / 2;
+    std::vector<char> visited(size_t(cw) * ch, 0);
+    std::vector<std::pair<int, int>> stack {{0, 0}};
+    visited[0] = 1;
+    grid.setBlocked(0, 0, false);
+
+    const int dx[4] = {1, -1, 0, 0};
+    const int dy[4] = {0, 0, 1, -1};
+    while (!stack.empty()) {
+        auto [cx, cy] = stack.back();
+        int options[4];
+        int count = 0;
+        for (int d = 0; d < 4; ++d) {
+            int nx = cx + dx[d];
+            int ny = cy + dy[d];
+            if (nx >= 0 && nx < cw && ny >= 0 && ny < ch && !visited[size_t(ny) * cw + nx])
+                options[count++] = d;
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        int d = options[rng.bounded(count)];
+        int nx = cx + dx[d];
+        int ny = cy + dy[d];
+        visited[size_t(ny) * cw + nx] = 1;
+        grid.setBlocked(cx * 2 + dx[d], cy * 2 + dy[d], false);
+        grid.setBlocked(nx * 2, ny * 2, false);
+        stack.push_back({nx, ny});
+    }
+    return grid;
+}
+
+/**
+ * @brief Случайная карта, разделенная сплошной вертикальной стеной посередине.
+ *
+ * Левая и правая половины не связаны, поэтому запросы через стену не имеют решения.
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param density Вероятность того, что ячейка заблокирована.
+ * @param seed Начальное значение генератора.
+ * @return Сгенерированная сетка.
+ */
+Grid splitGrid(int width, int height, double density, uint64_t seed)
+{
+    Grid grid = randomGrid(width, height, density, seed);
+    for (int y = 0; y < height; ++y)
+        grid.setBlocked(width / 2, y, true);
+    return grid;
+}
+
+/**
+ * @brief Случайная карта местности со стоимостями ячеек.
+ *
+ * Препятствия расставляются как в randomGrid() (с тем же seed - те же препятствия), а
+ * стоимости плавно меняются по карте: они интерполируются между случайными значениями
+ * в узлах решетки с шагом TerrainScale ячеек, поэтому рядом лежат дешевые "равнины" и
+ * дорогие "холмы".
+ *
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param density Вероятность того, что ячейка заблокирована.
+ * @param maxCost Наибольшая стоимость ячейки (1..255).
+ * @param seed Начальное значение генератора.
+ * @return Сгенерированная сетка.
+ */
+Grid terrainGrid(int width, int height, double density, int maxCost, uint64_t seed)
+{
+    const int TerrainScale = 16;
+    Grid grid = randomGrid(width, height, density, seed);
+    if (grid.isEmpty())
+        return grid;
+
+    maxCost = std::max(1, std::min(255, maxCost));
+    const int lw = width / TerrainScale + 2;
+    const int lh = height / TerrainScale + 2;
+    std::vector<double> lattice(size_t(lw) * lh);
+    SplitMix64 rng(seed ^ 0x7465727261696Eull);
+    for (double &value : lattice)
+        value = double(rng.next() >> 11) * 0x1.0p-53;
+
+    for (int y = 0; y < height; ++y) {
+        const int ly = y / TerrainScale;
+        const double fy = double(y % TerrainScale) / TerrainScale;
+        for (int x = 0; x < width; ++x) {
+            const int lx = x / TerrainScale;
+            const double fx = double(x % TerrainScale) / TerrainScale;
+            const double *row0 = &lattice[size_t(ly) * lw + lx];
+            const double *row1 = row0 + lw;
+            const double top = row0[0] + (row0[1] - row0[0]) * fx;
+            const double bottom = row1[0] + (row1[1] - row1[0]) * fx;
+            const double value = top + (bottom - top) * fy;
+            grid.setCost(x, y, uint8_t(1 + int(value * (maxCost - 1) + 0.5)));
+        }
+    }
+    return grid;
+}
+
+/**
+ * @brief Случайные запросы между свободными ячейками.
+ *
+ * @param grid Сетка препятствий.
+ * @param count Количество запросов.
+ * @param seed Начальное значение генератора.
+ * @return Список запросов (может быть короче count, если свободных ячеек почти нет).
+ */
+std::vector<Query> randomQueries(const Grid &grid, int count, uint64_t seed)
+{
+    std::vector<Query> queries;
+    if (grid.isEmpty())
+        return queries;
+
+    SplitMix64 rng(seed);
+    for (int i = 0; i < count; ++i) {
+        Node start = randomFreeCell(grid, rng, 0, grid.width());
+        Node goal = randomFreeCell(grid, rng, 0, grid.width());
+        if (start.x >= 0 && goal.x >= 0)
+            queries.push_back({start, goal});
+    }
+    return queries;
+}
+
+/**
+ * @brief Запросы из левой половины карты в правую.
+ *
+ * Предназначены для карт splitGrid: ни один из этих запросов не имеет решения.
+ *
+ * @param grid Сетка препятствий.
+ * @param count Количество запросов.
+ * @param seed Начальное значение генератора.
+ * @return Список запросов.
+ */
+std::vector<Query> splitQueries(const Grid &grid, int count, uint64_t seed)
+{
+    std::vector<Query> queries;
+    if (grid.width() < 3)
+        return queries;
+
+    SplitMix64 rng(seed);
+    for (int i = 0; i < count; ++i) {
+        Node start = randomFreeCell(grid, rng, 0, grid.width() / 2);
+        Node goal = randomFreeCell(grid, rng, grid.width() / 2 + 1, grid.width());
+        if (start.x >= 0 && goal.x >= 0)
+            queries.push_back({start, goal});
+    }
+    return queries;
+}
+
+/**
+ * @brief Задания для нескольких агентов.
+ *
+ * Все начальные ячейки различны и все конечные ячейки различны, как требуется для
+ * планирования путей без столкновений. Если свободных ячеек не хватает, заданий
+ * возвращается меньше.
+ *
+ * @param grid Сетка препятствий.
+ * @param count Количество агентов.
+ * @param seed Начальное значение генератора.
+ * @return Начальная и конечная точка каждого агента.
+ */
+std::vector<Query> agentQueries(const Grid &grid, int count, uint64_t seed)
+{
+    std::vector<Query> agents;
+    if (grid.isEmpty())
+        return agents;
+
+    SplitMix64 rng(seed);
+    std::vector<uint8_t> used(grid.cellCount(), 0);   // бит 0 - занята как начало, бит 1 - как цель
+    for (int i = 0, attempts = 0; i < count && attempts < count * 100; ++attempts) {
+        Node start = randomFreeCell(grid, rng, 0, grid.width());
+        Node goal = randomFreeCell(grid, rng, 0, grid.width());
+        if (start.x < 0 || goal.x < 0)
+            break;
+        uint8_t &startUse = used[size_t(start.y) * grid.width() + start.x];
+        uint8_t &goalUse = used[size_t(goal.y) * grid.width() + goal.x];
+        if ((startUse & 1) || (goalUse & 2))
+            continue;
+        startUse |= 1;
+        goalUse |= 2;
+        agents.push_back({start, goal});
+        ++i;
+    }
+    return agents;
+}
+
+}
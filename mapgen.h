@@ -0,0 +1,51 @@
+#pragma once
+
+#include "grid.h"
+#include "pathfinding.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Детерминированный генератор псевдослучайных чисел (splitmix64).
+ *
+ * В отличие от распределений стандартной библиотеки дает одинаковую последовательность
+ * на всех компиляторах и платформах, поэтому карты и запросы воспроизводимы по seed.
+ */
+class SplitMix64
+{
+public:
+    explicit SplitMix64(uint64_t seed) : m_state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /** @brief Случайное число в диапазоне [0, bound). */
+    int bounded(int bound) { return int(next() % uint64_t(bound)); }
+
+    /** @brief Случайное событие с вероятностью probability. */
+    bool chance(double probability) { return double(next() >> 11) * 0x1.0p-53 < probability; }
+
+private:
+    uint64_t m_state;   /**< Текущее состояние генератора. */
+};
+
+/**
+ * @brief Генераторы воспроизводимых карт и запросов для тестов и бенчмарков.
+ */
+namespace MapGen {
+
+Grid randomGrid(int width, int height, double density, uint64_t seed);
+Grid mazeGrid(int width, int height, uint64_t seed);
+Grid splitGrid(int width, int height, double density, uint64_t seed);
+Grid terrainGrid(int width, int height, double density, int maxCost, uint64_t seed);
+
+std::vector<Query> randomQueries(const Grid &grid, int count, uint64_t seed);
+std::vector<Query> splitQueries(const Grid &grid, int count, uint64_t seed);
+std::vector<Query> agentQueries(const Grid &grid, int count, uint64_t seed);
+
+}
@@ -0,0 +1,161 @@
+#include "minimap.h"
+#include "gridpyramid.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+
+/**
+ * @brief Конструктор класса MiniMap.
+ *
+ * @param parent Указатель на родительский виджет.
+ */
+MiniMap::MiniMap(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumSize(100, 100);
+    setCursor(Qt::PointingHandCursor);
+}
+
+/**
+ * @brief Установка отображаемой пирамиды.
+ *
+ * @param pyramid Уменьшенные изображения сетки (может быть nullptr).
+ * @param cellSize Размер ячейки на сцене.
+ */
+void MiniMap::setPyramid(const GridPyramid *pyramid, int cellSize)
+{
+    m_pyramid = pyramid;
+    m_cellSize = qMax(1, cellSize);
+    m_viewRect = QRectF();
+    m_path = QPainterPath();
+    update();
+}
+
+/**
+ * @brief Установка видимой области основного представления.
+ *
+ * @param rect Видимая область в координатах сцены.
+ */
+void MiniMap::setViewRect(const QRectF &rect)
+{
+    m_viewRect = QRectF(rect.x() / m_cellSize + 1, rect.y() / m_cellSize + 1, rect.width() / m_cellSize,
+                        rect.height() / m_cellSize);
+    update();
+}
+
+/**
+ * @brief Установка показываемого пути.
+ *
+ * Каждый прямолинейный участок пути становится одним отрезком линии.
+ *
+ * @param path Компактный путь (пустой - путь не показывается).
+ */
+void MiniMap::setPath(const CompactPath &path)
+{
+    m_path = QPainterPath();
+    if (!path.empty()) {
+        Node from = path.front();
+        m_path.moveTo(from.x + 0.5, from.y + 0.5);
+        for (size_t i = 0; i < path.steps(); ) {
+            const CompactPath::Direction d = path.direction(i);
+            size_t run = 1;
+            while (i + run < path.steps() && path.direction(i + run) == d)
+                ++run;
+            from = Node{from.x + CompactPath::dx[d] * int(run), from.y + CompactPath::dy[d] * int(run)};
+            m_path.lineTo(from.x + 0.5, from.y + 0.5);
+            i += run;
+        }
+    }
+    update();
+}
+
+/**
+ * @brief Прямоугольник виджета, в котором рисуется сетка.
+ *
+ * @return Наибольший прямоугольник с пропорциями сетки, вписанный в виджет по центру.
+ */
+QRectF MiniMap::mapRect() const
+{
+    if (m_pyramid == nullptr || m_pyramid->isEmpty())
+        return QRectF();
+    const QRectF area = QRectF(rect()).adjusted(2, 2, -2, -2);
+    const qreal scale = qMin(area.width() / m_pyramid->width(), area.height() / m_pyramid->height());
+    QRectF target(0, 0, m_pyramid->width() * scale, m_pyramid->height() * scale);
+    target.moveCenter(area.center());
+    return target;
+}
+
+/**
+ * @brief Отрисовка миникарты.
+ *
+ * Рисует уровень пирамиды, в котором пиксель покрывает примерно столько ячеек, сколько
+ * приходится на пиксель виджета, затем путь и рамку видимой области.
+ *
+ * @param event Событие отрисовки (не используется).
+ */
+void MiniMap::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    const QRectF target = mapRect();
+    if (target.isEmpty())
+        return;
+
+    const int level = m_pyramid->levelFor(m_pyramid->width() / target.width());
+    const qreal scale = 1 << level;
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, m_pyramid->level(level),
+                      QRectF(0, 0, m_pyramid->width() / scale, m_pyramid->height() / scale));
+
+    painter.translate(target.topLeft());
+    painter.scale(target.width() / m_pyramid->width(), target.height() / m_pyramid->height());
+    QPen pen(Qt::red, 2);
+    pen.setCosmetic(true);
+    painter.setPen(pen);
+    painter.drawPath(m_path);
+
+    if (!m_viewRect.isEmpty()) {
+        QPen frame(Qt::blue, 1);
+        frame.setCosmetic(true);
+        painter.setPen(frame);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(m_viewRect);
+    }
+}
+
+/**
+ * @brief Обработчик события нажатия мыши: переход к выбранной точке.
+ *
+ * @param event Указатель на событие нажатия мыши.
+ */
+void MiniMap::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton)
+        jumpTo(event->position());
+}
+
+/**
+ * @brief Обработчик события перемещения мыши: перетаскивание видимой области.
+ *
+ * @param event Указатель на событие перемещения мыши.
+ */
+void MiniMap::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton)
+        jumpTo(event->position());
+}
+
+/**
+ * @brief Перевод точки виджета в координаты сцены и запрос перехода.
+ *
+ * @param pos Точка виджета.
+ */
+void MiniMap::jumpTo(const QPointF &pos)
+{
+    const QRectF target = mapRect();
+    if (target.isEmpty())
+        return;
+    const qreal x = (pos.x() - target.left()) * m_pyramid->width() / target.width();
+    const qreal y = (pos.y() - target.top()) * m_pyramid->height() / target.height();
+    emit jumpRequested(QPointF((x - 1) * m_cellSize, (y - 1) * m_cellSize));
+}
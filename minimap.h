@@ -0,0 +1,48 @@
+#pragma once
+
+#include "compactpath.h"
+
+#include <QPainterPath>
+#include <QWidget>
+
+class GridPyramid;
+
+/**
+ * @brief Миникарта (MiniMap).
+ *
+ * Показывает всю сетку по уровню пирамиды уменьшенных изображений, размер которого
+ * ближе всего к размеру виджета, найденный путь и рамку видимой области основного
+ * представления. Нажатие или перетаскивание левой кнопкой мыши перемещает видимую
+ * область в выбранную точку (сигнал jumpRequested()).
+ *
+ * Координаты сцены переводятся в координаты ячеек по размеру ячейки так же, как в GridItem.
+ */
+class MiniMap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit MiniMap(QWidget *parent = nullptr);
+
+    void setPyramid(const GridPyramid *pyramid, int cellSize);
+    void setViewRect(const QRectF &rect);
+    void setPath(const CompactPath &path);
+
+    QSize sizeHint() const override { return QSize(200, 200); }
+
+signals:
+    void jumpRequested(const QPointF &scenePos);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    const GridPyramid *m_pyramid {nullptr}; /**< Уменьшенные изображения сетки. */
+    int m_cellSize {1};                     /**< Размер ячейки на сцене. */
+    QRectF m_viewRect;                      /**< Видимая область основного представления (в ячейках). */
+    QPainterPath m_path;                    /**< Линия пути (в ячейках). */
+
+    QRectF mapRect() const;
+    void jumpTo(const QPointF &pos);
+};
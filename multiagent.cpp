@@ -0,0 +1,612 @@
+#include "multiagent.h"
+#include "compactpath.h"
+#include "parallel.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <memory_resource>
+#include <queue>
+#include <unordered_set>
+
+namespace {
+
+const int dx[5] = {1, 0, -1, 0, 0};     // четыре перехода и ожидание
+const int dy[5] = {0, 1, 0, -1, 0};
+
+/**
+ * @brief Направление перехода между соседними ячейками (индекс в dx/dy).
+ */
+int direction(const Node &from, const Node &to)
+{
+    if (to.x > from.x)
+        return 0;
+    if (to.y > from.y)
+        return 1;
+    return to.x < from.x ? 2 : 3;
+}
+
+uint64_t vertexKey(int cell, int t)
+{
+    return uint64_t(uint32_t(cell)) << 32 | uint32_t(t);
+}
+
+uint64_t moveKey(int cell, int dir, int t)
+{
+    return (uint64_t(uint32_t(cell)) << 2 | uint64_t(dir)) << 32 | uint32_t(t);
+}
+
+/**
+ * @brief Состояние поиска в пространстве-времени.
+ */
+struct SpaceTimeState {
+    int x;          /**< Координата x. */
+    int y;          /**< Координата y. */
+    int t;          /**< Момент времени (он же стоимость пути). */
+    int parent;     /**< Индекс предыдущего состояния или -1. */
+};
+
+/**
+ * @brief Элемент открытого списка: при равной оценке раньше раскрываются более поздние состояния.
+ */
+struct SpaceTimeEntry {
+    int f;          /**< Оценка полной стоимости. */
+    int t;          /**< Момент времени состояния. */
+    int state;      /**< Индекс состояния. */
+    bool operator<(const SpaceTimeEntry &o) const { return f > o.f || (f == o.f && t < o.t); }
+};
+
+/**
+ * @brief Длины кратчайших путей агентов без учета других агентов (-1, если цель недостижима).
+ */
+std::vector<int> staticDistances(const Grid &grid, const std::vector<Query> &agents, Parallel::WorkerPool &pool)
+{
+    std::vector<int> distances(agents.size(), -1);
+    pool.run(int(agents.size()), [&](int i) {
+        const CompactPath path = a_star_search_compact(grid, agents[i].start, agents[i].goal);
+        distances[i] = path.empty() ? -1 : int(path.steps());
+    });
+    return distances;
+}
+
+/**
+ * @brief Поиск пути агента с ограничением времени, достаточным для обхода резервирований.
+ */
+std::vector<Node> planAgent(const Grid &grid, const Query &agent, int distance, const ReservationTable &table,
+                            SearchStats &stats)
+{
+    const int maxTime = table.horizon() + distance + grid.width() + grid.height();
+    return space_time_a_star(grid, agent.start, agent.goal, table, maxTime, &stats);
+}
+
+/**
+ * @brief Подсчет итоговых характеристик плана.
+ */
+void summarize(MultiAgentPlan &plan)
+{
+    plan.failed = 0;
+    plan.sumOfCosts = 0;
+    plan.makespan = 0;
+    for (const std::vector<Node> &path : plan.paths) {
+        if (path.empty()) {
+            ++plan.failed;
+            continue;
+        }
+        plan.sumOfCosts += static_cast<long long>(path.size()) - 1;
+        plan.makespan = std::max(plan.makespan, int(path.size()) - 1);
+    }
+}
+
+/**
+ * @brief Ограничение CBS: агенту запрещено быть в ячейке to в момент t
+ *        или (если edge) переходить из from в to между t и t + 1.
+ */
+struct Constraint {
+    int agent;
+    Node from;
+    Node to;
+    int t;
+    bool edge;
+};
+
+/**
+ * @brief Конфликт двух агентов.
+ */
+struct Conflict {
+    int a;          /**< Первый агент. */
+    int b;          /**< Второй агент. */
+    Node u;         /**< Ячейка конфликта (или ячейка, из которой переходит a). */
+    Node v;         /**< Ячейка, в которую переходит a при встречном обмене. */
+    int t;          /**< Момент конфликта. */
+    bool edge;      /**< Встречный обмен ячейками. */
+};
+
+/**
+ * @brief Узел дерева ограничений CBS.
+ *
+ * Хранит только добавленное ограничение и новый путь одного агента; остальные
+ * ограничения и пути берутся у предков.
+ */
+struct CbsNode {
+    int parent;                 /**< Индекс родителя (-1 у корня). */
+    Constraint constraint;      /**< Добавленное ограничение (agent = -1 у корня). */
+    std::vector<Node> path;     /**< Новый путь агента constraint.agent. */
+    long long cost;             /**< Сумма стоимостей путей. */
+    int conflicts;              /**< Количество конфликтов. */
+};
+
+/**
+ * @brief Элемент открытого списка CBS: меньшая стоимость, затем меньше конфликтов.
+ */
+struct CbsEntry {
+    long long cost;
+    int conflicts;
+    int node;
+    bool operator<(const CbsEntry &o) const {
+        return cost > o.cost || (cost == o.cost && conflicts > o.conflicts);
+    }
+};
+
+/**
+ * @brief Пути всех агентов в узле дерева ограничений.
+ */
+std::vector<const std::vector<Node> *> nodePaths(const std::vector<CbsNode> &nodes, int index,
+                                                 const std::vector<std::vector<Node>> &rootPaths)
+{
+    std::vector<const std::vector<Node> *> paths(rootPaths.size(), nullptr);
+    for (int i = index; i >= 0; i = nodes[i].parent) {
+        const int agent = nodes[i].constraint.agent;
+        if (agent >= 0 && paths[agent] == nullptr)
+            paths[agent] = &nodes[i].path;
+    }
+    for (size_t agent = 0; agent < paths.size(); ++agent) {
+        if (paths[agent] == nullptr)
+            paths[agent] = &rootPaths[agent];
+    }
+    return paths;
+}
+
+/**
+ * @brief Таблица резервирования из ограничений агента в узле дерева.
+ */
+ReservationTable constraintTable(const std::vector<CbsNode> &nodes, int index, int agent, int width)
+{
+    ReservationTable table(width);
+    for (int i = index; i >= 0; i = nodes[i].parent) {
+        const Constraint &c = nodes[i].constraint;
+        if (c.agent != agent)
+            continue;
+        if (c.edge)
+            table.reserveMove(c.to, c.from, c.t);   // встречный переход запрещает from -> to
+        else
+            table.reserveVertex(c.to, c.t);
+    }
+    return table;
+}
+
+/**
+ * @brief Поиск конфликтов между путями.
+ *
+ * @param paths Пути агентов (пустые пути не учитываются).
+ * @param first Первый по времени конфликт (если есть).
+ * @return Количество конфликтов.
+ */
+int findConflicts(const std::vector<const std::vector<Node> *> &paths, Conflict &first)
+{
+    int makespan = 0;
+    for (const std::vector<Node> *path : paths)
+        makespan = std::max(makespan, int(path->size()) - 1);
+
+    int count = 0;
+    std::unordered_map<uint64_t, int> occupied;
+    for (int t = 0; t <= makespan; ++t) {
+        occupied.clear();
+        for (int agent = 0; agent < int(paths.size()); ++agent) {
+            const std::vector<Node> &path = *paths[agent];
+            if (path.empty())
+                continue;
+            const Node cell = positionAt(path, t);
+            const uint64_t key = uint64_t(uint32_t(cell.x)) << 32 | uint32_t(cell.y);
+            auto it = occupied.emplace(key, agent);
+            if (!it.second && count++ == 0)
+                first = {it.first->second, agent, cell, cell, t, false};
+        }
+        if (t == makespan)
+            break;
+        // Встречные обмены: агент переходит в ячейку, из которой другой переходит в его
+        for (int agent = 0; agent < int(paths.size()); ++agent) {
+            const std::vector<Node> &path = *paths[agent];
+            if (path.empty())
+                continue;
+            const Node u = positionAt(path, t);
+            const Node v = positionAt(path, t + 1);
+            if (u == v)
+                continue;
+            auto it = occupied.find(uint64_t(uint32_t(v.x)) << 32 | uint32_t(v.y));
+            if (it == occupied.end() || it->second <= agent)
+                continue;
+            if (positionAt(*paths[it->second], t + 1) == u && count++ == 0)
+                first = {agent, it->second, u, v, t, true};
+        }
+    }
+    return count;
+}
+
+}
+
+/**
+ * @brief Конструктор таблицы.
+ *
+ * @param width Ширина сетки.
+ */
+ReservationTable::ReservationTable(int width)
+    : m_width(width)
+{
+}
+
+/**
+ * @brief Резервирование ячейки в момент времени t.
+ */
+void ReservationTable::reserveVertex(const Node &cell, int t)
+{
+    const int i = index(cell);
+    m_vertices.insert(vertexKey(i, t));
+    int &last = m_last.emplace(i, t).first->second;
+    last = std::max(last, t);
+    m_horizon = std::max(m_horizon, t);
+}
+
+/**
+ * @brief Резервирование перехода из from в соседнюю ячейку to между t и t + 1.
+ *
+ * Запрещает другим агентам встречный переход из to в from в то же время.
+ * Ячейка to в момент t + 1 резервируется отдельно (reserveVertex()).
+ */
+void ReservationTable::reserveMove(const Node &from, const Node &to, int t)
+{
+    if (from == to)
+        return;
+    m_moves.insert(moveKey(index(from), direction(from, to), t));
+    m_horizon = std::max(m_horizon, t + 1);
+}
+
+/**
+ * @brief Резервирование ячейки на все моменты времени начиная с t.
+ */
+void ReservationTable::reserveForever(const Node &cell, int t)
+{
+    int &from = m_forever.emplace(index(cell), t).first->second;
+    from = std::min(from, t);
+    m_horizon = std::max(m_horizon, t);
+}
+
+/**
+ * @brief Резервирование пути агента, который затем остается на цели.
+ *
+ * @param path Положения агента по шагам времени.
+ */
+void ReservationTable::reservePath(const std::vector<Node> &path)
+{
+    if (path.empty())
+        return;
+    for (size_t t = 0; t < path.size(); ++t) {
+        reserveVertex(path[t], int(t));
+        if (t + 1 < path.size())
+            reserveMove(path[t], path[t + 1], int(t));
+    }
+    reserveForever(path.back(), int(path.size()) - 1);
+}
+
+/**
+ * @brief Проверка, свободна ли ячейка в момент t.
+ */
+bool ReservationTable::isVertexFree(const Node &cell, int t) const
+{
+    const int i = index(cell);
+    auto forever = m_forever.find(i);
+    if (forever != m_forever.end() && t >= forever->second)
+        return false;
+    return m_vertices.count(vertexKey(i, t)) == 0;
+}
+
+/**
+ * @brief Проверка, допустим ли переход из from в to между t и t + 1.
+ *
+ * @param from Текущая ячейка.
+ * @param to Соседняя ячейка или from (ожидание).
+ * @param t Момент начала перехода.
+ * @return true, если to свободна в момент t + 1 и никто не переходит навстречу.
+ */
+bool ReservationTable::isMoveFree(const Node &from, const Node &to, int t) const
+{
+    if (!isVertexFree(to, t + 1))
+        return false;
+    return from == to || m_moves.count(moveKey(index(to), direction(to, from), t)) == 0;
+}
+
+/**
+ * @brief Проверка, что путь не конфликтует с резервированиями.
+ *
+ * Учитывает и то, что после прибытия агент остается на цели.
+ */
+bool ReservationTable::isPathFree(const std::vector<Node> &path) const
+{
+    if (path.empty() || !isVertexFree(path.front(), 0))
+        return false;
+    for (size_t t = 0; t + 1 < path.size(); ++t) {
+        if (!isMoveFree(path[t], path[t + 1], int(t)))
+            return false;
+    }
+    return lastReserved(path.back()) < int(path.size()) - 1;
+}
+
+/**
+ * @brief Последний момент времени, в который ячейка занята.
+ *
+ * @return Момент времени; -1, если ячейка не занята никогда; INT_MAX, если занята навсегда.
+ */
+int ReservationTable::lastReserved(const Node &cell) const
+{
+    const int i = index(cell);
+    if (m_forever.count(i) != 0)
+        return INT_MAX;
+    auto it = m_last.find(i);
+    return it != m_last.end() ? it->second : -1;
+}
+
+/**
+ * @brief Проверка отсутствия резервирований.
+ */
+bool ReservationTable::empty() const
+{
+    return m_vertices.empty() && m_moves.empty() && m_forever.empty();
+}
+
+/**
+ * @brief Удаление всех резервирований.
+ */
+void ReservationTable::clear()
+{
+    m_vertices.clear();
+    m_moves.clear();
+    m_forever.clear();
+    m_last.clear();
+    m_horizon = 0;
+}
+
+/**
+ * @brief Положение агента в момент времени t.
+ */
+Node positionAt(const std::vector<Node> &path, int t)
+{
+    return path[std::min<size_t>(size_t(std::max(t, 0)), path.size() - 1)];
+}
+
+/**
+ * @brief Поиск A* в пространстве-времени.
+ *
+ * Стоимость пути равна времени, поэтому каждое состояние (ячейка, время) достигается
+ * с единственной стоимостью и добавляется в открытый список не более одного раза.
+ * Эвристика - манхэттенское расстояние; состояния, из которых цель недостижима
+ * к моменту maxTime, не добавляются. Состояние поиска размещается в арене потока.
+ */
+std::vector<Node> space_time_a_star(const Grid &grid, const Node &start, const Node &goal,
+                                    const ReservationTable &table, int maxTime, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    if (!grid.isFree(start.x, start.y) || !grid.isFree(goal.x, goal.y) || !table.isVertexFree(start, 0))
+        return {};
+    const int goalFree = table.lastReserved(goal);
+    if (goalFree == INT_MAX)
+        return {};
+
+    ArenaScope arena;
+    std::pmr::memory_resource *memory = arena.resource();
+
+    const int width = grid.width();
+    auto heuristic = [&goal](int x, int y) { return std::abs(x - goal.x) + std::abs(y - goal.y); };
+    std::pmr::vector<SpaceTimeState> states(memory);
+    std::pmr::unordered_set<uint64_t> visited(memory);
+    std::priority_queue<SpaceTimeEntry, std::pmr::vector<SpaceTimeEntry>> open_set{
+        std::less<SpaceTimeEntry>(), std::pmr::vector<SpaceTimeEntry>(memory)};
+
+    states.push_back({start.x, start.y, 0, -1});
+    visited.insert(vertexKey(start.y * width + start.x, 0));
+    open_set.push({heuristic(start.x, start.y), 0, 0});
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, 1));
+
+    while (!open_set.empty()) {
+        const SpaceTimeEntry entry = open_set.top();
+        open_set.pop();
+        const SpaceTimeState current = states[entry.state];
+        SEARCH_STATS(stats, ++stats->expansions;
+                     if (stats->recordExpansions) stats->expansionOrder.push_back(current.y * width + current.x));
+
+        if (current.x == goal.x && current.y == goal.y && current.t > goalFree) {
+            SEARCH_STATS(stats, stats->peakMemoryBytes = std::max<long long>(stats->peakMemoryBytes, arena.bytesUsed()));
+            std::vector<Node> path(size_t(current.t) + 1, Node{0, 0});
+            for (int s = entry.state; s >= 0; s = states[s].parent)
+                path[states[s].t] = Node{states[s].x, states[s].y};
+            return path;
+        }
+
+        const Node from {current.x, current.y};
+        const int t = current.t + 1;
+        for (int d = 0; d < 5; ++d) {
+            const Node to {current.x + dx[d], current.y + dy[d]};
+            if (!grid.isFree(to.x, to.y) || t + heuristic(to.x, to.y) > maxTime)
+                continue;
+            if (!table.isMoveFree(from, to, current.t))
+                continue;
+            if (!visited.insert(vertexKey(to.y * width + to.x, t)).second)
+                continue;
+            states.push_back({to.x, to.y, t, entry.state});
+            open_set.push({t + heuristic(to.x, to.y), t, int(states.size()) - 1});
+            SEARCH_STATS(stats, ++stats->pushes;
+                         stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, open_set.size()));
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max<long long>(stats->peakMemoryBytes, arena.bytesUsed()));
+    return {};
+}
+
+/**
+ * @brief Приоритетное планирование путей нескольких агентов.
+ *
+ * Агенты с недостижимыми целями отбрасываются заранее (длины путей без учета других
+ * агентов вычисляются параллельно и задают ограничение времени поиска).
+ */
+MultiAgentPlan prioritized_planning(const Grid &grid, const std::vector<Query> &agents, int threads)
+{
+    const auto started = std::chrono::steady_clock::now();
+    threads = Parallel::threadCount(threads);
+    Parallel::WorkerPool pool(threads);
+    MultiAgentPlan plan;
+    plan.paths.resize(agents.size());
+
+    const std::vector<int> distances = staticDistances(grid, agents, pool);
+    std::vector<int> order;
+    for (size_t i = 0; i < agents.size(); ++i) {
+        if (distances[i] >= 0)
+            order.push_back(int(i));
+    }
+
+    ReservationTable table(grid.width());
+    std::vector<SearchStats> stats(static_cast<size_t>(threads));
+    for (size_t begin = 0; begin < order.size(); begin += size_t(threads)) {
+        const int batch = int(std::min(order.size() - begin, size_t(threads)));
+        // Пути пакета ищутся параллельно по таблице, не изменяющейся во время поиска
+        pool.run(batch, [&](int i) {
+            const int agent = order[begin + size_t(i)];
+            stats[size_t(i)] = SearchStats();
+            plan.paths[agent] = planAgent(grid, agents[agent], distances[agent], table, stats[size_t(i)]);
+        });
+        for (int i = 0; i < batch; ++i) {
+            plan.expansions += stats[size_t(i)].expansions;
+            ++plan.lowLevelSearches;
+        }
+
+        // Проверка в порядке приоритета против путей, принятых раньше в этом пакете
+        for (int i = 0; i < batch; ++i) {
+            const int agent = order[begin + size_t(i)];
+            std::vector<Node> &path = plan.paths[agent];
+            if (i > 0 && !table.isPathFree(path)) {
+                SearchStats replan;
+                path = planAgent(grid, agents[agent], distances[agent], table, replan);
+                plan.expansions += replan.expansions;
+                ++plan.lowLevelSearches;
+            }
+            table.reservePath(path);
+        }
+    }
+
+    summarize(plan);
+    plan.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - started).count();
+    return plan;
+}
+
+/**
+ * @brief Поиск на основе конфликтов (Conflict-Based Search).
+ *
+ * Узел дерева хранит одно ограничение и один путь, поэтому память растет линейно
+ * с количеством узлов. Агенты с недостижимыми целями исключаются из плана заранее.
+ */
+MultiAgentPlan conflict_based_search(const Grid &grid, const std::vector<Query> &agents, int maxNodes, int threads)
+{
+    const auto started = std::chrono::steady_clock::now();
+    threads = Parallel::threadCount(threads);
+    Parallel::WorkerPool pool(threads);
+    MultiAgentPlan plan;
+    const std::vector<int> distances = staticDistances(grid, agents, pool);
+
+    // Корень: кратчайшие пути без ограничений
+    std::vector<std::vector<Node>> rootPaths(agents.size());
+    std::vector<SearchStats> stats(agents.size());
+    const ReservationTable none(grid.width());
+    pool.run(int(agents.size()), [&](int agent) {
+        if (distances[agent] >= 0)
+            rootPaths[agent] = planAgent(grid, agents[agent], distances[agent], none, stats[agent]);
+    });
+    for (size_t agent = 0; agent < agents.size(); ++agent) {
+        plan.expansions += stats[agent].expansions;
+        plan.lowLevelSearches += distances[agent] >= 0;
+    }
+
+    std::vector<CbsNode> nodes;
+    std::priority_queue<CbsEntry> open_set;
+    Conflict conflict {};
+    {
+        CbsNode root {-1, {-1, Node{0, 0}, Node{0, 0}, 0, false}, {}, 0, 0};
+        for (const std::vector<Node> &path : rootPaths)
+            root.cost += path.empty() ? 0 : static_cast<long long>(path.size()) - 1;
+        root.conflicts = findConflicts(nodePaths(nodes, -1, rootPaths), conflict);
+        nodes.push_back(std::move(root));
+        open_set.push({nodes[0].cost, nodes[0].conflicts, 0});
+    }
+
+    int solution = -1;
+    while (!open_set.empty() && int(nodes.size()) <= maxNodes) {
+        const int index = open_set.top().node;
+        open_set.pop();
+        if (nodes[index].conflicts == 0) {
+            solution = index;
+            break;
+        }
+        findConflicts(nodePaths(nodes, index, rootPaths), conflict);
+
+        // Два потомка: конфликт запрещается одному из агентов, и его путь ищется заново
+        CbsNode children[2];
+        const int agentsOf[2] = {conflict.a, conflict.b};
+        SearchStats childStats[2];
+        pool.run(2, [&](int k) {
+            const int agent = agentsOf[k];
+            Constraint c {agent, conflict.u, conflict.u, conflict.t, false};
+            if (conflict.edge)
+                c = k == 0 ? Constraint{agent, conflict.u, conflict.v, conflict.t, true}
+                           : Constraint{agent, conflict.v, conflict.u, conflict.t, true};
+            children[k] = {index, c, {}, 0, 0};
+            ReservationTable table = constraintTable(nodes, index, agent, grid.width());
+            if (c.edge)
+                table.reserveMove(c.to, c.from, c.t);
+            else
+                table.reserveVertex(c.to, c.t);
+            children[k].path = planAgent(grid, agents[agent], distances[agent], table, childStats[k]);
+        });
+
+        for (int k = 0; k < 2; ++k) {
+            plan.expansions += childStats[k].expansions;
+            ++plan.lowLevelSearches;
+            if (children[k].path.empty())
+                continue;
+            const int agent = agentsOf[k];
+            const long long oldCost = static_cast<long long>(nodePaths(nodes, index, rootPaths)[agent]->size());
+            const long long parentCost = nodes[index].cost;
+            nodes.push_back(std::move(children[k]));
+            CbsNode &child = nodes.back();
+            child.cost = parentCost - oldCost + static_cast<long long>(child.path.size());
+            child.conflicts = findConflicts(nodePaths(nodes, int(nodes.size()) - 1, rootPaths), conflict);
+            open_set.push({child.cost, child.conflicts, int(nodes.size()) - 1});
+        }
+    }
+    plan.highLevelNodes = static_cast<long long>(nodes.size());
+
+    if (solution < 0) {
+        // Дерево ограничений превысило предел: приоритетное планирование
+        const MultiAgentPlan fallback = prioritized_planning(grid, agents, threads);
+        plan.paths = fallback.paths;
+        plan.expansions += fallback.expansions;
+        plan.lowLevelSearches += fallback.lowLevelSearches;
+        plan.fallback = true;
+    } else {
+        for (const std::vector<Node> *path : nodePaths(nodes, solution, rootPaths))
+            plan.paths.push_back(*path);
+    }
+
+    summarize(plan);
+    plan.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - started).count();
+    return plan;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "pathfinding.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Таблица резервирования ячеек во времени (ReservationTable).
+ *
+ * Хранит пары (ячейка, момент времени), занятые другими агентами, переходы между
+ * соседними ячейками и ячейки, занятые навсегда (агент остался на своей цели).
+ * Ключи упакованы в 64-битные числа и хранятся в хеш-таблицах, поэтому память
+ * пропорциональна длине зарезервированных путей, а не площади сетки и горизонту.
+ *
+ * Таблица рассчитана на сетки до 2^30 ячеек.
+ */
+class ReservationTable
+{
+public:
+    explicit ReservationTable(int width = 0);
+
+    void reserveVertex(const Node &cell, int t);
+    void reserveMove(const Node &from, const Node &to, int t);
+    void reserveForever(const Node &cell, int t);
+    void reservePath(const std::vector<Node> &path);
+
+    bool isVertexFree(const Node &cell, int t) const;
+    bool isMoveFree(const Node &from, const Node &to, int t) const;
+    bool isPathFree(const std::vector<Node> &path) const;
+    int lastReserved(const Node &cell) const;
+    int horizon() const { return m_horizon; }   /**< Последний момент времени с резервированием. */
+    bool empty() const;
+    void clear();
+
+private:
+    int m_width;                                /**< Ширина сетки (для индексов ячеек). */
+    int m_horizon {0};                          /**< Последний момент времени с резервированием. */
+    std::unordered_set<uint64_t> m_vertices;    /**< Занятые пары (ячейка, время). */
+    std::unordered_set<uint64_t> m_moves;       /**< Занятые переходы (ячейка, направление, время). */
+    std::unordered_map<int, int> m_forever;     /**< Ячейки, занятые навсегда, и момент начала. */
+    std::unordered_map<int, int> m_last;        /**< Последний момент резервирования каждой ячейки. */
+
+    int index(const Node &cell) const { return cell.y * m_width + cell.x; }
+};
+
+/**
+ * @brief Результат планирования путей для нескольких агентов.
+ *
+ * Путь агента - его положения в моменты времени 0, 1, 2, ...; после конца пути агент
+ * остается на цели. Агент, для которого путь не найден, в плане не участвует.
+ */
+struct MultiAgentPlan {
+    std::vector<std::vector<Node>> paths;   /**< Пути агентов (пустой, если путь не найден). */
+    int failed {0};                 /**< Количество агентов без пути. */
+    long long sumOfCosts {0};       /**< Сумма времен прибытия агентов на цели. */
+    int makespan {0};               /**< Время прибытия последнего агента. */
+    long long expansions {0};       /**< Раскрытые состояния во всех поисках нижнего уровня. */
+    long long lowLevelSearches {0}; /**< Количество поисков нижнего уровня. */
+    long long highLevelNodes {0};   /**< Узлы дерева ограничений (CBS). */
+    bool fallback {false};          /**< CBS не уложился в ограничение и использовано приоритетное планирование. */
+    long long elapsedNs {0};        /**< Время планирования в наносекундах. */
+};
+
+/**
+ * @brief Положение агента в момент времени t.
+ *
+ * @param path Путь агента по шагам времени (непустой).
+ * @param t Момент времени.
+ * @return Ячейка пути в момент t или последняя ячейка, если агент уже на цели.
+ */
+Node positionAt(const std::vector<Node> &path, int t);
+
+/**
+ * @brief Поиск A* в пространстве-времени.
+ *
+ * Состояние поиска - пара (ячейка, момент времени); на каждом шаге агент переходит в
+ * соседнюю ячейку или ждет на месте. Состояния и переходы, занятые в таблице
+ * резервирования, недоступны. Агент может закончить путь на цели только после
+ * последнего резервирования цели, так как затем остается на ней навсегда.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальная ячейка (момент 0).
+ * @param goal Конечная ячейка.
+ * @param table Резервирования других агентов.
+ * @param maxTime Наибольший момент времени, рассматриваемый поиском.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return Положения агента в моменты 0..T, где T - время прибытия; пусто, если путь не найден.
+ */
+std::vector<Node> space_time_a_star(const Grid &grid, const Node &start, const Node &goal,
+                                    const ReservationTable &table, int maxTime, SearchStats *stats = nullptr);
+
+/**
+ * @brief Приоритетное планирование путей нескольких агентов.
+ *
+ * Агенты планируются по очереди в порядке списка; путь каждого агента резервируется,
+ * и следующие агенты обходят его (cooperative A*). Агенты обрабатываются пакетами по
+ * числу потоков: пути пакета ищутся параллельно по текущей таблице, затем по порядку
+ * проверяются против уже принятых путей пакета, и только конфликтующие пути ищутся
+ * заново. Путь, найденный при меньшем числе резервирований и не конфликтующий с
+ * остальными, оптимален и при всех резервированиях, поэтому, как и при
+ * последовательном планировании, путь каждого агента кратчайший при заданных путях
+ * агентов с более высоким приоритетом (сами пути при равной длине могут отличаться).
+ * Пакеты выполняет пул потоков, создаваемый один раз на вызов.
+ *
+ * @param grid Сетка препятствий.
+ * @param agents Начальные и конечные точки агентов (начала различны, цели различны).
+ * @param threads Количество потоков (0 - по числу ядер).
+ * @return План.
+ */
+MultiAgentPlan prioritized_planning(const Grid &grid, const std::vector<Query> &agents, int threads = 0);
+
+/**
+ * @brief Поиск на основе конфликтов (Conflict-Based Search).
+ *
+ * Верхний уровень перебирает дерево ограничений в порядке суммы стоимостей путей: в
+ * первом конфликте двух агентов (одна ячейка в один момент или встречный обмен
+ * ячейками) порождаются два узла, запрещающие конфликт одному из агентов, и путь
+ * этого агента ищется заново. Поиски нижнего уровня корня и обоих потомков
+ * выполняются параллельно в пуле потоков, создаваемом один раз на вызов (потомков ищут
+ * вызывающий поток и один поток пула). Находит план с минимальной суммой стоимостей; если
+ * дерево превысило maxNodes узлов, возвращается результат prioritized_planning().
+ *
+ * @param grid Сетка препятствий.
+ * @param agents Начальные и конечные точки агентов (начала различны, цели различны).
+ * @param maxNodes Ограничение на количество узлов дерева ограничений.
+ * @param threads Количество потоков (0 - по числу ядер).
+ * @return План.
+ */
+MultiAgentPlan conflict_based_search(const Grid &grid, const std::vector<Query> &agents, int maxNodes = 1000,
+                                     int threads = 0);
@@ -0,0 +1,123 @@
+#include "multigoal.h"
+#include "pathcache.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <memory_resource>
+#include <queue>
+
+namespace {
+
+const size_t HeuristicGoalLimit = 32;   // при большем числе целей эвристика не вычисляется
+
+const uint8_t NoParent = SearchTree::Unreached;
+const uint8_t StartCell = SearchTree::Root;
+
+}
+
+/**
+ * @brief Поиск кратчайшего пути до ближайшей из нескольких целей.
+ *
+ * Состояние поиска, как и в a_star_search_compact(), размещается в арене текущего потока.
+ */
+CompactPath multi_goal_search(const Grid &grid, const Node &start, const std::vector<Node> &goals,
+                              SearchStats *stats, int *reached)
+{
+    SearchTimer timer(stats);
+    if (reached != nullptr)
+        *reached = -1;
+    if (!grid.contains(start.x, start.y))
+        return {};
+
+    ArenaScope arena;
+    std::pmr::memory_resource *memory = arena.resource();
+
+    const int width = grid.width();
+    auto cell = [width](const Node &node) { return size_t(node.y) * width + node.x; };
+
+    // Битовая карта целей и список различных целей для эвристики
+    std::pmr::vector<uint8_t> is_goal(grid.cellCount(), 0, memory);
+    std::pmr::vector<Node> targets(memory);
+    for (const Node &goal : goals) {
+        if (!grid.contains(goal.x, goal.y) || is_goal[cell(goal)])
+            continue;
+        is_goal[cell(goal)] = 1;
+        targets.push_back(Node{goal.x, goal.y});
+    }
+    if (targets.empty())
+        return {};
+
+    const bool useHeuristic = targets.size() <= HeuristicGoalLimit;
+    auto heuristic = [&](const Node &node) {
+        if (!useHeuristic)
+            return 0;
+        int best = INT_MAX;
+        for (const Node &target : targets)
+            best = std::min(best, std::abs(node.x - target.x) + std::abs(node.y - target.y));
+        return best;
+    };
+
+    std::priority_queue<Node, std::pmr::vector<Node>> open_set{std::less<Node>(), std::pmr::vector<Node>(memory)};
+    std::pmr::vector<uint8_t> came_from(grid.cellCount(), NoParent, memory);
+    std::pmr::vector<int> g_score(grid.cellCount(), INT_MAX, memory);
+
+    auto memoryUsage = [&]() {
+        if (arena.bytesUsed() > 0)
+            return (long long)arena.bytesUsed();
+        return (long long)(stats->peakOpenSize * sizeof(Node)) + (long long)(2 * came_from.size())
+               + (long long)(g_score.size() * sizeof(int)) + (long long)(targets.size() * sizeof(Node));
+    };
+
+    g_score[cell(start)] = 0;
+    came_from[cell(start)] = StartCell;
+    Node first{start.x, start.y};
+    first.h = heuristic(first);
+    first.f = first.h;
+    open_set.push(first);
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = 1);
+
+    while (!open_set.empty()) {
+        const Node current = open_set.top();
+        open_set.pop();
+        if (current.g > g_score[cell(current)]) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        SEARCH_STATS(stats, ++stats->expansions;
+                     if (stats->recordExpansions) stats->expansionOrder.push_back(int(cell(current))));
+
+        if (is_goal[cell(current)]) {
+            SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+            if (reached != nullptr) {
+                for (size_t i = 0; i < goals.size(); ++i) {
+                    if (goals[i] == current) {
+                        *reached = int(i);
+                        break;
+                    }
+                }
+            }
+            return CompactPath::fromParents(came_from.data(), width, start, current, StartCell);
+        }
+
+        for (uint8_t d = 0; d < 4; ++d) {
+            Node neighbor{current.x + CompactPath::dx[d], current.y + CompactPath::dy[d]};
+            if (!grid.isFree(neighbor.x, neighbor.y))
+                continue;
+            const int tentative = current.g + 1;
+            if (tentative >= g_score[cell(neighbor)])
+                continue;
+            came_from[cell(neighbor)] = d;
+            g_score[cell(neighbor)] = tentative;
+            neighbor.g = tentative;
+            neighbor.h = heuristic(neighbor);
+            neighbor.f = neighbor.g + neighbor.h;
+            open_set.push(neighbor);
+            SEARCH_STATS(stats, ++stats->pushes;
+                         stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, open_set.size()));
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+    return {};
+}
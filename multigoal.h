@@ -0,0 +1,30 @@
+#pragma once
+
+#include "compactpath.h"
+#include "pathfinding.h"
+
+#include <vector>
+
+/**
+ * @brief Поиск кратчайшего пути до ближайшей из нескольких целей.
+ *
+ * Выполняет один поиск вместо поиска до каждой цели и выбора кратчайшего пути.
+ * Поиск останавливается на первой раскрытой цели; так как эвристика допустима и
+ * согласована, эта цель ближайшая, а путь до нее кратчайший.
+ *
+ * При небольшом числе целей используется A* с эвристикой - минимумом манхэттенских
+ * расстояний до целей. При большом числе целей вычисление такой эвристики дороже
+ * раскрытия ячейки, поэтому выполняется поиск равной стоимости (эвристика 0), а цели
+ * отмечаются в битовой карте: стоимость раскрытия не зависит от числа целей.
+ *
+ * Цели вне сетки пропускаются, повторяющиеся цели допустимы.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goals Цели.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @param reached Индекс достигнутой цели в goals или -1, если путь не найден (может быть nullptr).
+ * @return Компактный путь до ближайшей цели; пустой, если ни одна цель не достижима.
+ */
+CompactPath multi_goal_search(const Grid &grid, const Node &start, const std::vector<Node> &goals,
+                              SearchStats *stats = nullptr, int *reached = nullptr);
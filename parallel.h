@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Простейшие параллельные циклы ядра поиска без зависимостей от Qt.
+ */
+namespace Parallel {
+
+/**
+ * @brief Количество потоков: запрошенное или, при 0, по числу ядер.
+ */
+inline int threadCount(int requested)
+{
+    if (requested > 0)
+        return requested;
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+/**
+ * @brief Параллельное выполнение body(i) для i из [0, count).
+ *
+ * Итерации раздаются потокам по одной через общий счетчик, поэтому неравные по
+ * стоимости итерации распределяются равномерно. Вызывающий поток участвует в работе.
+ */
+template <typename Body>
+void parallelFor(int count, int threads, Body body)
+{
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (int i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+
+    std::atomic<int> next {0};
+    auto worker = [&] {
+        for (int i = next++; i < count; i = next++)
+            body(i);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &thread : pool)
+        thread.join();
+}
+
+/**
+ * @brief Пул потоков для многократных параллельных циклов.
+ *
+ * Потоки создаются один раз и ждут следующего цикла, поэтому их арены поиска
+ * (SearchArena) и буферы трассировки переиспользуются между циклами. Вызывающий поток
+ * участвует в работе, и будятся только потоки, для которых хватает итераций.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * @param threads Количество потоков вместе с вызывающим (меньше 1 - один).
+     */
+    explicit WorkerPool(int threads)
+    {
+        for (int t = 1; t < threads; ++t)
+            m_workers.emplace_back([this] { work(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread &thread : m_workers)
+            thread.join();
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /** @brief Количество потоков вместе с вызывающим. */
+    int threads() const { return int(m_workers.size()) + 1; }
+
+    /**
+     * @brief Параллельное выполнение body(i) для i из [0, count); возвращает управление,
+     *        когда все итерации выполнены.
+     */
+    template <typename Body>
+    void run(int count, Body body)
+    {
+        if (m_workers.empty() || count <= 1) {
+            for (int i = 0; i < count; ++i)
+                body(i);
+            return;
+        }
+        const std::function<void(int)> job = [&body](int i) { body(i); };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_count = count;
+            m_next = 0;
+            m_wanted = std::min(int(m_workers.size()), count - 1);
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        drain(job, count);
+
+        // Потоки, еще не взявшие цикл, в нем уже не нужны
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wanted = 0;
+        m_done.wait(lock, [this] { return m_active == 0; });
+        m_job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;             /**< Новый цикл или остановка. */
+    std::condition_variable m_done;             /**< Поток закончил свою часть цикла. */
+    const std::function<void(int)> *m_job {nullptr};    /**< Тело текущего цикла. */
+    int m_count {0};                            /**< Количество итераций текущего цикла. */
+    std::atomic<int> m_next {0};                /**< Следующая итерация. */
+    int m_wanted {0};                           /**< Сколько потоков еще может взять цикл. */
+    int m_active {0};                           /**< Потоки, выполняющие цикл. */
+    uint64_t m_generation {0};                  /**< Номер текущего цикла. */
+    bool m_stop {false};
+
+    void drain(const std::function<void(int)> &job, int count)
+    {
+        for (int i = m_next++; i < count; i = m_next++)
+            job(i);
+    }
+
+    void work()
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+            if (m_wanted == 0)
+                continue;
+            --m_wanted;
+            ++m_active;
+            const std::function<void(int)> &job = *m_job;
+            const int count = m_count;
+            lock.unlock();
+            drain(job, count);
+            lock.lock();
+            if (--m_active == 0)
+                m_done.notify_one();
+        }
+    }
+};
+
+}
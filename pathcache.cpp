@@ -0,0 +1,353 @@
+#include "pathcache.h"
+
+#include <iterator>
+
+namespace {
+
+// Служебная память записи: узел списка и узлы индексов
+const size_t EntryOverhead = 8 * sizeof(void *) + 2 * sizeof(uint64_t) * 3;
+
+uint64_t mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+}
+
+/**
+ * @brief Проверка, закрыта ли ячейка деревом поиска.
+ *
+ * @param goal Ячейка.
+ * @return true, если путь до ячейки можно восстановить по дереву.
+ */
+bool SearchTree::covers(const Node &goal) const
+{
+    return goal.x >= 0 && goal.x < width && goal.y >= 0 && goal.y < height
+           && directions[size_t(goal.y) * width + goal.x] != Unreached;
+}
+
+/**
+ * @brief Путь из начальной ячейки дерева.
+ *
+ * @param goal Ячейка, закрытая деревом (covers()).
+ * @return Кратчайший путь от start до goal.
+ */
+CompactPath SearchTree::pathTo(const Node &goal) const
+{
+    return CompactPath::fromParents(directions.data(), width, start, goal, Root);
+}
+
+/**
+ * @brief Хеш-функция ключа записи.
+ */
+size_t PathCache::KeyHash::operator()(const Key &key) const
+{
+    const uint64_t from = uint64_t(uint32_t(key.sx)) << 32 | uint32_t(key.sy);
+    const uint64_t to = uint64_t(uint32_t(key.gx)) << 32 | uint32_t(key.gy);
+    return size_t(mix(key.version ^ mix(from ^ mix(to ^ uint64_t(key.tree)))));
+}
+
+/**
+ * @brief Конструктор кэша.
+ *
+ * @param capacityBytes Ограничение памяти, занимаемой записями.
+ */
+PathCache::PathCache(size_t capacityBytes)
+    : m_capacity(capacityBytes)
+{
+}
+
+/**
+ * @brief Поиск пути с использованием кэша.
+ *
+ * Если ответ есть в кэше, он возвращается без поиска; иначе выполняется
+ * a_star_search_compact(), а найденный путь и дерево поиска сохраняются в кэше.
+ * Если запрошена запись порядка раскрытия ячеек (stats->recordExpansions), поиск
+ * выполняется всегда, чтобы статистика была полной.
+ *
+ * @param grid Сетка препятствий.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param stats Статистика поиска (может быть nullptr); отмечает попадание или промах.
+ * @return Компактный путь. Если путь не найден, возвращается пустой путь.
+ */
+CompactPath PathCache::find(const Grid &grid, const Node &start, const Node &goal, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    CompactPath path;
+    if (stats == nullptr || !stats->recordExpansions) {
+        if (lookup(grid, start, goal, path)) {
+            SEARCH_STATS(stats, ++stats->cacheHits);
+            return path;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_counters.misses;
+    }
+    SEARCH_STATS(stats, ++stats->cacheMisses);
+
+    // Дерево сохраняется, только если занимает малую часть кэша
+    SearchTree tree;
+    const bool keepTree = grid.cellCount() + sizeof(SearchTree) <= capacity() / 8;
+    path = a_star_search_compact(grid, start, goal, stats, keepTree ? &tree : nullptr);
+
+    insert(grid, start, goal, path);
+    if (keepTree)
+        insertTree(grid, std::move(tree));
+    return path;
+}
+
+/**
+ * @brief Поиск ответа в кэше без выполнения поиска.
+ *
+ * @param grid Сетка препятствий (используется ее версия).
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param path Найденный в кэше путь (пустой, если цель недостижима).
+ * @return true при попадании.
+ */
+bool PathCache::lookup(const Grid &grid, const Node &start, const Node &goal, CompactPath &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (lookupLocked(makeKey(grid, start, goal), goal, path))
+        return true;
+    ++m_counters.misses;
+    return false;
+}
+
+/**
+ * @brief Сохранение результата поиска.
+ *
+ * @param grid Сетка, на которой выполнен поиск.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param path Найденный путь (пустой, если цель недостижима).
+ */
+void PathCache::insert(const Grid &grid, const Node &start, const Node &goal, const CompactPath &path)
+{
+    Entry entry{makeKey(grid, start, goal), path, SearchTree(), 0};
+    entry.bytes = sizeof(Entry) + path.memoryBytes() - sizeof(CompactPath) + EntryOverhead;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insertLocked(std::move(entry));
+}
+
+/**
+ * @brief Сохранение дерева поиска.
+ *
+ * Если для той же начальной точки и версии сетки дерево уже сохранено, деревья
+ * объединяются: ячейки, закрытые только старым деревом, сохраняют свои направления.
+ * Объединение корректно, так как у каждой закрытой ячейки родитель закрыт в том же
+ * дереве и находится на единицу ближе к началу, поэтому цепочка родителей в
+ * объединенном дереве остается кратчайшим путем. Так дерево накапливает ответы
+ * для серии запросов из одной точки.
+ *
+ * @param grid Сетка, на которой выполнен поиск.
+ * @param tree Дерево поиска.
+ */
+void PathCache::insertTree(const Grid &grid, SearchTree tree)
+{
+    Entry entry{startKey(makeKey(grid, tree.start, tree.start)), CompactPath(), std::move(tree), 0};
+    entry.bytes = sizeof(Entry) + entry.tree.directions.capacity() + EntryOverhead;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto existing = m_index.find(entry.key);
+    if (existing != m_index.end()) {
+        const SearchTree &old = existing->second->tree;
+        std::vector<uint8_t> &directions = entry.tree.directions;
+        if (old.directions.size() == directions.size()) {
+            for (size_t i = 0; i < directions.size(); ++i) {
+                if (directions[i] == SearchTree::Unreached)
+                    directions[i] = old.directions[i];
+            }
+            entry.tree.complete |= old.complete;
+        }
+    }
+    insertLocked(std::move(entry));
+}
+
+/**
+ * @brief Удаление записей, относящихся к другим версиям сетки.
+ *
+ * Такие записи уже никогда не дадут попадания; удаление освобождает память
+ * сразу, не дожидаясь вытеснения.
+ *
+ * @param version Текущая версия сетки.
+ */
+void PathCache::evictOtherVersions(uint64_t version)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        auto next = std::next(it);
+        if (it->key.version != version)
+            erase(it);
+        it = next;
+    }
+}
+
+/**
+ * @brief Очистка кэша. Счетчики обращений сохраняются.
+ */
+void PathCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_byStart.clear();
+    m_bytes = 0;
+}
+
+/**
+ * @brief Изменение ограничения памяти.
+ *
+ * @param capacityBytes Новое ограничение; лишние записи вытесняются.
+ */
+void PathCache::setCapacity(size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacityBytes;
+    shrink();
+}
+
+/**
+ * @brief Ограничение памяти.
+ */
+size_t PathCache::capacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
+
+/**
+ * @brief Объем памяти, занимаемой записями.
+ */
+size_t PathCache::memoryBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+/**
+ * @brief Количество записей.
+ */
+size_t PathCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+/**
+ * @brief Счетчики обращений с момента создания кэша.
+ */
+PathCache::Counters PathCache::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+/**
+ * @brief Ключ записи пути.
+ */
+PathCache::Key PathCache::makeKey(const Grid &grid, const Node &start, const Node &goal)
+{
+    return Key{grid.version(), start.x, start.y, goal.x, goal.y, false};
+}
+
+/**
+ * @brief Поиск ответа в кэше (блокировка уже захвачена).
+ *
+ * Проверяет точное совпадение, затем дерево поиска из той же начальной точки,
+ * затем сохраненные пути из той же начальной точки, проходящие через цель.
+ * Использованная запись становится самой недавней.
+ */
+bool PathCache::lookupLocked(const Key &key, const Node &goal, CompactPath &path)
+{
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        path = it->second->path;
+        ++m_counters.hits;
+        return true;
+    }
+
+    it = m_index.find(startKey(key));
+    if (it != m_index.end()) {
+        const SearchTree &tree = it->second->tree;
+        if (tree.covers(goal) || tree.complete) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            path = tree.covers(goal) ? tree.pathTo(goal) : CompactPath();
+            ++m_counters.treeHits;
+            return true;
+        }
+    }
+
+    auto range = m_byStart.equal_range(startKey(key));
+    for (auto match = range.first; match != range.second; ++match) {
+        const CompactPath &cached = match->second->path;
+        size_t step = 0;
+        for (const Node &node : cached) {
+            if (node == goal) {
+                m_entries.splice(m_entries.begin(), m_entries, match->second);
+                path = cached.prefix(step);
+                ++m_counters.prefixHits;
+                return true;
+            }
+            ++step;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Добавление записи (блокировка уже захвачена).
+ *
+ * Запись с тем же ключом заменяется; запись больше всего кэша не сохраняется.
+ */
+void PathCache::insertLocked(Entry entry)
+{
+    auto existing = m_index.find(entry.key);
+    if (existing != m_index.end())
+        erase(existing->second);
+    if (entry.bytes > m_capacity)
+        return;
+
+    m_bytes += entry.bytes;
+    m_entries.push_front(std::move(entry));
+    const Key &key = m_entries.front().key;
+    m_index.emplace(key, m_entries.begin());
+    if (!key.tree && !m_entries.front().path.empty())
+        m_byStart.emplace(startKey(key), m_entries.begin());
+    shrink();
+}
+
+/**
+ * @brief Удаление записи из списка и индексов.
+ */
+void PathCache::erase(EntryList::iterator it)
+{
+    m_bytes -= it->bytes;
+    m_index.erase(it->key);
+    auto range = m_byStart.equal_range(startKey(it->key));
+    for (auto match = range.first; match != range.second; ++match) {
+        if (match->second == it) {
+            m_byStart.erase(match);
+            break;
+        }
+    }
+    m_entries.erase(it);
+}
+
+/**
+ * @brief Вытеснение давно использованных записей до соблюдения ограничения памяти.
+ */
+void PathCache::shrink()
+{
+    while (m_bytes > m_capacity && !m_entries.empty()) {
+        erase(std::prev(m_entries.end()));
+        ++m_counters.evictions;
+    }
+}
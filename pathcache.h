@@ -0,0 +1,128 @@
+#pragma once
+
+#include "compactpath.h"
+#include "pathfinding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Дерево кратчайших путей из одной начальной ячейки (SearchTree).
+ *
+ * Для каждой ячейки, стоимость которой окончательно определена поиском (закрытые узлы
+ * A*), хранится направление шага, которым в нее пришли. По принципу оптимальности путь
+ * из начальной ячейки в любую такую ячейку восстанавливается по дереву без нового поиска.
+ */
+struct SearchTree {
+    static constexpr uint8_t Unreached = 0xFF;  /**< Ячейка не закрыта поиском. */
+    static constexpr uint8_t Root = 0xFE;       /**< Начальная ячейка. */
+
+    Node start {0, 0};                  /**< Начальная ячейка. */
+    int width {0};                      /**< Ширина сетки. */
+    int height {0};                     /**< Высота сетки. */
+    bool complete {false};              /**< Поиск исчерпал компоненту связности начальной ячейки. */
+    std::vector<uint8_t> directions;    /**< Направления шагов (y * width + x) или Unreached/Root. */
+
+    bool covers(const Node &goal) const;
+    CompactPath pathTo(const Node &goal) const;
+    size_t memoryBytes() const { return sizeof(*this) + directions.capacity(); }
+};
+
+/**
+ * @brief Кэш найденных путей (PathCache).
+ *
+ * LRU-кэш с ограничением по памяти. Ключ записи - версия сетки (Grid::version()),
+ * начальная и конечная точки, поэтому после правки сетки старые записи не используются.
+ * Кроме точного совпадения запроса кэш отвечает:
+ * - на запросы из той же начальной точки к цели, лежащей на сохраненном пути
+ *   (начальный участок кратчайшего пути - кратчайший путь);
+ * - на запросы из той же начальной точки к любой ячейке, закрытой сохраненным деревом
+ *   поиска, и на запросы к недостижимым целям, если дерево покрывает всю компоненту.
+ *
+ * Методы потокобезопасны; поиск при промахе выполняется вне блокировки.
+ */
+class PathCache
+{
+public:
+    /**
+     * @brief Счетчики обращений к кэшу.
+     */
+    struct Counters {
+        long long hits {0};         /**< Точные попадания. */
+        long long prefixHits {0};   /**< Ответы начальным участком сохраненного пути. */
+        long long treeHits {0};     /**< Ответы по сохраненному дереву поиска. */
+        long long misses {0};       /**< Промахи (выполнен поиск). */
+        long long evictions {0};    /**< Вытесненные записи. */
+    };
+
+    explicit PathCache(size_t capacityBytes = 64u << 20);
+
+    CompactPath find(const Grid &grid, const Node &start, const Node &goal, SearchStats *stats = nullptr);
+    bool lookup(const Grid &grid, const Node &start, const Node &goal, CompactPath &path);
+    void insert(const Grid &grid, const Node &start, const Node &goal, const CompactPath &path);
+    void insertTree(const Grid &grid, SearchTree tree);
+
+    void evictOtherVersions(uint64_t version);
+    void clear();
+    void setCapacity(size_t capacityBytes);
+
+    size_t capacity() const;
+    size_t memoryBytes() const;
+    size_t size() const;
+    Counters counters() const;
+
+private:
+    /**
+     * @brief Ключ записи: версия сетки, начальная и конечная точки, вид записи.
+     *
+     * У записей с деревом поиска конечная точка равна (-1, -1), а вид отличает их от
+     * записей путей, поэтому запрос к точке (-1, -1) не совпадает с деревом.
+     */
+    struct Key {
+        uint64_t version;
+        int sx, sy, gx, gy;
+        bool tree;
+        bool operator==(const Key &o) const {
+            return version == o.version && sx == o.sx && sy == o.sy && gx == o.gx && gy == o.gy && tree == o.tree;
+        }
+    };
+
+    /**
+     * @brief Хеш-функция ключа.
+     */
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    /**
+     * @brief Запись кэша: путь или дерево поиска.
+     */
+    struct Entry {
+        Key key;            /**< Ключ записи. */
+        CompactPath path;   /**< Сохраненный путь (пустой у дерева или у недостижимой цели). */
+        SearchTree tree;    /**< Дерево поиска (пустое у записи пути). */
+        size_t bytes;       /**< Оценка занимаемой памяти. */
+    };
+
+    using EntryList = std::list<Entry>;
+
+    mutable std::mutex m_mutex;     /**< Защита всех полей. */
+    size_t m_capacity;              /**< Ограничение памяти. */
+    size_t m_bytes {0};             /**< Текущий объем записей. */
+    EntryList m_entries;            /**< Записи от недавно использованных к давно использованным. */
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;         /**< Записи по ключу. */
+    std::unordered_multimap<Key, EntryList::iterator, KeyHash> m_byStart;  /**< Записи путей по (версия, начало). */
+    Counters m_counters;            /**< Счетчики обращений. */
+
+    static Key makeKey(const Grid &grid, const Node &start, const Node &goal);
+    static Key startKey(const Key &key) { return Key{key.version, key.sx, key.sy, -1, -1, true}; }
+
+    bool lookupLocked(const Key &key, const Node &goal, CompactPath &path);
+    void insertLocked(Entry entry);
+    void erase(EntryList::iterator it);
+    void shrink();
+};
@@ -1,21 +1,14 @@
 #include "pathfinding.h"
+#include "compactpath.h"
+#include "pathcache.h"
+#include "searcharena.h"
+#include "trace.h"
 
-#include <cfloat>
+#include <climits>
 #include <queue>
-#include <unordered_map>
 #include <cmath>
 #include <algorithm>
-#include <unordered_map>
-
-// Переопределение хеш-функции для класса Node
-namespace std {
-template <>
-struct hash<Node> {
-    size_t operator()(const Node& p) const {
-        return hash<int>()(p.x) ^ (hash<int>()(p.y) << 1);
-    }
-};
-}
+#include <memory_resource>
 
 /**
  * @brief Вычисление манхэттенского расстояния между двумя узлами.
@@ -37,66 +30,135 @@ int manhattanDistance(const Node& from, const Node& to) {
  *
  * @param x Координата x.
  * @param y Координата y.
- * @param width Ширина сетки.
- * @param height Высота сетки.
  * @param grid Сетка, представляющая блокировку ячеек.
  * @return true, если позиция валидна; false в противном случае.
  */
-bool isValid(int x, int y, int width, int height, const std::vector<std::vector<bool>>& grid) {
-    return x >= 0 && x < width && y >= 0 && y < height && !grid[x][y];
+bool isValid(int x, int y, const Grid& grid) {
+    return grid.isFree(x, y);
 }
 
-// Направления движения: Право, Вниз, Лево, Верх
-const std::vector<std::pair<int, int>> directions{{0, 1}, {1, 0}, {0, -1}, {-1, 0}};;
+// Код направления для ячеек, в которые поиск еще не приходил, и для начальной ячейки
+// (совпадают с кодами дерева поиска, поэтому направления копируются в дерево как есть)
+const uint8_t NoParent = SearchTree::Unreached;
+const uint8_t StartCell = SearchTree::Root;
 
 /**
  * @brief Поиск пути с использованием алгоритма A*.
  *
  * Алгоритм A* использует эвристическое оценивание для поиска кратчайшего пути от начального узла до конечного узла на сетке.
+ * Для каждой ячейки хранится один байт - направление шага, которым в нее пришли, - а найденный путь
+ * возвращается в компактном виде (по 2 бита на шаг).
+ *
+ * Все состояние поиска (открытый список, стоимости и направления) размещается в арене
+ * текущего потока (searcharena.h), которая сбрасывается по завершении запроса. Вне арены
+ * выделяется только память результата.
  *
  * @param grid Сетка, представляющая блокировку ячеек.
  * @param start Начальный узел.
  * @param end Конечный узел.
- * @return Вектор узлов, представляющий найденный путь. Если путь не найден, возвращается пустой вектор.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @param tree Дерево поиска для заполнения закрытыми ячейками (может быть nullptr).
+ * @return Компактный путь. Если путь не найден, возвращается пустой путь.
  */
-std::vector<Node> a_star_search(const std::vector<std::vector<bool>>& grid, const Node& start, const Node& end) {
+CompactPath a_star_search_compact(const Grid& grid, const Node& start, const Node& end, SearchStats *stats,
+                                  SearchTree *tree) {
+
+    Trace::Scope trace("a_star_search");
+    SearchTimer timer(stats);
+    if (!grid.contains(start.x, start.y) || !grid.contains(end.x, end.y))
+        return {};
+
+    ArenaScope arena;
+    std::pmr::memory_resource *memory = arena.resource();
 
-    std::priority_queue<Node> open_set;
-    std::unordered_map<Node, Node, std::hash<Node>> came_from; // откуда мы пришли к каждому узлу
-    std::unordered_map<Node, float, std::hash<Node>> g_score;
+    const int width = grid.width();
+    std::priority_queue<Node, std::pmr::vector<Node>> open_set{std::less<Node>(), std::pmr::vector<Node>(memory)};
+    std::pmr::vector<uint8_t> came_from(grid.cellCount(), NoParent, memory); // направление шага, которым пришли в каждую ячейку
+    std::pmr::vector<int> g_score(grid.cellCount(), INT_MAX, memory);        // стоимость лучшего найденного пути до каждой ячейки
+    auto cell = [width](const Node &node) { return size_t(node.y) * width + node.x; };
 
-    g_score[start] = 0;
-    open_set.push(start);
-    came_from[start] = start;
+    // Объем памяти состояния поиска: выдано ареной, а без арены - размер контейнеров
+    auto memoryUsage = [&]() {
+        if (arena.bytesUsed() > 0)
+            return (long long)arena.bytesUsed();
+        return (long long)(stats->peakOpenSize * sizeof(Node))
+               + (long long)came_from.size()
+               + (long long)(g_score.size() * sizeof(int));
+    };
+
+    if (tree != nullptr) {
+        tree->start = Node{start.x, start.y};
+        tree->width = width;
+        tree->height = grid.height();
+        tree->complete = false;
+        tree->directions.assign(grid.cellCount(), SearchTree::Unreached);
+    }
+
+    g_score[cell(start)] = 0;
+    open_set.push(Node{start.x, start.y});
+    came_from[cell(start)] = StartCell;
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = 1);
 
     while(!open_set.empty()) {
         Node current = open_set.top();
+        SEARCH_STATS(stats, ++stats->expansions);
 
         if(current.x == end.x && current.y == end.y) {
-            std::vector<Node> path = {end};
-            while(path.back().x != start.x || path.back().y != start.y)
-                path.push_back(came_from[path.back()]);
-            std::reverse(path.begin(), path.end());
-            return path;
+            SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+
+            if (tree != nullptr)
+                tree->directions[cell(current)] = came_from[cell(current)];
+
+            // Восстанавливаем путь от конца к началу по направлениям шагов
+            return CompactPath::fromParents(came_from.data(), width, start, end, StartCell);
         }
         open_set.pop();
 
-        for(const auto& [dx, dy]: directions) {
-            Node neighbor{current.x + dx, current.y + dy};
+        // Устаревшая копия узла: к нему уже найден более короткий путь
+        if(current.g > g_score[cell(current)]) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        SEARCH_STATS(stats, if (stats->recordExpansions) stats->expansionOrder.push_back(current.y * width + current.x));
+        if (tree != nullptr)
+            tree->directions[cell(current)] = came_from[cell(current)];
+
+        for(uint8_t d = 0; d < 4; ++d) {
+            Node neighbor{current.x + CompactPath::dx[d], current.y + CompactPath::dy[d]};
 
-            if(isValid(neighbor.x, neighbor.y, grid.size(), grid[0].size(), grid)) {
-                float tentative_g_score = g_score[current] + manhattanDistance(current, neighbor);
+            if(isValid(neighbor.x, neighbor.y, grid)) {
+                int tentative_g_score = current.g + manhattanDistance(current, neighbor);
 
-                if(g_score.find(neighbor) == g_score.end() || tentative_g_score < g_score[neighbor]) {
-                    came_from[neighbor] = current;
-                    g_score[neighbor] = tentative_g_score;
+                if(tentative_g_score < g_score[cell(neighbor)]) {
+                    came_from[cell(neighbor)] = d;
+                    g_score[cell(neighbor)] = tentative_g_score;
                     neighbor.g = tentative_g_score;
                     neighbor.h = manhattanDistance(neighbor, end);
                     neighbor.f =  neighbor.g +  neighbor.h;
                     open_set.push(neighbor);
+                    SEARCH_STATS(stats, ++stats->pushes;
+                                 stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, open_set.size()));
                 }
             }
         }
     }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+    if (tree != nullptr)
+        tree->complete = true;
     return {}; // Если путь не найден
 }
+
+/**
+ * @brief Поиск пути с использованием алгоритма A*.
+ *
+ * Возвращает путь в виде вектора узлов; сам поиск выполняет a_star_search_compact().
+ *
+ * @param grid Сетка, представляющая блокировку ячеек.
+ * @param start Начальный узел.
+ * @param end Конечный узел.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return Вектор узлов, представляющий найденный путь. Если путь не найден, возвращается пустой вектор.
+ */
+std::vector<Node> a_star_search(const Grid& grid, const Node& start, const Node& end, SearchStats *stats) {
+    return a_star_search_compact(grid, start, end, stats).toNodes();
+}
@@ -1,7 +1,13 @@
 #pragma once
 
+#include "grid.h"
+#include "searchstats.h"
+
 #include <vector>
 
+class CompactPath;
+struct SearchTree;
+
 /**
  * @brief Структура узла (Node) для алгоритма A*.
  *
@@ -37,14 +43,43 @@ struct Node {
     }
 };
 
+/**
+ * @brief Запрос на поиск пути (пара начальной и конечной точек).
+ */
+struct Query {
+    Node start; /**< Начальная точка. */
+    Node goal;  /**< Конечная точка. */
+};
+
 /**
  * @brief Алгоритм A* для поиска кратчайшего пути.
  *
  * Использует алгоритм A* для поиска кратчайшего пути от начального узла до конечного узла на сетке с блокировками.
  *
- * @param grid Сетка, представляющая блокировки ячеек. Значение true означает заблокированную ячейку.
+ * @param grid Сетка, представляющая блокировки ячеек.
  * @param start Начальный узел пути.
  * @param end Конечный узел пути.
+ * @param stats Статистика поиска (может быть nullptr).
  * @return Вектор узлов, представляющий найденный путь. Если путь не найден, возвращается пустой вектор.
  */
-std::vector<Node> a_star_search(const std::vector<std::vector<bool> > &grid, const Node& start, const Node& end);
+std::vector<Node> a_star_search(const Grid &grid, const Node& start, const Node& end, SearchStats *stats = nullptr);
+
+/**
+ * @brief Алгоритм A* с компактным результатом.
+ *
+ * То же, что a_star_search(), но путь возвращается в виде CompactPath (compactpath.h):
+ * начальная ячейка и 2-битные коды шагов.
+ *
+ * Если передано дерево tree (pathcache.h), в него записываются направления шагов для всех
+ * закрытых поиском ячеек: пути до них из start кратчайшие и могут быть восстановлены
+ * без повторного поиска.
+ *
+ * @param grid Сетка, представляющая блокировки ячеек.
+ * @param start Начальный узел пути.
+ * @param end Конечный узел пути.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @param tree Дерево поиска для заполнения (может быть nullptr).
+ * @return Компактный путь. Если путь не найден, возвращается пустой путь.
+ */
+CompactPath a_star_search_compact(const Grid &grid, const Node& start, const Node& end, SearchStats *stats = nullptr,
+                                  SearchTree *tree = nullptr);
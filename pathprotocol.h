@@ -0,0 +1,92 @@
+#pragma once
+
+#include "pathfinding.h"
+
+#include <QtEndian>
+
+/**
+ * @brief Двоичный протокол сервера запросов путей (PathServer).
+ *
+ * Клиент отправляет запросы записями фиксированного размера и может не дожидаться
+ * ответов: сервер объединяет запросы всех клиентов в пакеты и отвечает по мере их
+ * решения, поэтому порядок ответов может отличаться от порядка запросов. Ответ
+ * сопоставляется с запросом по номеру, который выбирает клиент. Все числа - little-endian.
+ *
+ * Запрос (RequestSize байт): номер (uint32), номер карты (uint16), флаги (uint8),
+ * резерв (uint8), sx, sy, gx, gy (int32).
+ *
+ * Ответ (ResponseSize байт и коды шагов): номер (uint32), длина пути в шагах или
+ * NotFound/BadRequest (int32), размер кодов шагов в байтах (uint32), затем коды шагов
+ * (коды CompactPath::Direction по 2 бита, младшие биты - первый шаг), если запрос был
+ * с флагом WantPath и путь найден.
+ */
+namespace PathProtocol {
+
+constexpr int RequestSize = 24;     /**< Размер записи запроса. */
+constexpr int ResponseSize = 12;    /**< Размер заголовка ответа. */
+
+constexpr quint8 WantPath = 1;      /**< Флаг запроса: вернуть коды шагов пути. */
+
+constexpr qint32 NotFound = -1;     /**< Длина в ответе: путь не существует. */
+constexpr qint32 BadRequest = -2;   /**< Длина в ответе: неизвестная карта или точки вне ее. */
+
+/**
+ * @brief Запрос пути.
+ */
+struct Request {
+    quint32 id {0};     /**< Номер запроса, выбранный клиентом. */
+    quint16 map {0};    /**< Номер карты на сервере. */
+    quint8 flags {0};   /**< Флаги (WantPath). */
+    Query query {{0, 0}, {0, 0}};   /**< Начальная и конечная точки. */
+};
+
+/**
+ * @brief Заголовок ответа.
+ */
+struct Response {
+    quint32 id {0};         /**< Номер запроса. */
+    qint32 length {0};      /**< Длина пути в шагах, NotFound или BadRequest. */
+    quint32 codeBytes {0};  /**< Размер следующих за заголовком кодов шагов. */
+};
+
+/** @brief Запись запроса в буфер размером RequestSize. */
+inline void writeRequest(const Request &request, char *out)
+{
+    qToLittleEndian<quint32>(request.id, out);
+    qToLittleEndian<quint16>(request.map, out + 4);
+    out[6] = char(request.flags);
+    out[7] = 0;
+    qToLittleEndian<qint32>(request.query.start.x, out + 8);
+    qToLittleEndian<qint32>(request.query.start.y, out + 12);
+    qToLittleEndian<qint32>(request.query.goal.x, out + 16);
+    qToLittleEndian<qint32>(request.query.goal.y, out + 20);
+}
+
+/** @brief Чтение запроса из буфера размером RequestSize. */
+inline Request readRequest(const char *in)
+{
+    Request request;
+    request.id = qFromLittleEndian<quint32>(in);
+    request.map = qFromLittleEndian<quint16>(in + 4);
+    request.flags = quint8(in[6]);
+    request.query.start = Node{qFromLittleEndian<qint32>(in + 8), qFromLittleEndian<qint32>(in + 12)};
+    request.query.goal = Node{qFromLittleEndian<qint32>(in + 16), qFromLittleEndian<qint32>(in + 20)};
+    return request;
+}
+
+/** @brief Запись заголовка ответа в буфер размером ResponseSize. */
+inline void writeResponse(const Response &response, char *out)
+{
+    qToLittleEndian<quint32>(response.id, out);
+    qToLittleEndian<qint32>(response.length, out + 4);
+    qToLittleEndian<quint32>(response.codeBytes, out + 8);
+}
+
+/** @brief Чтение заголовка ответа из буфера размером ResponseSize. */
+inline Response readResponse(const char *in)
+{
+    return Response{qFromLittleEndian<quint32>(in), qFromLittleEndian<qint32>(in + 4),
+                    qFromLittleEndian<quint32>(in + 8)};
+}
+
+}
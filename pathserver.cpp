@@ -0,0 +1,245 @@
+#include "pathserver.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+const size_t MaxBatch = 4096;   // наибольшее количество запросов в пакете
+
+}
+
+/**
+ * @brief Конструктор класса PathServer.
+ *
+ * @param parent Указатель на родительский объект.
+ */
+PathServer::PathServer(QObject *parent)
+    : QObject(parent), m_server(new QLocalServer(this))
+{
+    connect(m_server, &QLocalServer::newConnection, this, &PathServer::acceptConnections);
+    connect(&m_watcher, &QFutureWatcher<void>::finished, this, &PathServer::finishBatch);
+}
+
+/**
+ * @brief Деструктор класса PathServer: дожидается решения текущего пакета.
+ */
+PathServer::~PathServer()
+{
+    m_watcher.waitForFinished();
+}
+
+/**
+ * @brief Запуск сервера.
+ *
+ * Оставшийся после аварийного завершения сокет с тем же именем удаляется.
+ *
+ * @param name Имя сервера (имя сокета или полный путь к нему).
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если сервер принимает соединения.
+ */
+bool PathServer::listen(const QString &name, QString *error)
+{
+    close();
+    QLocalServer::removeServer(name);
+    if (m_server->listen(name))
+        return true;
+    if (error != nullptr)
+        *error = tr("Не удалось запустить сервер %1: %2").arg(name, m_server->errorString());
+    return false;
+}
+
+/**
+ * @brief Остановка сервера и закрытие всех соединений.
+ *
+ * Запросы, ожидающие ответа, отбрасываются; решаемый пакет завершается без ответов.
+ */
+void PathServer::close()
+{
+    m_server->close();
+    m_queue.clear();
+    for (QLocalSocket *socket : findChildren<QLocalSocket *>())
+        socket->abort();
+}
+
+/**
+ * @brief Принимает ли сервер соединения.
+ */
+bool PathServer::isListening() const
+{
+    return m_server->isListening();
+}
+
+/**
+ * @brief Полное имя сервера (путь к сокету), по которому подключаются клиенты.
+ */
+QString PathServer::fullServerName() const
+{
+    return m_server->fullServerName();
+}
+
+/**
+ * @brief Загрузка или замена карты.
+ *
+ * Уже полученные запросы решаются на прежней карте: каждый запрос удерживает карту,
+ * для которой он пришел. Записи кэша путей для прежней карты не удаляются сразу
+ * (в кэше могут быть пути других карт), а вытесняются по мере заполнения кэша.
+ * Секция таблицы первых ходов разбирается и не хранится (в памяти остается только
+ * разобранная таблица). Таблица, которая не подходит к сетке или повреждена, не
+ * используется: карта все равно загружается и пути на ней ищутся A*, а функция
+ * возвращает false с описанием ошибки.
+ *
+ * @param id Номер карты в запросах.
+ * @param map Карта (сетка и индексы).
+ * @param error Описание ошибки таблицы первых ходов (может быть nullptr).
+ * @return false, если таблица первых ходов есть, но не загружена.
+ */
+bool PathServer::setMap(quint16 id, const MapData &map, QString *error)
+{
+    auto served = std::make_shared<ServedMap>();
+    served->data = map;
+    const QByteArray table = served->data.indices.take(MapFormat::FirstMoveTag);
+    std::string tableError;
+    const bool loaded = table.isEmpty()
+                        || FirstMoveTable::deserialize(reinterpret_cast<const uint8_t *>(table.constData()),
+                                                       size_t(table.size()), map.grid, served->firstMoves, &tableError);
+    m_maps.insert(id, std::move(served));
+    if (!loaded && error != nullptr)
+        *error = QString::fromStdString(tableError);
+    return loaded;
+}
+
+/**
+ * @brief Удаление карты.
+ *
+ * @param id Номер карты.
+ */
+void PathServer::removeMap(quint16 id)
+{
+    m_maps.remove(id);
+}
+
+/**
+ * @brief Прием новых соединений.
+ */
+void PathServer::acceptConnections()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        ++m_counters.connections;
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket] { readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+/**
+ * @brief Чтение запросов из соединения.
+ *
+ * Запросы с неизвестной картой или точками вне карты получают ответ сразу, остальные
+ * ставятся в очередь следующего пакета. Пакет запускается после возврата в цикл событий,
+ * чтобы в него попали запросы всех соединений, данные которых уже получены.
+ *
+ * @param socket Соединение клиента.
+ */
+void PathServer::readRequests(QLocalSocket *socket)
+{
+    char buffer[PathProtocol::RequestSize];
+    while (socket->bytesAvailable() >= PathProtocol::RequestSize) {
+        socket->read(buffer, sizeof(buffer));
+        ++m_counters.queries;
+
+        Pending pending;
+        pending.socket = socket;
+        pending.request = PathProtocol::readRequest(buffer);
+        pending.map = m_maps.value(pending.request.map);
+        const Query &query = pending.request.query;
+        if (!pending.map || !pending.map->data.grid.contains(query.start.x, query.start.y)
+            || !pending.map->data.grid.contains(query.goal.x, query.goal.y)) {
+            pending.length = PathProtocol::BadRequest;
+            reply(socket, pending);
+            continue;
+        }
+        m_queue.push_back(std::move(pending));
+    }
+
+    if (!m_queue.empty() && !m_dispatchQueued) {
+        m_dispatchQueued = true;
+        QMetaObject::invokeMethod(this, &PathServer::dispatch, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Запуск решения следующего пакета, если предыдущий уже решен.
+ */
+void PathServer::dispatch()
+{
+    m_dispatchQueued = false;
+    if (m_watcher.isRunning() || m_queue.empty())
+        return;
+
+    const size_t count = std::min(MaxBatch, m_queue.size());
+    m_batch.assign(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.begin() + count));
+    m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+    m_counters.largestBatch = std::max<long long>(m_counters.largestBatch, count);
+
+    m_batchTimer.start();
+    m_watcher.setFuture(QtConcurrent::map(m_batch, [this](Pending &pending) { solve(pending); }));
+}
+
+/**
+ * @brief Отправка ответов решенного пакета и запуск следующего.
+ */
+void PathServer::finishBatch()
+{
+    const qint64 elapsed = m_batchTimer.nsecsElapsed();
+    for (const Pending &pending : m_batch) {
+        if (pending.socket && pending.socket->state() == QLocalSocket::ConnectedState)
+            reply(pending.socket, pending);
+    }
+    const int size = int(m_batch.size());
+    m_batch.clear();
+    ++m_counters.batches;
+    m_counters.batched += size;
+    emit batchFinished(size, elapsed);
+    dispatch();
+}
+
+/**
+ * @brief Решение одного запроса (выполняется в потоке пула).
+ *
+ * Как и в консольном решателе, запрос с заблокированной начальной или конечной
+ * ячейкой не решается.
+ *
+ * @param pending Запрос; в нем сохраняются длина и, при флаге WantPath, путь.
+ */
+void PathServer::solve(Pending &pending)
+{
+    const Grid &grid = pending.map->data.grid;
+    const Query &query = pending.request.query;
+    if (!grid.isFree(query.start.x, query.start.y) || !grid.isFree(query.goal.x, query.goal.y))
+        return;
+
+    const FirstMoveTable &table = pending.map->firstMoves;
+    CompactPath path = table.isEmpty() ? m_cache.find(grid, query.start, query.goal) : table.path(query.start, query.goal);
+    pending.length = path.empty() ? PathProtocol::NotFound : qint32(path.steps());
+    if (pending.request.flags & PathProtocol::WantPath)
+        pending.path = std::move(path);
+}
+
+/**
+ * @brief Отправка ответа на запрос.
+ *
+ * @param socket Соединение клиента.
+ * @param pending Решенный запрос.
+ */
+void PathServer::reply(QLocalSocket *socket, const Pending &pending)
+{
+    const std::vector<uint8_t> &codes = pending.path.codes();
+    char header[PathProtocol::ResponseSize];
+    PathProtocol::writeResponse({pending.request.id, pending.length, quint32(codes.size())}, header);
+    socket->write(header, sizeof(header));
+    if (!codes.empty())
+        socket->write(reinterpret_cast<const char *>(codes.data()), qint64(codes.size()));
+}
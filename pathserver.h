@@ -0,0 +1,106 @@
+#pragma once
+
+#include "compactpath.h"
+#include "firstmove.h"
+#include "mapformat.h"
+#include "pathcache.h"
+#include "pathprotocol.h"
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+
+#include <memory>
+#include <vector>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @brief Сервер запросов путей для других процессов (PathServer).
+ *
+ * Принимает соединения QLocalServer (Unix-сокет или именованный канал Windows) и
+ * отвечает на запросы в двоичном протоколе PathProtocol. Загруженные карты вместе
+ * с секциями предвычисленных индексов и кэш путей (PathCache) остаются в памяти
+ * между запросами. Если в карте есть таблица первых ходов (секция FMOV), пути
+ * извлекаются из нее без поиска и без кэша.
+ *
+ * Запросы всех клиентов, пришедшие за одну итерацию цикла событий, объединяются в пакет,
+ * который решается пулом потоков (QtConcurrent::map). Пока пакет решается, новые запросы
+ * накапливаются и образуют следующий пакет, поэтому размер пакета растет вместе с
+ * нагрузкой. Сокеты используются только в потоке сервера.
+ */
+class PathServer : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Счетчики сервера.
+     */
+    struct Counters {
+        long long connections {0};  /**< Принятых соединений. */
+        long long queries {0};      /**< Полученных запросов. */
+        long long batches {0};      /**< Решенных пакетов. */
+        long long batched {0};      /**< Запросов в решенных пакетах (без сразу отклоненных). */
+        long long largestBatch {0}; /**< Наибольший размер пакета. */
+    };
+
+    explicit PathServer(QObject *parent = nullptr);
+    ~PathServer() override;
+
+    bool listen(const QString &name, QString *error = nullptr);
+    void close();
+    bool isListening() const;
+    QString fullServerName() const;
+
+    bool setMap(quint16 id, const MapData &map, QString *error = nullptr);
+    void removeMap(quint16 id);
+
+    void setCacheCapacity(size_t bytes) { m_cache.setCapacity(bytes); }    /**< Ограничение памяти кэша путей. */
+    const Counters &counters() const { return m_counters; }
+    PathCache::Counters cacheCounters() const { return m_cache.counters(); }
+
+signals:
+    void batchFinished(int size, qint64 elapsedNs);
+
+private slots:
+    void acceptConnections();
+    void dispatch();
+    void finishBatch();
+
+private:
+    /**
+     * @brief Загруженная карта.
+     */
+    struct ServedMap {
+        MapData data;               /**< Сетка и секции индексов. */
+        FirstMoveTable firstMoves;  /**< Таблица первых ходов из секции FMOV (пустая, если ее нет). */
+    };
+
+    /**
+     * @brief Запрос, ожидающий ответа.
+     */
+    struct Pending {
+        QPointer<QLocalSocket> socket;          /**< Соединение клиента (обнуляется при его закрытии). */
+        PathProtocol::Request request;          /**< Запрос. */
+        std::shared_ptr<const ServedMap> map;   /**< Карта на момент получения запроса. */
+        qint32 length {PathProtocol::NotFound}; /**< Длина найденного пути. */
+        CompactPath path;                       /**< Путь (только при флаге WantPath). */
+    };
+
+    QLocalServer *m_server;                                 /**< Сервер локальных соединений. */
+    QHash<quint16, std::shared_ptr<const ServedMap>> m_maps;    /**< Загруженные карты по номерам. */
+    PathCache m_cache;                                      /**< Кэш путей, общий для всех клиентов. */
+    std::vector<Pending> m_queue;                           /**< Запросы следующего пакета. */
+    std::vector<Pending> m_batch;                           /**< Решаемый пакет. */
+    QFutureWatcher<void> m_watcher;                         /**< Монитор решения пакета. */
+    QElapsedTimer m_batchTimer;                             /**< Время решения пакета. */
+    bool m_dispatchQueued {false};                          /**< Запуск пакета уже запланирован. */
+    Counters m_counters;                                    /**< Счетчики сервера. */
+
+    void readRequests(QLocalSocket *socket);
+    void solve(Pending &pending);
+    static void reply(QLocalSocket *socket, const Pending &pending);
+};
@@ -1,10 +1,13 @@
 #include "scene.h"
-#include "box.h"
+#include "griditem.h"
+#include "trace.h"
 
 #include <QGraphicsSceneMouseEvent>
 #include <QDebug>
 #include <QMessageBox>
 
+#include <algorithm>
+
 /**
  * @brief Конструктор класса Scene.
  *
@@ -19,49 +22,82 @@ Scene::Scene(QObject *parent)
 }
 
 /**
- * @brief Получение конечного элемента пути.
+ * @brief Установка элемента сетки.
  *
- * Возвращает указатель на конечный элемент (Box) пути.
+ * Элемент должен быть уже добавлен на сцену; выбор начальной и конечной ячеек сбрасывается.
  *
- * @return Указатель на конечный элемент пути.
+ * @param item Элемент сетки.
  */
-Box *Scene::endItem() const
+void Scene::setGridItem(GridItem *item)
 {
-    return m_endItem;
+    clearScene(false);
+    m_gridItem = item;
 }
 
 
 /**
- * @brief Получение начального элемента пути.
+ * @brief Очистка сцены.
  *
- * Возвращает указатель на начальный элемент (Box) пути.
+ * Сбрасывает выбор начальной и конечной ячеек пути. Если параметр `all` установлен в `true`, очищает все элементы сцены.
  *
- * @return Указатель на начальный элемент пути.
+ * @param all Флаг, определяющий, нужно ли очистить все элементы сцены (`true`) или только начальную и конечную ячейки (`false`).
  */
-Box *Scene::startItem() const
+void Scene::clearScene(bool all)
 {
-    return m_startItem;
+    m_start = m_end = m_currentCell = QPoint(-1, -1);
+    m_extraEnds.clear();
+    if (m_gridItem != nullptr) {
+        m_gridItem->setStart(m_start);
+        m_gridItem->setEnds({});
+    }
+    if (all) {
+        clear();
+        m_gridItem = nullptr;
+    }
 }
 
-
 /**
- * @brief Очистка сцены.
+ * @brief Выбор начальной и конечной ячеек пути.
  *
- * Удаляет начальный и конечный элементы пути. Если параметр `all` установлен в `true`, очищает все элементы сцены.
+ * Снимает предыдущее выделение и отмечает переданные ячейки как начало и конец пути.
  *
- * @param all Флаг, определяющий, нужно ли очистить все элементы сцены (`true`) или только начальный и конечный элементы (`false`).
+ * @param start Начальная ячейка пути.
+ * @param end Конечная ячейка пути.
  */
-void Scene::clearScene(bool all)
+void Scene::selectPath(const QPoint &start, const QPoint &end)
 {
-    if (m_startItem != nullptr) {
-        m_startItem->setStart(false);
-        m_startItem = nullptr;
-    }
-    if (m_endItem != nullptr) {
-        m_endItem->setEnd(false);
-        m_endItem = nullptr;
-    }
-    if (all) clear();
+    clearScene(false);
+    if (m_gridItem == nullptr || !m_gridItem->contains(start) || !m_gridItem->contains(end) || start == end)
+        return;
+
+    m_start = start;
+    m_gridItem->setStart(m_start);
+    m_end = end;
+    showEnds();
+}
+
+/**
+ * @brief Все цели пути.
+ *
+ * @return Конечная ячейка и дополнительные цели; пустой список, если конечная ячейка не выбрана.
+ */
+std::vector<QPoint> Scene::endCells() const
+{
+    std::vector<QPoint> cells;
+    if (!hasEnd())
+        return cells;
+    cells.push_back(m_end);
+    cells.insert(cells.end(), m_extraEnds.begin(), m_extraEnds.end());
+    return cells;
+}
+
+/**
+ * @brief Отметка всех целей пути на элементе сетки.
+ */
+void Scene::showEnds()
+{
+    if (m_gridItem != nullptr)
+        m_gridItem->setEnds(endCells());
 }
 
 /**
@@ -78,25 +114,82 @@ void Scene::startAnimated(bool start)
     m_startAnimated = start;
 }
 
+/**
+ * @brief Включение режима рисования стен.
+ *
+ * В режиме рисования левая кнопка мыши ставит стены, правая - убирает их;
+ * выбор начальной и конечной точек пути при этом отключен.
+ *
+ * @param edit Флаг режима рисования.
+ */
+void Scene::setEditMode(bool edit)
+{
+    m_editMode = edit;
+    m_painting = false;
+}
+
+/**
+ * @brief Поиск ячейки под указанной точкой сцены.
+ *
+ * Ячейка вычисляется по координатам, поэтому пути и отметки агентов над сеткой не мешают выбору.
+ *
+ * @param pos Точка сцены.
+ * @return Ячейка под точкой или (-1, -1), если точка вне сетки.
+ */
+QPoint Scene::cellAt(const QPointF &pos) const
+{
+    return m_gridItem != nullptr ? m_gridItem->cellAt(m_gridItem->mapFromScene(pos)) : QPoint(-1, -1);
+}
+
+/**
+ * @brief Рисование отрезка до указанной ячейки.
+ *
+ * Испускает сигнал cellPainted() для каждой ячейки отрезка от последней закрашенной
+ * ячейки до указанной, чтобы быстрое движение мыши не оставляло разрывов.
+ *
+ * @param cell Ячейка, до которой нужно провести отрезок.
+ */
+void Scene::paintTo(const QPoint &cell)
+{
+    const QPoint delta = cell - m_lastCell;
+    const int steps = qMax(qAbs(delta.x()), qAbs(delta.y()));
+    for (int i = 1; i <= steps; ++i) {
+        const QPoint p(m_lastCell.x() + qRound(qreal(delta.x()) * i / steps),
+                       m_lastCell.y() + qRound(qreal(delta.y()) * i / steps));
+        emit cellPainted(p, m_paintBlocked);
+    }
+    m_lastCell = cell;
+}
+
 /**
  * @brief Обработчик события перемещения мыши.
  *
  * Обрабатывает событие перемещения мыши на сцене при активированной анимации. Если мышь перемещается над новым элементом, он становится конечным элементом, и испускается сигнал animated().
+ * Частоту запуска поиска ограничивает получатель сигнала, поэтому сигнал испускается при каждой смене ячейки.
  *
  * @param event Указатель на событие перемещения мыши.
  */
 void Scene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 {
-    if (m_startAnimated && m_startItem != nullptr) {
-        QPointF pos = event->scenePos();
-        auto *item = qgraphicsitem_cast<Box*>(itemAt(pos,QTransform()));
+    Trace::Scope trace("Scene::mouseMoveEvent");
+    if (m_editMode) {
+        if (!m_painting)
+            return;
+        const QPoint cell = cellAt(event->scenePos());
+        if (cell.x() >= 0)
+            paintTo(cell);
+        return;
+    }
 
-        if (item == nullptr)
+    if (m_startAnimated && hasStart()) {
+        const QPoint cell = cellAt(event->scenePos());
+        if (cell.x() < 0)
             return;
 
-        if (item != m_currentItem) {
-            m_currentItem = item;
-            m_endItem = item;
+        // Курсор остался в пределах текущей ячейки - новый поиск не нужен
+        if (cell != m_currentCell) {
+            m_currentCell = cell;
+            m_end = cell;
             emit animated();
         }
     }
@@ -106,54 +199,87 @@ void Scene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
  * @brief Обработчик события нажатия мыши.
  *
  * Обрабатывает событие нажатия левой кнопки мыши на сцене. Если анимация запущена и начальный элемент уже выбран, событие игнорируется.
+ * В режиме рисования стен нажатие начинает рисование. Щелчок с Ctrl при выбранных начале и конце
+ * пути добавляет дополнительную цель "B" или убирает ее; путь тогда ищется до ближайшей из целей.
  *
  * @param event Указатель на событие нажатия мыши.
  */
 void Scene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
+    if (m_editMode) {
+        if (event->button() != Qt::LeftButton && event->button() != Qt::RightButton)
+            return;
+        const QPoint cell = cellAt(event->scenePos());
+        if (cell.x() < 0)
+            return;
+        m_painting = true;
+        m_paintBlocked = event->button() == Qt::LeftButton;
+        m_lastCell = cell;
+        emit cellPainted(m_lastCell, m_paintBlocked);
+        return;
+    }
+
     if ((event->button() == Qt::RightButton) && m_startAnimated) {
         startAnimated(true);
         return;
     }
 
-    if ((event->button() != Qt::LeftButton) || (m_startAnimated && m_startItem !=nullptr))
+    if ((event->button() != Qt::LeftButton) || (m_startAnimated && hasStart()))
         return;
 
-    QPointF pos = event->scenePos();
-    auto *item = qgraphicsitem_cast<Box*>(itemAt(pos,QTransform()));
-
-    if (item == nullptr)
+    const QPoint cell = cellAt(event->scenePos());
+    if (cell.x() < 0)
         return;
 
     auto *widgetParent = (parent()->parent()->isWidgetType())?static_cast<QWidget*>(parent()->parent()):nullptr;
 
-    if (item->isBusy()) {
+    if (m_gridItem->isBlocked(cell)) {
         QMessageBox::warning(widgetParent, tr("Внимание!"),tr("Эта ячейка не доступна!\n"
                                                                "Выберите другую ячейку."));
         return;
     }
 
-    if (m_startItem != nullptr && m_endItem != nullptr) {
-        m_startItem->setStart(false);
-        m_endItem->setEnd(false);
-        m_startItem = nullptr;
-        m_endItem = nullptr;
+    // Ctrl + щелчок при выбранном маршруте добавляет или убирает дополнительную цель
+    if ((event->modifiers() & Qt::ControlModifier) && !m_startAnimated && hasStart() && hasEnd()) {
+        if (cell == m_start || cell == m_end)
+            return;
+        auto extra = std::find(m_extraEnds.begin(), m_extraEnds.end(), cell);
+        if (extra != m_extraEnds.end())
+            m_extraEnds.erase(extra);
+        else
+            m_extraEnds.push_back(cell);
+        showEnds();
+        return;
     }
 
-    if (m_startItem == nullptr) {
-        m_startItem = item;
-        m_startItem->setStart(true);
+    if (hasStart() && hasEnd())
+        clearScene(false);
+
+    if (!hasStart()) {
+        m_start = cell;
+        m_gridItem->setStart(m_start);
     }
     else {
-        m_endItem = item;
-        if (m_startItem == m_endItem) {
+        if (m_start == cell) {
             QMessageBox::warning(widgetParent, tr("Внимание!"),tr("Начало пути не может совпадать с концом пути!\n"
                                                                    "Выберите другую точку."));
-            m_endItem = nullptr;
         }
-        else
-            m_endItem->setEnd(true);
+        else {
+            m_end = cell;
+            showEnds();
+        }
     }
-    update();
 }
 
+/**
+ * @brief Обработчик события отпускания кнопки мыши.
+ *
+ * Завершает рисование стен.
+ *
+ * @param event Указатель на событие отпускания кнопки мыши.
+ */
+void Scene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+{
+    m_painting = false;
+    QGraphicsScene::mouseReleaseEvent(event);
+}
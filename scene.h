@@ -2,7 +2,9 @@
 
 #include <QGraphicsScene>
 
-class Box;
+#include <vector>
+
+class GridItem;
 
 /**
  * @brief Класс графической сцены (Scene) на основе QGraphicsScene.
@@ -16,23 +18,43 @@ class Scene : public QGraphicsScene
 public:
     explicit Scene(QObject *parent = nullptr);
 
-    Box *startItem() const;
-    Box *endItem() const;
+    void setGridItem(GridItem *item);
+    GridItem *gridItem() const { return m_gridItem; }  /**< Элемент сетки (nullptr, если сетки нет). */
+
+    bool hasStart() const { return m_start.x() >= 0; } /**< Выбрана ли начальная ячейка пути. */
+    bool hasEnd() const { return m_end.x() >= 0; }     /**< Выбрана ли конечная ячейка пути. */
+    QPoint startCell() const { return m_start; }       /**< Начальная ячейка пути ((-1, -1), если не выбрана). */
+    QPoint endCell() const { return m_end; }           /**< Конечная ячейка пути ((-1, -1), если не выбрана). */
+    std::vector<QPoint> endCells() const;
 
     void clearScene(bool all = true);
+    void selectPath(const QPoint &start, const QPoint &end);
     void startAnimated(bool start);
+    void setEditMode(bool edit);
 
 signals:
     void animated();
+    void cellPainted(const QPoint &cell, bool blocked);
 
 protected:
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
     bool m_startAnimated {false};   /**< Флаг запуска анимации отрисовки пути. */
-    Box *m_currentItem;              /**< Текущий выбранный элемент. */
-    Box *m_startItem {nullptr};     /**< Начальный элемент пути. */
-    Box *m_endItem {nullptr};        /**< Конечный элемент пути. */
+    GridItem *m_gridItem {nullptr}; /**< Элемент сетки. */
+    QPoint m_currentCell {-1, -1};  /**< Текущая ячейка под курсором. */
+    QPoint m_start {-1, -1};        /**< Начальная ячейка пути. */
+    QPoint m_end {-1, -1};          /**< Конечная ячейка пути. */
+    std::vector<QPoint> m_extraEnds;    /**< Дополнительные цели (поиск до ближайшей цели). */
+    bool m_editMode {false};        /**< Режим рисования стен. */
+    bool m_painting {false};        /**< Идет ли сейчас рисование (кнопка мыши нажата). */
+    bool m_paintBlocked {true};     /**< Ставить (true) или убирать (false) стены при рисовании. */
+    QPoint m_lastCell;              /**< Последняя закрашенная ячейка. */
+
+    QPoint cellAt(const QPointF &pos) const;
+    void showEnds();
+    void paintTo(const QPoint &cell);
 
 };
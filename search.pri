@@ -0,0 +1,45 @@
+# Ядро поиска пути без зависимостей от Qt: сетка, генераторы карт и алгоритмы поиска.
+# Подключается всеми целями, включая тесты и бенчмарки.
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/anyangle.cpp \
+    $$PWD/anytime.cpp \
+    $$PWD/compactpath.cpp \
+    $$PWD/firstmove.cpp \
+    $$PWD/grid.cpp \
+    $$PWD/mapgen.cpp \
+    $$PWD/multiagent.cpp \
+    $$PWD/multigoal.cpp \
+    $$PWD/pathcache.cpp \
+    $$PWD/pathfinding.cpp \
+    $$PWD/searcharena.cpp \
+    $$PWD/sssp.cpp \
+    $$PWD/tiledgrid.cpp \
+    $$PWD/trace.cpp
+
+HEADERS += \
+    $$PWD/anyangle.h \
+    $$PWD/anytime.h \
+    $$PWD/compactpath.h \
+    $$PWD/firstmove.h \
+    $$PWD/grid.h \
+    $$PWD/mapgen.h \
+    $$PWD/multiagent.h \
+    $$PWD/multigoal.h \
+    $$PWD/parallel.h \
+    $$PWD/pathcache.h \
+    $$PWD/pathfinding.h \
+    $$PWD/searcharena.h \
+    $$PWD/searchstats.h \
+    $$PWD/sssp.h \
+    $$PWD/tiledgrid.h \
+    $$PWD/trace.h
+
+# Сборка без сбора статистики поиска: qmake CONFIG+=nostats
+nostats: DEFINES += FINDPATH_NO_STATS
+
+# Сборка без трассировки этапов запросов: qmake CONFIG+=notrace
+notrace: DEFINES += FINDPATH_NO_TRACE
@@ -0,0 +1,182 @@
+#include "searcharena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+const size_t MinBlockSize = 64 * 1024;  // минимальный размер блока арены
+const size_t MaxRetainedSize = 64 * 1024 * 1024;    // наибольший объем блоков, сохраняемых после сброса
+std::atomic<bool> g_enabled {true};     // арены включены (выключаются для сравнения в бенчмарках)
+thread_local int t_depth = 0;           // глубина вложенности ArenaScope в текущем потоке
+
+}
+
+/**
+ * @brief Деструктор арены: освобождает все блоки.
+ */
+SearchArena::~SearchArena()
+{
+    releaseBlocks();
+}
+
+/**
+ * @brief Арена текущего потока.
+ *
+ * @return Ссылка на арену, принадлежащую вызывающему потоку.
+ */
+SearchArena &SearchArena::local()
+{
+    thread_local SearchArena arena;
+    return arena;
+}
+
+/**
+ * @brief Включение или отключение арен.
+ *
+ * При отключении ArenaScope выдает стандартный распределитель new/delete.
+ * Используется для сравнения в бенчмарках.
+ *
+ * @param enabled Использовать ли арены.
+ */
+void SearchArena::setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Проверка, включены ли арены.
+ */
+bool SearchArena::isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Суммарный размер блоков арены.
+ */
+size_t SearchArena::capacity() const
+{
+    size_t total = 0;
+    for (const Block &block : m_blocks)
+        total += block.size;
+    return total;
+}
+
+/**
+ * @brief Сброс арены.
+ *
+ * Вся выданная память считается свободной. Блоки сверх MaxRetainedSize освобождаются
+ * (начиная с последних, самых крупных), чтобы поток не удерживал до конца жизни память
+ * самого большого обслуженного запроса. Если осталось несколько блоков, они заменяются
+ * одним блоком суммарного размера.
+ */
+void SearchArena::reset()
+{
+    while (!m_blocks.empty() && capacity() > MaxRetainedSize) {
+        ::operator delete(m_blocks.back().data);
+        m_blocks.pop_back();
+    }
+    if (m_blocks.size() > 1) {
+        const size_t total = capacity();
+        releaseBlocks();
+        addBlock(total);
+    }
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+/**
+ * @brief Выделение памяти из арены.
+ *
+ * @param bytes Размер запрашиваемой памяти.
+ * @param alignment Требуемое выравнивание.
+ * @return Указатель на выделенную память.
+ */
+void *SearchArena::do_allocate(size_t bytes, size_t alignment)
+{
+    for (;;) {
+        if (m_current < m_blocks.size()) {
+            Block &block = m_blocks[m_current];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+            const size_t aligned = size_t(((base + m_offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base);
+            if (aligned + bytes <= block.size) {
+                m_offset = aligned + bytes;
+                m_used += bytes;
+                return block.data + aligned;
+            }
+            if (m_current + 1 < m_blocks.size()) {
+                ++m_current;
+                m_offset = 0;
+                continue;
+            }
+        }
+        addBlock(bytes + alignment);
+        m_current = m_blocks.size() - 1;
+        m_offset = 0;
+    }
+}
+
+/**
+ * @brief Добавление нового блока.
+ *
+ * Размер блока не меньше запрошенного и не меньше половины суммарного размера уже
+ * имеющихся блоков (но не больше MaxRetainedSize), поэтому количество блоков растет
+ * логарифмически, а неиспользованный остаток последнего блока невелик.
+ *
+ * @param minSize Минимальный размер блока.
+ */
+void SearchArena::addBlock(size_t minSize)
+{
+    const size_t size = std::max({minSize, MinBlockSize, std::min(capacity() / 2, MaxRetainedSize)});
+    m_blocks.push_back({static_cast<char *>(::operator new(size)), size});
+    ++m_blockAllocations;
+}
+
+/**
+ * @brief Освобождение всех блоков.
+ */
+void SearchArena::releaseBlocks()
+{
+    for (const Block &block : m_blocks)
+        ::operator delete(block.data);
+    m_blocks.clear();
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+/**
+ * @brief Конструктор области использования арены.
+ *
+ * Выбирает арену текущего потока или, если арены отключены, стандартный распределитель.
+ */
+ArenaScope::ArenaScope()
+    : m_arena(SearchArena::isEnabled() ? &SearchArena::local() : nullptr),
+    m_resource(m_arena != nullptr ? static_cast<std::pmr::memory_resource *>(m_arena) : std::pmr::new_delete_resource())
+{
+    if (m_arena != nullptr)
+        ++t_depth;
+}
+
+/**
+ * @brief Деструктор области: сбрасывает арену при выходе из внешней области.
+ */
+ArenaScope::~ArenaScope()
+{
+    if (m_arena != nullptr && --t_depth == 0)
+        m_arena->reset();
+}
+
+/**
+ * @brief Объем памяти, выданной ареной с момента последнего сброса.
+ *
+ * @return Количество байт или 0, если арены отключены.
+ */
+size_t ArenaScope::bytesUsed() const
+{
+    return m_arena != nullptr ? m_arena->bytesUsed() : 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Арена памяти для состояния поиска (SearchArena).
+ *
+ * Монотонный распределитель: память выдается последовательно из крупных блоков,
+ * освобождение отдельных объектов ничего не делает, а reset() за O(1) возвращает
+ * арену в исходное состояние, сохраняя блоки для следующего запроса. Если за запрос
+ * понадобилось несколько блоков, при сбросе они объединяются в один, поэтому после
+ * первых запросов поиск обходится без обращений к системному распределителю.
+ * Сохраняется не больше 64 МБ: память более крупных запросов возвращается системе.
+ *
+ * У каждого потока своя арена (local()), поэтому потоки пула не конкурируют
+ * за общий распределитель.
+ */
+class SearchArena : public std::pmr::memory_resource
+{
+public:
+    SearchArena() = default;
+    ~SearchArena() override;
+
+    SearchArena(const SearchArena &) = delete;
+    SearchArena &operator=(const SearchArena &) = delete;
+
+    static SearchArena &local();
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    void reset();
+    size_t bytesUsed() const { return m_used; }             /**< Выдано байт с момента сброса. */
+    size_t capacity() const;                                /**< Суммарный размер блоков. */
+    long long blockAllocations() const { return m_blockAllocations; }   /**< Выделено блоков за все время. */
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+private:
+    /**
+     * @brief Блок памяти арены.
+     */
+    struct Block {
+        char *data;     /**< Начало блока. */
+        size_t size;    /**< Размер блока. */
+    };
+
+    std::vector<Block> m_blocks;    /**< Блоки арены. */
+    size_t m_current {0};           /**< Номер текущего блока. */
+    size_t m_offset {0};            /**< Смещение свободной памяти в текущем блоке. */
+    size_t m_used {0};              /**< Выдано байт с момента сброса. */
+    long long m_blockAllocations {0};   /**< Счетчик выделенных блоков. */
+
+    void addBlock(size_t minSize);
+    void releaseBlocks();
+};
+
+/**
+ * @brief Область использования арены текущего потока (ArenaScope).
+ *
+ * Пока существует хотя бы одна область, арена потока не сбрасывается; при выходе из
+ * внешней области она сбрасывается. Поэтому вложенные поиски (например, поиск внутри
+ * другого алгоритма) безопасно используют одну и ту же арену.
+ */
+class ArenaScope
+{
+public:
+    ArenaScope();
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    std::pmr::memory_resource *resource() const { return m_resource; }  /**< Ресурс памяти для контейнеров. */
+    size_t bytesUsed() const;
+
+private:
+    SearchArena *m_arena;                       /**< Арена потока или nullptr, если арены отключены. */
+    std::pmr::memory_resource *m_resource;      /**< Ресурс памяти для контейнеров. */
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief Статистика выполнения поиска.
+ *
+ * Заполняется алгоритмом поиска, если вызывающая сторона передала указатель на нее.
+ * При сборке с FINDPATH_NO_STATS (qmake CONFIG += nostats) сбор статистики полностью
+ * исключается из кода алгоритмов, и структура остается нулевой.
+ */
+struct SearchStats {
+    long long expansions {0};       /**< Количество узлов, извлеченных из открытого списка. */
+    long long pushes {0};           /**< Количество добавлений в открытый список. */
+    long long duplicatePops {0};    /**< Извлечения устаревших копий узлов. */
+    long long peakOpenSize {0};     /**< Максимальный размер открытого списка. */
+    long long peakMemoryBytes {0};  /**< Оценка максимального объема памяти состояния поиска. */
+    long long elapsedNs {0};        /**< Время поиска в наносекундах. */
+    long long cacheHits {0};        /**< Ответов из кэша путей (PathCache). */
+    long long cacheMisses {0};      /**< Промахов кэша путей, потребовавших поиска. */
+
+    bool recordExpansions {false};  /**< Записывать ли порядок раскрытия ячеек. */
+    std::vector<int> expansionOrder;    /**< Индексы (y * width + x) раскрытых ячеек по порядку. */
+};
+
+#ifdef FINDPATH_NO_STATS
+
+// Выражение остается видимым компилятору (для проверки типов и отсутствия предупреждений
+// о неиспользуемых переменных), но никогда не выполняется и удаляется оптимизатором.
+#define SEARCH_STATS(stats, ...) do { if (false) { __VA_ARGS__; } } while (false)
+
+/**
+ * @brief Заглушка таймера поиска для сборки без статистики.
+ */
+class SearchTimer
+{
+public:
+    explicit SearchTimer(SearchStats *) {}
+};
+
+#else
+
+/**
+ * @brief Выполнение выражения сбора статистики, если статистика запрошена.
+ */
+#define SEARCH_STATS(stats, ...) do { if (stats) { __VA_ARGS__; } } while (false)
+
+/**
+ * @brief Таймер поиска.
+ *
+ * Записывает в статистику время от создания до разрушения объекта.
+ */
+class SearchTimer
+{
+public:
+    explicit SearchTimer(SearchStats *stats)
+        : m_stats(stats)
+    {
+        if (m_stats != nullptr)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+    ~SearchTimer()
+    {
+        if (m_stats != nullptr)
+            m_stats->elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    SearchTimer(const SearchTimer &) = delete;
+    SearchTimer &operator=(const SearchTimer &) = delete;
+
+private:
+    SearchStats *m_stats;   /**< Заполняемая статистика. */
+    std::chrono::steady_clock::time_point m_start;  /**< Момент начала поиска. */
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "console.h"
+#include "mapformat.h"
+#include "pathserver.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace {
+
+const int ReportIntervalMs = 5000;  // период вывода счетчиков сервера
+
+using Console::tr;
+
+}
+
+/**
+ * @brief Точка входа сервера запросов путей.
+ *
+ * Загружает карты (номер карты в запросах - ее порядковый номер в командной строке),
+ * запускает PathServer и периодически печатает в stderr количество запросов, пакетов
+ * и попаданий в кэш путей.
+ *
+ * @param argc Количество аргументов командной строки.
+ * @param argv Массив строковых аргументов командной строки.
+ * @return Код завершения: 0 при успехе, 1 при ошибке.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("findPathServer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Сервер запросов кратчайших путей для других процессов."));
+    parser.addHelpOption();
+    parser.addPositionalArgument("maps", tr("Файлы карт (.fpmap или MovingAI .map); номер карты - ее позиция."), "map...");
+    QCommandLineOption nameOption({"n", "name"}, tr("Имя сервера (локального сокета)."), "name", "findpath");
+    QCommandLineOption threadsOption({"j", "threads"}, tr("Количество рабочих потоков."), "n");
+    QCommandLineOption cacheOption("cache", tr("Объем кэша путей в МБ."), "mb", "64");
+    parser.addOptions({nameOption, threadsOption, cacheOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.isEmpty() || args.size() > 0x10000) {
+        err << parser.helpText();
+        return 1;
+    }
+
+    if (parser.isSet(threadsOption)) {
+        const int threads = parser.value(threadsOption).toInt();
+        if (threads > 0)
+            QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+
+    PathServer server;
+    for (int i = 0; i < args.size(); ++i) {
+        MapData map;
+        QString error;
+        if (!MapFormat::loadAny(args[i], map, &error)) {
+            err << error << Qt::endl;
+            return 1;
+        }
+        const bool hasTable = map.indices.contains(MapFormat::FirstMoveTag);
+        const bool tableLoaded = server.setMap(quint16(i), map, &error);
+        err << tr("Карта %1: %2 (%3 x %4)").arg(i).arg(args[i]).arg(map.grid.width()).arg(map.grid.height())
+            << (hasTable && tableLoaded ? tr(", с таблицей первых ходов") : QString()) << Qt::endl;
+        if (!tableLoaded)
+            err << tr("Таблица первых ходов не используется, пути ищутся A*: %1").arg(error) << Qt::endl;
+    }
+    server.setCacheCapacity(size_t(qMax(1, parser.value(cacheOption).toInt())) << 20);
+
+    QString error;
+    if (!server.listen(parser.value(nameOption), &error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    err << tr("Сервер запущен: %1").arg(server.fullServerName()) << Qt::endl;
+
+    QTimer report;
+    long long reported = 0;
+    QObject::connect(&report, &QTimer::timeout, [&] {
+        const PathServer::Counters &c = server.counters();
+        if (c.queries == reported)
+            return;
+        reported = c.queries;
+        const PathCache::Counters cache = server.cacheCounters();
+        err << tr("Соединений: %1, запросов: %2, пакетов: %3 (средний %4, наибольший %5), кэш: %6 попаданий, %7 промахов")
+                   .arg(c.connections).arg(c.queries).arg(c.batches)
+                   .arg(c.batches > 0 ? double(c.batched) / c.batches : 0.0, 0, 'f', 1).arg(c.largestBatch)
+                   .arg(cache.hits + cache.prefixHits + cache.treeHits).arg(cache.misses)
+            << Qt::endl;
+    });
+    report.start(ReportIntervalMs);
+
+    return app.exec();
+}
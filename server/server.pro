@@ -0,0 +1,22 @@
+QT = core concurrent network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = findPathServer
+
+SOURCES += \
+    main.cpp \
+    ../pathserver.cpp
+
+HEADERS += \
+    ../console.h \
+    ../pathprotocol.h \
+    ../pathserver.h
+
+include(../core.pri)
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,424 @@
+#include "sssp.h"
+#include "parallel.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <queue>
+#include <thread>
+
+namespace {
+
+const uint32_t Unreachable = DistanceMap::Unreachable;
+const uint32_t MaxCost = 255;           // наибольшая стоимость ячейки (Grid::cost())
+const uint32_t DefaultDelta = 256;      // ширина корзины по умолчанию: около двух шагов наибольшей стоимости
+const size_t ChunkSize = 128;           // записей фронта, забираемых потоком за раз
+
+/**
+ * @brief Пустой результат: все ячейки недостижимы.
+ */
+DistanceMap emptyMap(const Grid &grid, const Node &source)
+{
+    DistanceMap map;
+    map.tree.start = Node{source.x, source.y};
+    map.tree.width = grid.width();
+    map.tree.height = grid.height();
+    map.tree.complete = true;
+    map.tree.directions.assign(grid.cellCount(), SearchTree::Unreached);
+    map.distances.assign(grid.cellCount(), Unreachable);
+    return map;
+}
+
+/**
+ * @brief Выбор родителей ячеек строки y по уже вычисленным расстояниям.
+ *
+ * Родитель - сосед, расстояние до которого плюс стоимость ячейки равно ее расстоянию;
+ * из нескольких таких соседей выбирается шаг с наименьшим кодом направления.
+ */
+void assignParents(const Grid &grid, DistanceMap &map, int y)
+{
+    const int width = grid.width();
+    const uint32_t *distances = map.distances.data();
+    uint8_t *directions = map.tree.directions.data();
+    for (int x = 0; x < width; ++x) {
+        const size_t cell = size_t(y) * width + x;
+        const uint32_t distance = distances[cell];
+        if (distance == Unreachable)
+            continue;
+        if (distance == 0) {
+            directions[cell] = SearchTree::Root;
+            continue;
+        }
+        const uint32_t cost = uint32_t(grid.cost(x, y));
+        for (uint8_t d = 0; d < 4; ++d) {
+            const int px = x - CompactPath::dx[d];
+            const int py = y - CompactPath::dy[d];
+            if (!grid.contains(px, py))
+                continue;
+            const uint32_t parent = distances[size_t(py) * width + px];
+            if (parent != Unreachable && parent + cost == distance) {
+                directions[cell] = d;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Барьер для группы потоков с активным ожиданием.
+ *
+ * Фазы дельта-шагов короткие (микросекунды), поэтому потоки ждут друг друга без
+ * засыпания, уступая процессор после нескольких проверок.
+ */
+class SpinBarrier
+{
+public:
+    explicit SpinBarrier(int count) : m_count(count) {}
+
+    void wait()
+    {
+        const unsigned generation = m_generation.load(std::memory_order_acquire);
+        if (m_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == m_count) {
+            m_waiting.store(0, std::memory_order_relaxed);
+            m_generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; m_generation.load(std::memory_order_acquire) == generation; ++spins) {
+            if (spins >= 64)
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    const int m_count;                      /**< Количество потоков. */
+    std::atomic<int> m_waiting {0};         /**< Потоков, дошедших до барьера. */
+    std::atomic<unsigned> m_generation {0}; /**< Номер прохождения барьера. */
+};
+
+/**
+ * @brief Параллельный алгоритм дельта-шагов.
+ *
+ * Ячейки с предварительными расстояниями лежат в корзинах шириной delta: корзина i
+ * содержит расстояния [i * delta, (i + 1) * delta). Корзины обрабатываются по порядку;
+ * записи наименьшей непустой корзины (фронт) раздаются потокам порциями, и каждый поток
+ * ослабляет ребра своих записей. Расстояния уменьшаются атомарным сравнением с обменом,
+ * а улучшенная ячейка попадает в корзину потока, который ее улучшил, без синхронизации.
+ * Ребро стоит не больше MaxCost, поэтому все новые записи попадают в ближайшие
+ * MaxCost / delta + 1 корзин, которые хранятся по кругу. Корзина обрабатывается, пока
+ * ослабления ребер добавляют в нее записи; после этого ее расстояния окончательны.
+ */
+class DeltaStepping
+{
+public:
+    DeltaStepping(const Grid &grid, uint32_t delta, int threads)
+        : m_grid(grid), m_delta(delta), m_bucketCount((MaxCost + delta - 1) / delta + 1),
+          m_distances(new std::atomic<uint32_t>[grid.cellCount()]), m_locals(size_t(threads)),
+          m_offsets(size_t(threads) + 1, 0), m_barrier(threads)
+    {
+        for (Local &local : m_locals)
+            local.buckets.resize(m_bucketCount);
+    }
+
+    /**
+     * @brief Вычисление расстояний от source (вызывается всеми потоками группы).
+     *
+     * @param thread Номер потока в группе (поток 0 выбирает корзины).
+     */
+    void run(int thread)
+    {
+        Local &local = m_locals[size_t(thread)];
+        for (;;) {
+            m_barrier.wait();
+            if (thread == 0)
+                selectFrontier();
+            m_barrier.wait();
+            if (m_done)
+                return;
+
+            const size_t total = m_offsets.back();
+            for (size_t begin = m_next.fetch_add(ChunkSize, std::memory_order_relaxed); begin < total;
+                 begin = m_next.fetch_add(ChunkSize, std::memory_order_relaxed)) {
+                const size_t end = std::min(total, begin + ChunkSize);
+                size_t part = size_t(std::upper_bound(m_offsets.begin(), m_offsets.end(), begin) - m_offsets.begin()) - 1;
+                for (size_t i = begin; i < end; ++i) {
+                    while (i >= m_offsets[part + 1])
+                        ++part;
+                    relax(local, m_locals[part].frontier[i - m_offsets[part]]);
+                }
+            }
+        }
+    }
+
+    void start(size_t source)
+    {
+        for (size_t cell = 0; cell < m_grid.cellCount(); ++cell)
+            m_distances[cell].store(Unreachable, std::memory_order_relaxed);
+        m_distances[source].store(0, std::memory_order_relaxed);
+        m_locals[0].buckets[0].push_back({uint32_t(source), 0});
+    }
+
+    uint32_t distance(size_t cell) const { return m_distances[cell].load(std::memory_order_relaxed); }
+
+    long long relaxations() const
+    {
+        long long total = 0;
+        for (const Local &local : m_locals)
+            total += local.relaxations;
+        return total;
+    }
+
+    long long pushes() const
+    {
+        long long total = 0;
+        for (const Local &local : m_locals)
+            total += local.pushes;
+        return total;
+    }
+
+    long long peakBytes() const
+    {
+        long long total = (long long)(m_grid.cellCount() * sizeof(uint32_t));
+        for (const Local &local : m_locals)
+            total += local.peakEntries * (long long)sizeof(Entry);
+        return total;
+    }
+
+private:
+    /**
+     * @brief Запись корзины: ячейка и расстояние, с которым она была добавлена.
+     *
+     * Если расстояние ячейки с тех пор уменьшилось, запись устарела и пропускается.
+     */
+    struct Entry {
+        uint32_t cell;
+        uint32_t distance;
+    };
+
+    /**
+     * @brief Данные одного потока (на отдельной строке кэша).
+     */
+    struct alignas(64) Local {
+        std::vector<std::vector<Entry>> buckets;    /**< Корзины потока (по кругу). */
+        std::vector<Entry> frontier;                /**< Доля потока во фронте текущей фазы. */
+        long long relaxations {0};                  /**< Обработанных записей. */
+        long long pushes {0};                       /**< Добавленных записей. */
+        long long peakEntries {0};                  /**< Наибольшее количество записей в корзинах. */
+    };
+
+    const Grid &m_grid;
+    const uint32_t m_delta;
+    const size_t m_bucketCount;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_distances;
+    std::vector<Local> m_locals;
+    std::vector<size_t> m_offsets;      // начала долей потоков во фронте (префиксные суммы)
+    std::atomic<size_t> m_next {0};     // следующая нераспределенная запись фронта
+    SpinBarrier m_barrier;
+    uint64_t m_current {0};             // номер обрабатываемой корзины
+    bool m_done {false};
+
+    /**
+     * @brief Выбор фронта следующей фазы (поток 0, остальные ждут на барьере).
+     *
+     * Если текущая корзина опустела во всех потоках, выбирается следующая непустая.
+     * Корзины потоков обмениваются с их долями фронта без копирования.
+     */
+    void selectFrontier()
+    {
+        size_t slot = 0;
+        size_t scanned = 0;
+        for (; scanned < m_bucketCount; ++scanned, ++m_current) {
+            slot = size_t(m_current % m_bucketCount);
+            const bool empty = std::all_of(m_locals.begin(), m_locals.end(),
+                                           [slot](const Local &local) { return local.buckets[slot].empty(); });
+            if (!empty)
+                break;
+        }
+        if (scanned == m_bucketCount) {
+            m_done = true;
+            return;
+        }
+
+        for (size_t t = 0; t < m_locals.size(); ++t) {
+            Local &local = m_locals[t];
+            long long entries = 0;
+            for (const std::vector<Entry> &bucket : local.buckets)
+                entries += (long long)bucket.size();
+            local.peakEntries = std::max(local.peakEntries, entries);
+            local.frontier.swap(local.buckets[slot]);
+            local.buckets[slot].clear();
+            m_offsets[t + 1] = m_offsets[t] + local.frontier.size();
+        }
+        m_next.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Ослабление ребер из ячейки записи.
+     */
+    void relax(Local &local, const Entry &entry)
+    {
+        if (m_distances[entry.cell].load(std::memory_order_relaxed) != entry.distance)
+            return;
+        ++local.relaxations;
+        const int width = m_grid.width();
+        const int x = int(entry.cell % uint32_t(width));
+        const int y = int(entry.cell / uint32_t(width));
+        for (int d = 0; d < 4; ++d) {
+            const int nx = x + CompactPath::dx[d];
+            const int ny = y + CompactPath::dy[d];
+            if (!m_grid.isFree(nx, ny))
+                continue;
+            const uint32_t next = uint32_t(ny) * uint32_t(width) + uint32_t(nx);
+            const uint32_t distance = entry.distance + uint32_t(m_grid.cost(nx, ny));
+            uint32_t current = m_distances[next].load(std::memory_order_relaxed);
+            while (distance < current) {
+                if (m_distances[next].compare_exchange_weak(current, distance, std::memory_order_relaxed)) {
+                    local.buckets[(distance / m_delta) % m_bucketCount].push_back({next, distance});
+                    ++local.pushes;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+}
+
+/**
+ * @brief Расстояние до ячейки.
+ *
+ * @param goal Ячейка.
+ * @return Длина кратчайшего пути или Unreachable, если ячейка вне сетки или недостижима.
+ */
+uint32_t DistanceMap::distanceTo(const Node &goal) const
+{
+    if (goal.x < 0 || goal.x >= tree.width || goal.y < 0 || goal.y >= tree.height)
+        return Unreachable;
+    return distances[size_t(goal.y) * tree.width + goal.x];
+}
+
+/**
+ * @brief Кратчайший путь к ячейке.
+ *
+ * @param goal Ячейка.
+ * @return Путь от начальной ячейки; пустой, если ячейка недостижима.
+ */
+CompactPath DistanceMap::pathTo(const Node &goal) const
+{
+    if (!tree.covers(goal))
+        return {};
+    return tree.pathTo(goal);
+}
+
+/**
+ * @brief Расстояния от одной ячейки до всех ячеек алгоритмом Дейкстры.
+ *
+ * Последовательный эталон для delta_stepping_distances(): та же очередь с приоритетом,
+ * что и в a_star_search_compact(), без эвристики и без цели. Очередь размещается в арене
+ * текущего потока.
+ *
+ * @param grid Сетка со стоимостями (не больше DistanceMap::MaxCells ячеек).
+ * @param source Начальная ячейка.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return Расстояния и дерево кратчайших путей; все ячейки недостижимы, если начальная
+ *         ячейка заблокирована или сетка слишком велика.
+ */
+DistanceMap dijkstra_distances(const Grid &grid, const Node &source, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    DistanceMap map = emptyMap(grid, source);
+    if (!grid.isFree(source.x, source.y) || grid.cellCount() > DistanceMap::MaxCells)
+        return map;
+
+    ArenaScope arena;
+    const int width = grid.width();
+    uint32_t *distances = map.distances.data();
+    // Ключ очереди: расстояние в старших 32 битах, ячейка - в младших
+    std::priority_queue<uint64_t, std::pmr::vector<uint64_t>, std::greater<uint64_t>> open{
+        std::greater<uint64_t>(), std::pmr::vector<uint64_t>(arena.resource())};
+    const size_t start = size_t(source.y) * width + source.x;
+    distances[start] = 0;
+    open.push(start);
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = 1);
+
+    while (!open.empty()) {
+        const uint64_t key = open.top();
+        open.pop();
+        const uint32_t distance = uint32_t(key >> 32);
+        const uint32_t cell = uint32_t(key);
+        if (distance != distances[cell]) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        SEARCH_STATS(stats, ++stats->expansions);
+
+        const int x = int(cell % uint32_t(width));
+        const int y = int(cell / uint32_t(width));
+        for (int d = 0; d < 4; ++d) {
+            const int nx = x + CompactPath::dx[d];
+            const int ny = y + CompactPath::dy[d];
+            if (!grid.isFree(nx, ny))
+                continue;
+            const size_t next = size_t(ny) * width + nx;
+            const uint32_t nextDistance = distance + uint32_t(grid.cost(nx, ny));
+            if (nextDistance < distances[next]) {
+                distances[next] = nextDistance;
+                open.push(uint64_t(nextDistance) << 32 | next);
+                SEARCH_STATS(stats, ++stats->pushes;
+                             stats->peakOpenSize = std::max(stats->peakOpenSize, (long long)open.size()));
+            }
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = (long long)arena.bytesUsed());
+
+    for (int y = 0; y < grid.height(); ++y)
+        assignParents(grid, map, y);
+    return map;
+}
+
+/**
+ * @brief Расстояния от одной ячейки до всех ячеек параллельным алгоритмом дельта-шагов.
+ *
+ * Дает те же расстояния и то же дерево кратчайших путей, что и dijkstra_distances(),
+ * распределяя ослабления ребер по потокам (см. DeltaStepping). Небольшая delta
+ * приближает алгоритм к Дейкстре (меньше повторных ослаблений, но меньше работы на
+ * фазу), большая - к Беллману-Форду. Выбор родителей по готовым расстояниям также
+ * выполняется параллельно, по строкам.
+ *
+ * @param grid Сетка со стоимостями (не больше DistanceMap::MaxCells ячеек).
+ * @param source Начальная ячейка.
+ * @param threads Количество потоков (0 - по числу ядер).
+ * @param delta Ширина корзины (0 - DefaultDelta).
+ * @param stats Статистика (может быть nullptr): expansions - обработанные записи корзин,
+ *        pushes - улучшения расстояний.
+ * @return Расстояния и дерево кратчайших путей; все ячейки недостижимы, если начальная
+ *         ячейка заблокирована или сетка слишком велика.
+ */
+DistanceMap delta_stepping_distances(const Grid &grid, const Node &source, int threads, uint32_t delta,
+                                     SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    DistanceMap map = emptyMap(grid, source);
+    if (!grid.isFree(source.x, source.y) || grid.cellCount() > DistanceMap::MaxCells)
+        return map;
+
+    threads = Parallel::threadCount(threads);
+    DeltaStepping engine(grid, delta > 0 ? delta : DefaultDelta, threads);
+    engine.start(size_t(source.y) * grid.width() + source.x);
+    // Каждый поток группы получает ровно одну итерацию: run() не завершается, пока все
+    // потоки не пройдут последний барьер
+    Parallel::parallelFor(threads, threads, [&engine](int thread) { engine.run(thread); });
+
+    const int width = grid.width();
+    Parallel::parallelFor(grid.height(), threads, [&](int y) {
+        for (int x = 0; x < width; ++x)
+            map.distances[size_t(y) * width + x] = engine.distance(size_t(y) * width + x);
+    });
+    Parallel::parallelFor(grid.height(), threads, [&](int y) { assignParents(grid, map, y); });
+
+    SEARCH_STATS(stats, stats->expansions = engine.relaxations(); stats->pushes = engine.pushes();
+                 stats->peakMemoryBytes = engine.peakBytes());
+    return map;
+}
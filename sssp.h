@@ -0,0 +1,34 @@
+#pragma once
+
+#include "compactpath.h"
+#include "grid.h"
+#include "pathcache.h"
+#include "pathfinding.h"
+#include "searchstats.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Кратчайшие расстояния от одной ячейки до всех ячеек сетки со стоимостями (DistanceMap).
+ *
+ * Стоимость шага - стоимость ячейки, в которую он ведет (Grid::cost()); без слоя
+ * стоимостей все шаги стоят 1. Дерево кратчайших путей хранится направлениями шагов, как
+ * дерево поиска A* (SearchTree). Родитель ячейки определяется только расстояниями: из
+ * соседей, через которых проходит кратчайший путь, выбирается шаг с наименьшим кодом
+ * направления. Поэтому последовательный и параллельный алгоритмы дают одинаковые массивы.
+ */
+struct DistanceMap {
+    static constexpr uint32_t Unreachable = UINT32_MAX;    /**< Расстояние до недостижимой ячейки. */
+    static constexpr size_t MaxCells = (UINT32_MAX - 1) / 255;  /**< Наибольший размер сетки (расстояния в uint32). */
+
+    SearchTree tree;                    /**< Дерево кратчайших путей (complete = true). */
+    std::vector<uint32_t> distances;    /**< Расстояния (y * width + x) или Unreachable. */
+
+    uint32_t distanceTo(const Node &goal) const;
+    CompactPath pathTo(const Node &goal) const;
+};
+
+DistanceMap dijkstra_distances(const Grid &grid, const Node &source, SearchStats *stats = nullptr);
+DistanceMap delta_stepping_distances(const Grid &grid, const Node &source, int threads = 0, uint32_t delta = 0,
+                                     SearchStats *stats = nullptr);
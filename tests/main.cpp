@@ -0,0 +1,1179 @@
+#include "anyangle.h"
+#include "anytime.h"
+#include "compactpath.h"
+#include "firstmove.h"
+#include "mapgen.h"
+#include "multiagent.h"
+#include "multigoal.h"
+#include "parallel.h"
+#include "pathcache.h"
+#include "pathfinding.h"
+#include "searcharena.h"
+#include "sssp.h"
+#include "tiledgrid.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Проверяемый алгоритм поиска пути.
+ *
+ * Каждый новый вариант поиска добавляется в таблицу engines() и автоматически
+ * проходит все проверки корректности и оптимальности.
+ */
+struct Engine {
+    const char *name;   /**< Имя алгоритма в отчетах. */
+    std::function<std::vector<Node>(const Grid &, const Node &, const Node &)> search;  /**< Запуск поиска. */
+};
+
+const std::vector<Engine> &engines()
+{
+    static const std::vector<Engine> list {
+        {"a_star_search", [](const Grid &grid, const Node &start, const Node &goal) {
+             return a_star_search(grid, start, goal);
+         }},
+        {"a_star_search_compact", [](const Grid &grid, const Node &start, const Node &goal) {
+             return a_star_search_compact(grid, start, goal).toNodes();
+         }},
+        {"path_cache", [](const Grid &grid, const Node &start, const Node &goal) {
+             // Общий для всех карт и потоков кэш небольшого объема: проверяются и ответы
+             // из кэша, и вытеснение, и разделение записей по версиям сеток
+             static PathCache cache(1u << 20);
+             return cache.find(grid, start, goal).toNodes();
+         }},
+        {"ara_star_search", [](const Grid &grid, const Node &start, const Node &goal) {
+             return ara_star_search(grid, start, goal).toNodes();
+         }},
+        {"multi_goal_search", [](const Grid &grid, const Node &start, const Node &goal) {
+             return multi_goal_search(grid, start, {goal}).toNodes();
+         }},
+    };
+    return list;
+}
+
+/**
+ * @brief Эталонный поиск в ширину.
+ *
+ * @return Длина кратчайшего пути в шагах или -1, если цель недостижима.
+ */
+int bfsDistance(const Grid &grid, const Node &start, const Node &goal)
+{
+    std::vector<int> dist(grid.cellCount(), -1);
+    std::deque<Node> queue {start};
+    dist[size_t(start.y) * grid.width() + start.x] = 0;
+
+    const int dx[4] = {1, -1, 0, 0};
+    const int dy[4] = {0, 0, 1, -1};
+    while (!queue.empty()) {
+        Node cell = queue.front();
+        queue.pop_front();
+        const int d = dist[size_t(cell.y) * grid.width() + cell.x];
+        if (cell == goal)
+            return d;
+        for (int i = 0; i < 4; ++i) {
+            Node next {cell.x + dx[i], cell.y + dy[i]};
+            if (!grid.isFree(next.x, next.y))
+                continue;
+            int &nd = dist[size_t(next.y) * grid.width() + next.x];
+            if (nd < 0) {
+                nd = d + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Проверка найденного пути против эталона.
+ *
+ * @return Пустая строка, если путь корректен и оптимален; иначе описание ошибки.
+ */
+std::string checkPath(const Grid &grid, const Query &query, const std::vector<Node> &path, int expected)
+{
+    if (expected < 0)
+        return path.empty() ? std::string() : "path found for unreachable goal";
+    if (path.empty())
+        return "no path for reachable goal";
+    if (!(path.front() == query.start))
+        return "path does not begin at start";
+    if (!(path.back() == query.goal))
+        return "path does not end at goal";
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (!grid.isFree(path[i].x, path[i].y))
+            return "path crosses blocked cell #" + std::to_string(i);
+        if (i > 0 && std::abs(path[i].x - path[i - 1].x) + std::abs(path[i].y - path[i - 1].y) != 1)
+            return "path is not contiguous at step #" + std::to_string(i);
+    }
+    if (int(path.size()) - 1 != expected)
+        return "path length " + std::to_string(path.size() - 1) + " != BFS distance " + std::to_string(expected);
+    return {};
+}
+
+/**
+ * @brief Параметры одного случая проверки, достаточные для его воспроизведения.
+ */
+struct Case {
+    int width;
+    int height;
+    double density;
+    bool maze;
+    uint64_t seed;
+};
+
+Grid makeGrid(const Case &c)
+{
+    return c.maze ? MapGen::mazeGrid(c.width, c.height, c.seed) : MapGen::randomGrid(c.width, c.height, c.density, c.seed);
+}
+
+/**
+ * @brief Детерминированная серия случаев проверки: i-й случай вычисляется по номеру.
+ *
+ * Параметры задаются именованными методами, например
+ * CaseSeries(1000).widths(1, 37).heights(1, 41, 7).densities({0.0, 0.2}).mazes(11):
+ * ширина - min + (i * step) % range, высота - аналогично, плотность - по кругу из списка,
+ * лабиринт - каждый period-й случай со сдвигом phase, зерно - seed + i. У каждого набора
+ * проверок своя серия, чтобы наборы проходили разные карты.
+ */
+class CaseSeries
+{
+public:
+    explicit CaseSeries(uint64_t seed) : m_seed(seed) {}
+
+    /** @brief Ширины min + (i * step) % range. */
+    CaseSeries &widths(int min, int range, int step = 1)
+    {
+        m_width = {min, range, step};
+        return *this;
+    }
+
+    /** @brief Высоты min + (i * step) % range. */
+    CaseSeries &heights(int min, int range, int step = 1)
+    {
+        m_height = {min, range, step};
+        return *this;
+    }
+
+    /** @brief Плотности препятствий случайных карт, по кругу. */
+    CaseSeries &densities(std::vector<double> densities)
+    {
+        m_densities = std::move(densities);
+        return *this;
+    }
+
+    /** @brief Лабиринт вместо случайной карты в случаях с i % period == phase. */
+    CaseSeries &mazes(int period, int phase = 0)
+    {
+        m_mazePeriod = period;
+        m_mazePhase = phase;
+        return *this;
+    }
+
+    Case operator()(int i) const
+    {
+        return Case {m_width.at(i), m_height.at(i), m_densities[size_t(i) % m_densities.size()],
+                     i % m_mazePeriod == m_mazePhase, m_seed + uint64_t(i)};
+    }
+
+private:
+    struct Range {
+        int min, range, step;
+        int at(int i) const { return min + (i * step) % range; }
+    };
+
+    uint64_t m_seed;
+    Range m_width {1, 1, 1};
+    Range m_height {1, 1, 1};
+    std::vector<double> m_densities {0.0};
+    int m_mazePeriod {1};
+    int m_mazePhase {-1};
+};
+
+/**
+ * @brief Вывод ошибки со всеми параметрами, нужными для воспроизведения случая.
+ *
+ * @param name Имя проверяемой функции.
+ * @param error Описание ошибки.
+ * @param c Случай проверки.
+ * @param detail Запрос или другие входные данные случая (может быть пустым).
+ */
+void reportFailure(const char *name, const std::string &error, const Case &c, const std::string &detail = {})
+{
+    std::printf("FAIL %s: %s\n  grid %dx%d %s density=%.2f seed=%llu%s%s\n", name, error.c_str(), c.width, c.height,
+                c.maze ? "maze" : "random", c.density, static_cast<unsigned long long>(c.seed),
+                detail.empty() ? "" : " ", detail.c_str());
+}
+
+void reportFailure(const char *name, const std::string &error, const Case &c, const Query &query)
+{
+    const std::string from = "(" + std::to_string(query.start.x) + "," + std::to_string(query.start.y) + ")";
+    const std::string to = "(" + std::to_string(query.goal.x) + "," + std::to_string(query.goal.y) + ")";
+    reportFailure(name, error, c, "query " + from + "->" + to);
+}
+
+/**
+ * @brief Проверка всех алгоритмов на одной карте.
+ *
+ * @return Количество найденных ошибок.
+ */
+int runCase(const Case &c, int queriesPerGrid, long long &checks)
+{
+    const Grid grid = makeGrid(c);
+    std::vector<Query> queries = MapGen::randomQueries(grid, queriesPerGrid, c.seed * 31 + 7);
+    if (!queries.empty()) {
+        // Повторные запросы из одной начальной точки к разным целям и к точке на уже найденном пути
+        const size_t count = queries.size();
+        for (size_t i = 1; i < count; ++i)
+            queries.push_back({queries.front().start, queries[i].goal});
+        const std::vector<Node> path = a_star_search(grid, queries.front().start, queries.front().goal);
+        if (!path.empty())
+            queries.push_back({queries.front().start, path[path.size() / 2]});
+        queries.push_back(queries.front());
+        queries.push_back({queries.front().start, queries.front().start});
+    }
+
+    int failures = 0;
+    for (const Query &query : queries) {
+        const int expected = bfsDistance(grid, query.start, query.goal);
+        for (const Engine &engine : engines()) {
+            const std::string error = checkPath(grid, query, engine.search(grid, query.start, query.goal), expected);
+            ++checks;
+            if (error.empty())
+                continue;
+            ++failures;
+            reportFailure(engine.name, error, c, query);
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Систематическая проверка: фиксированный набор размеров, плотностей и seed.
+ */
+int runSuite(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(1000).widths(1, 37).heights(1, 41, 7).densities({0.0, 0.1, 0.2, 0.3, 0.4, 0.5}).mazes(11);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i)
+        failures += runCase(series(i), 8, checks);
+    return failures;
+}
+
+/**
+ * @brief Режим фаззинга: случайные параметры карт из генератора с заданным seed.
+ *
+ * Все параметры каждого случая печатаются при ошибке, поэтому любой сбой можно
+ * воспроизвести отдельно.
+ */
+int runFuzz(int iterations, uint64_t seed, long long &checks)
+{
+    SplitMix64 rng(seed);
+    int failures = 0;
+    for (int i = 0; i < iterations; ++i) {
+        Case c;
+        c.width = 1 + rng.bounded(96);
+        c.height = 1 + rng.bounded(96);
+        c.density = rng.bounded(60) / 100.0;
+        c.maze = rng.chance(0.1);
+        c.seed = rng.next();
+        failures += runCase(c, 1 + rng.bounded(16), checks);
+    }
+    return failures;
+}
+
+/**
+ * @brief Эталонная проверка прямой видимости.
+ *
+ * Перебирает все ячейки прямоугольника, охватывающего отрезок, и точно (в целых числах,
+ * в удвоенных координатах) проверяет пересечение отрезка с замкнутым квадратом ячейки.
+ */
+bool naiveLineOfSight(const Grid &grid, const Node &a, const Node &b)
+{
+    const long long ax = 2 * a.x, ay = 2 * a.y, bx = 2 * b.x, by = 2 * b.y;
+    auto side = [&](long long px, long long py) {
+        const long long cross = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+        return (cross > 0) - (cross < 0);
+    };
+    for (int y = std::min(a.y, b.y); y <= std::max(a.y, b.y); ++y) {
+        for (int x = std::min(a.x, b.x); x <= std::max(a.x, b.x); ++x) {
+            const long long corners[4][2] = {{2 * x - 1, 2 * y - 1}, {2 * x + 1, 2 * y - 1},
+                                             {2 * x - 1, 2 * y + 1}, {2 * x + 1, 2 * y + 1}};
+            bool positive = false;
+            bool negative = false;
+            for (const auto &corner : corners) {
+                const int s = side(corner[0], corner[1]);
+                positive |= s >= 0;
+                negative |= s <= 0;
+            }
+            if (positive && negative && grid.isBlocked(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Проверка пути по опорным точкам.
+ *
+ * @return Пустая строка, если путь корректен; иначе описание ошибки.
+ */
+std::string checkWaypoints(const Grid &grid, const Query &query, const std::vector<Node> &waypoints, int expected)
+{
+    if (expected < 0)
+        return waypoints.empty() ? std::string() : "path found for unreachable goal";
+    if (waypoints.empty())
+        return "no path for reachable goal";
+    if (!(waypoints.front() == query.start) || !(waypoints.back() == query.goal))
+        return "waypoints do not connect start and goal";
+    for (size_t i = 1; i < waypoints.size(); ++i) {
+        if (!naiveLineOfSight(grid, waypoints[i - 1], waypoints[i]))
+            return "no line of sight between waypoints #" + std::to_string(i - 1) + " and #" + std::to_string(i);
+    }
+    if (waypointLength(waypoints) > expected + 1e-3)
+        return "any-angle path is longer than the grid path";
+    return {};
+}
+
+/**
+ * @brief Проверка поиска под любыми углами и спрямления путей.
+ *
+ * Сравнивает lineOfSight() с эталоном на случайных отрезках и проверяет, что
+ * спрямленные пути A* и пути Theta* состоят из видимых отрезков, соединяют начало и
+ * цель и не длиннее кратчайшего пути по сетке.
+ */
+int runAnyAngle(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(5000).widths(1, 53).heights(1, 47, 5).densities({0.0, 0.1, 0.2, 0.3, 0.4}).mazes(13);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const Grid grid = makeGrid(c);
+        SplitMix64 rng(c.seed);
+        for (int k = 0; k < 32; ++k) {
+            const Node a {int(rng.bounded(c.width)), int(rng.bounded(c.height))};
+            const Node b {int(rng.bounded(c.width)), int(rng.bounded(c.height))};
+            ++checks;
+            if (lineOfSight(grid, a, b) != naiveLineOfSight(grid, a, b)) {
+                ++failures;
+                reportFailure("lineOfSight", "differs from the reference", c, Query{a, b});
+            }
+        }
+
+        for (const Query &query : MapGen::randomQueries(grid, 6, c.seed * 17 + 3)) {
+            const int expected = bfsDistance(grid, query.start, query.goal);
+            const std::pair<const char *, std::vector<Node>> results[] = {
+                {"pullString", pullString(grid, a_star_search_compact(grid, query.start, query.goal))},
+                {"theta_star_search", theta_star_search(grid, query.start, query.goal)},
+            };
+            for (const auto &result : results) {
+                const std::string error = checkWaypoints(grid, query, result.second, expected);
+                ++checks;
+                if (error.empty())
+                    continue;
+                ++failures;
+                reportFailure(result.first, error, c, query);
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка поиска с уточнением (ARA*).
+ *
+ * Поиск выполняется малыми порциями раскрытий; каждый промежуточный путь должен быть
+ * корректным, не длиннее предыдущего и не длиннее кратчайшего более чем в epsilon раз,
+ * а окончательный путь - кратчайшим.
+ */
+int runAnytime(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(9000).widths(1, 61).heights(1, 59, 7).densities({0.0, 0.15, 0.3, 0.4}).mazes(7);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const Grid grid = makeGrid(c);
+        for (const Query &query : MapGen::randomQueries(grid, 4, c.seed * 13 + 5)) {
+            const int expected = bfsDistance(grid, query.start, query.goal);
+            AnytimeSearch search(grid, query.start, query.goal, 1 + i % 5, 0.5);
+            std::string error;
+            size_t previous = SIZE_MAX;
+            while (error.empty() && !search.isFinished()) {
+                if (!search.improve(SearchBudget{1 + i % 40, 0}))
+                    continue;
+                const std::vector<Node> path = search.path().toNodes();
+                if (path.size() > previous)
+                    error = "refined path is longer than the previous one";
+                else if (expected < 0 || int(path.size()) - 1 < expected)
+                    error = "path is shorter than BFS distance";
+                else if (int(path.size()) - 1 > search.epsilon() * expected + 1e-9)
+                    error = "path exceeds the epsilon bound";
+                else
+                    error = checkPath(grid, query, path, int(path.size()) - 1);
+                previous = path.size();
+            }
+            if (error.empty())
+                error = checkPath(grid, query, search.path().toNodes(), expected);
+            ++checks;
+            if (error.empty())
+                continue;
+            ++failures;
+            reportFailure("AnytimeSearch", error, c, query);
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка поиска до ближайшей из нескольких целей.
+ *
+ * Число целей меняется от одной до сотни, поэтому проверяются оба режима поиска (с
+ * эвристикой и без). Путь должен вести к одной из целей, и его длина должна быть равна
+ * наименьшему расстоянию BFS до целей.
+ */
+int runMultiGoal(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(11000).widths(1, 47).heights(1, 43, 11).densities({0.0, 0.15, 0.3, 0.4}).mazes(11);
+    const int goalCounts[] = {1, 2, 5, 33, 100};
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const Grid grid = makeGrid(c);
+        SplitMix64 rng(c.seed);
+        int k = 0;
+        for (const Query &query : MapGen::randomQueries(grid, 3, c.seed * 7 + 1)) {
+            const Node start = query.start;
+            std::vector<Node> goals;
+            for (int g = 0; g < goalCounts[(i + k++) % 5]; ++g)
+                goals.push_back(Node{rng.bounded(c.width), rng.bounded(c.height)});
+
+            int expected = -1;
+            for (const Node &goal : goals) {
+                const int distance = bfsDistance(grid, start, goal);
+                if (distance >= 0 && (expected < 0 || distance < expected))
+                    expected = distance;
+            }
+
+            int reached = -1;
+            const std::vector<Node> path = multi_goal_search(grid, start, goals, nullptr, &reached).toNodes();
+            std::string error;
+            if (path.empty() != (reached < 0))
+                error = "reached goal index does not match the result";
+            else
+                error = checkPath(grid, Query{start, reached >= 0 ? goals[size_t(reached)] : goals.front()}, path,
+                                  expected);
+            ++checks;
+            if (error.empty())
+                continue;
+            ++failures;
+            reportFailure("multi_goal_search", error, c,
+                          "start (" + std::to_string(start.x) + "," + std::to_string(start.y) + ") goals="
+                              + std::to_string(goals.size()));
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка порядка байтов файла плиточной сетки.
+ *
+ * Заголовок и слова плиток записываются в little-endian независимо от платформы:
+ * сигнатура "FPTG", затем версия, ширина, высота и размер плитки; первые 64 ячейки
+ * первой строки карты - младшие биты первых байтов плитки.
+ *
+ * @return Пустая строка, если файл записан верно; иначе описание ошибки.
+ */
+std::string checkTileFile(const std::string &path, const Grid &grid)
+{
+    std::vector<unsigned char> bytes(TiledGrid::HeaderBytes + 8);
+    FILE *file = std::fopen(path.c_str(), "rb");
+    const bool read = file != nullptr && std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    if (file != nullptr)
+        std::fclose(file);
+    if (!read)
+        return "cannot read the tile file";
+    auto field = [&bytes](size_t offset) {
+        return uint32_t(bytes[offset]) | uint32_t(bytes[offset + 1]) << 8 | uint32_t(bytes[offset + 2]) << 16
+               | uint32_t(bytes[offset + 3]) << 24;
+    };
+    if (std::memcmp(bytes.data(), "FPTG", 4) != 0 || field(4) != 1 || field(8) != uint32_t(grid.width())
+        || field(12) != uint32_t(grid.height()) || field(16) != uint32_t(TiledGrid::TileSize))
+        return "tile file header is not little-endian";
+    for (int x = 0; x < std::min(64, grid.width()); ++x) {
+        if (((bytes[TiledGrid::HeaderBytes + size_t(x / 8)] >> (x % 8)) & 1) != unsigned(grid.isBlocked(x, 0)))
+            return "tile words are not little-endian";
+    }
+    return {};
+}
+
+/**
+ * @brief Проверка сетки во внешней памяти и поиска по ней.
+ *
+ * Карты размером в несколько плиток записываются во временный файл и открываются с кэшем
+ * в 2-4 плитки, чтобы каждый поиск вытеснял плитки. Проверяются совпадение всех ячеек
+ * с исходной сеткой, кратчайшие пути tiled_a_star_search(), ограничение кэша и то, что
+ * createRandom() дает ту же карту, что и MapGen::randomGrid().
+ *
+ * @return Количество найденных ошибок.
+ */
+int runTiled(int grids, long long &checks)
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "findpath-tests.tiles").string();
+    const CaseSeries series =
+        CaseSeries(12000).widths(200, 500, 137).heights(150, 450, 89).densities({0.0, 0.2, 0.3, 0.4}).mazes(5, 4);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const Grid grid = makeGrid(c);
+        std::string error;
+        const bool written = c.maze ? TiledGrid::create(path, grid, &error)
+                                    : TiledGrid::createRandom(path, c.width, c.height, c.density, c.seed, &error);
+        TiledGrid tiled;
+        if (written)
+            tiled.open(path, 2 + i % 3, &error);
+        ++checks;
+        if (written && error.empty())
+            error = checkTileFile(path, grid);
+
+        ++checks;
+        if (error.empty() && (tiled.width() != grid.width() || tiled.height() != grid.height()))
+            error = "size mismatch";
+        for (int y = 0; error.empty() && y < grid.height(); ++y) {
+            for (int x = 0; x < grid.width(); ++x) {
+                if (tiled.isBlocked(x, y) != grid.isBlocked(x, y)) {
+                    error = "cell (" + std::to_string(x) + "," + std::to_string(y) + ") differs";
+                    break;
+                }
+            }
+        }
+
+        for (const Query &query : MapGen::randomQueries(grid, 6, c.seed * 5 + 3)) {
+            if (!error.empty())
+                break;
+            ++checks;
+            error = checkPath(grid, query, tiled_a_star_search(tiled, query.start, query.goal).toNodes(),
+                              bfsDistance(grid, query.start, query.goal));
+            if (tiled.residentTiles() > tiled.cacheTiles())
+                error = "tile cache exceeds its capacity";
+        }
+        if (error.empty())
+            continue;
+        ++failures;
+        reportFailure("tiled grid", error, c);
+    }
+    std::remove(path.c_str());
+    return failures;
+}
+
+/**
+ * @brief Проверка плана нескольких агентов.
+ *
+ * @return Пустая строка, если пути непрерывны, проходят по свободным ячейкам, соединяют
+ *         начала с целями и агенты не сталкиваются; иначе описание ошибки.
+ */
+std::string checkPlan(const Grid &grid, const std::vector<Query> &agents, const MultiAgentPlan &plan)
+{
+    if (plan.paths.size() != agents.size())
+        return "wrong number of paths";
+    for (size_t a = 0; a < agents.size(); ++a) {
+        const std::vector<Node> &path = plan.paths[a];
+        const int expected = bfsDistance(grid, agents[a].start, agents[a].goal);
+        if (path.empty()) {
+            if (expected >= 0 && !plan.fallback && plan.highLevelNodes > 0)
+                return "CBS lost reachable agent #" + std::to_string(a);
+            continue;
+        }
+        if (expected < 0)
+            return "path found for unreachable agent #" + std::to_string(a);
+        if (!(path.front() == agents[a].start) || !(path.back() == agents[a].goal))
+            return "path of agent #" + std::to_string(a) + " does not connect start and goal";
+        if (int(path.size()) - 1 < expected)
+            return "path of agent #" + std::to_string(a) + " is shorter than BFS distance";
+        for (size_t t = 0; t < path.size(); ++t) {
+            if (!grid.isFree(path[t].x, path[t].y))
+                return "agent #" + std::to_string(a) + " crosses blocked cell";
+            if (t > 0 && std::abs(path[t].x - path[t - 1].x) + std::abs(path[t].y - path[t - 1].y) > 1)
+                return "path of agent #" + std::to_string(a) + " is not contiguous";
+        }
+    }
+    for (int t = 0; t <= plan.makespan; ++t) {
+        for (size_t a = 0; a < agents.size(); ++a) {
+            for (size_t b = a + 1; b < agents.size(); ++b) {
+                const std::vector<Node> &pa = plan.paths[a];
+                const std::vector<Node> &pb = plan.paths[b];
+                if (pa.empty() || pb.empty())
+                    continue;
+                if (positionAt(pa, t) == positionAt(pb, t))
+                    return "agents #" + std::to_string(a) + " and #" + std::to_string(b) + " collide at t=" +
+                           std::to_string(t);
+                if (positionAt(pa, t) == positionAt(pb, t + 1) && positionAt(pa, t + 1) == positionAt(pb, t))
+                    return "agents #" + std::to_string(a) + " and #" + std::to_string(b) + " swap at t=" +
+                           std::to_string(t);
+            }
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Проверка приоритетного плана: путь каждого агента кратчайший при путях
+ *        агентов с более высоким приоритетом.
+ */
+std::string checkPriorities(const Grid &grid, const std::vector<Query> &agents, const MultiAgentPlan &plan)
+{
+    ReservationTable table(grid.width());
+    for (size_t a = 0; a < agents.size(); ++a) {
+        const int distance = bfsDistance(grid, agents[a].start, agents[a].goal);
+        if (distance < 0)
+            continue;
+        const int maxTime = table.horizon() + distance + grid.width() + grid.height();
+        const std::vector<Node> best = space_time_a_star(grid, agents[a].start, agents[a].goal, table, maxTime);
+        if (best.size() != plan.paths[a].size())
+            return "path of agent #" + std::to_string(a) + " is not optimal for its priority";
+        table.reservePath(plan.paths[a]);
+    }
+    return {};
+}
+
+/**
+ * @brief Проверка таблицы первых ходов.
+ *
+ * Пути, извлеченные из таблицы, сравниваются с поиском в ширину, в том числе для
+ * недостижимых и заблокированных целей. Таблица, прошедшая запись и загрузку, должна
+ * давать ту же запись, а загрузка для измененной сетки, усеченных или испорченных данных -
+ * отклоняться.
+ */
+int runFirstMove(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(13000).widths(1, 40, 7).heights(1, 37, 13).densities({0.0, 0.15, 0.3, 0.45}).mazes(6, 5);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        Grid grid = makeGrid(c);
+        const FirstMoveTable table = FirstMoveTable::build(grid, 1 + i % 3);
+        const std::vector<uint8_t> data = table.serialize();
+        FirstMoveTable loaded;
+        std::string loadError;
+        const bool ok = FirstMoveTable::deserialize(data.data(), data.size(), grid, loaded, &loadError);
+
+        std::vector<std::string> errors;
+        ++checks;
+        if (!ok)
+            errors.push_back("round trip failed: " + loadError);
+        else if (loaded.serialize() != data)
+            errors.push_back("round trip changed the table");
+
+        SplitMix64 rng(c.seed);
+        for (int k = 0; k < 24; ++k) {
+            const Query query {Node{rng.bounded(c.width), rng.bounded(c.height)},
+                               Node{rng.bounded(c.width), rng.bounded(c.height)}};
+            const bool open = grid.isFree(query.start.x, query.start.y) && grid.isFree(query.goal.x, query.goal.y);
+            const int expected = open ? bfsDistance(grid, query.start, query.goal) : -1;
+            const std::string error = checkPath(grid, query, (ok ? loaded : table).path(query.start, query.goal).toNodes(),
+                                                expected);
+            ++checks;
+            if (!error.empty())
+                errors.push_back(error + " for (" + std::to_string(query.start.x) + "," + std::to_string(query.start.y)
+                                 + ")->(" + std::to_string(query.goal.x) + "," + std::to_string(query.goal.y) + ")");
+        }
+
+        const int x = rng.bounded(c.width);
+        const int y = rng.bounded(c.height);
+        grid.setBlocked(x, y, !grid.isBlocked(x, y));
+        FirstMoveTable stale;
+        ++checks;
+        if (table.matches(grid) || FirstMoveTable::deserialize(data.data(), data.size(), grid, stale))
+            errors.push_back("table accepted for a changed grid");
+        ++checks;
+        if (data.size() > 4 && FirstMoveTable::deserialize(data.data(), data.size() - 4, makeGrid(c), stale))
+            errors.push_back("truncated table accepted");
+        if (data.size() > 32) {
+            std::vector<uint8_t> corrupted = data;
+            corrupted[32 + size_t(rng.next() % (data.size() - 32))] ^= uint8_t(1u << rng.bounded(8));
+            ++checks;
+            if (FirstMoveTable::deserialize(corrupted.data(), corrupted.size(), makeGrid(c), stale))
+                errors.push_back("corrupted table accepted");
+        }
+
+        for (const std::string &error : errors) {
+            ++failures;
+            reportFailure("first_move_table", error, c);
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка планирования путей нескольких агентов.
+ *
+ * Планы приоритетного планирования (в одном и нескольких потоках) и CBS не должны
+ * содержать столкновений; в приоритетном плане путь каждого агента кратчайший при путях
+ * предыдущих агентов, а CBS (если не перешел на приоритетное планирование) дает сумму
+ * стоимостей не больше приоритетного.
+ */
+int runMultiAgent(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(7000).widths(2, 15).heights(2, 13, 3).densities({0.0, 0.1, 0.2, 0.3}).mazes(9);
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const Grid grid = makeGrid(c);
+        const std::vector<Query> agents = MapGen::agentQueries(grid, 2 + i % 7, c.seed);
+
+        const MultiAgentPlan sequential = prioritized_planning(grid, agents, 1);
+        const MultiAgentPlan parallel = prioritized_planning(grid, agents, 4);
+        const MultiAgentPlan cbs = conflict_based_search(grid, agents, 200, 4);
+        const std::pair<const char *, std::string> results[] = {
+            {"prioritized_planning", checkPlan(grid, agents, sequential)},
+            {"prioritized_planning", checkPlan(grid, agents, parallel)},
+            {"prioritized_planning", checkPriorities(grid, agents, sequential)},
+            {"prioritized_planning", checkPriorities(grid, agents, parallel)},
+            {"conflict_based_search", checkPlan(grid, agents, cbs)},
+            {"conflict_based_search", !cbs.fallback && sequential.failed == 0 && cbs.sumOfCosts > sequential.sumOfCosts
+                                          ? "sum of costs is greater than prioritized planning"
+                                          : std::string()},
+        };
+        for (const auto &result : results) {
+            ++checks;
+            if (result.second.empty())
+                continue;
+            ++failures;
+            reportFailure(result.first, result.second, c, "agents=" + std::to_string(agents.size()));
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка условий оптимальности расстояний от одной ячейки.
+ *
+ * Расстояния верны, если до начальной ячейки оно равно 0, достижимы ровно ячейки
+ * компоненты начальной ячейки, ни одно ребро нельзя ослабить, а шаг дерева в каждую
+ * ячейку ведет из соседа, через которого проходит кратчайший путь.
+ *
+ * @return Пустая строка, если расстояния верны; иначе описание ошибки.
+ */
+std::string checkDistances(const Grid &grid, const Node &source, const DistanceMap &map)
+{
+    const int width = grid.width();
+    std::vector<char> reached(grid.cellCount(), 0);
+    std::vector<Node> stack;
+    if (grid.isFree(source.x, source.y)) {
+        reached[size_t(source.y) * width + source.x] = 1;
+        stack.push_back(source);
+    }
+    while (!stack.empty()) {
+        const Node cell = stack.back();
+        stack.pop_back();
+        for (int d = 0; d < 4; ++d) {
+            const Node next {cell.x + CompactPath::dx[d], cell.y + CompactPath::dy[d]};
+            if (grid.isFree(next.x, next.y) && !reached[size_t(next.y) * width + next.x]) {
+                reached[size_t(next.y) * width + next.x] = 1;
+                stack.push_back(next);
+            }
+        }
+    }
+
+    for (int y = 0; y < grid.height(); ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t cell = size_t(y) * width + x;
+            const uint32_t distance = map.distances[cell];
+            const std::string at = " at (" + std::to_string(x) + "," + std::to_string(y) + ")";
+            if ((distance != DistanceMap::Unreachable) != bool(reached[cell]))
+                return "reachability differs from flood fill" + at;
+            if (distance == DistanceMap::Unreachable)
+                continue;
+            if ((x == source.x && y == source.y) != (distance == 0))
+                return "zero distance" + at;
+            for (int d = 0; d < 4; ++d) {
+                const int px = x - CompactPath::dx[d];
+                const int py = y - CompactPath::dy[d];
+                if (!grid.isFree(px, py))
+                    continue;
+                const uint32_t parent = map.distances[size_t(py) * width + px];
+                if (uint64_t(parent) + uint64_t(grid.cost(x, y)) < distance)
+                    return "edge can be relaxed" + at;
+            }
+            const uint8_t direction = map.tree.directions[cell];
+            if (distance == 0) {
+                if (direction != SearchTree::Root)
+                    return "source is not the root";
+                continue;
+            }
+            if (direction > 3)
+                return "reachable cell has no parent" + at;
+            const uint32_t parent = map.distances[size_t(y - CompactPath::dy[direction]) * width + x
+                                                  - CompactPath::dx[direction]];
+            if (parent + uint32_t(grid.cost(x, y)) != distance)
+                return "parent is not on a shortest path" + at;
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Проверка расстояний от одной ячейки на сетках со стоимостями.
+ *
+ * Алгоритм Дейкстры проверяется по условиям оптимальности и по стоимости путей дерева,
+ * а алгоритм дельта-шагов при разном количестве потоков и ширине корзин должен давать
+ * точно те же массивы расстояний и направлений.
+ */
+int runDistances(int grids, long long &checks)
+{
+    const CaseSeries series =
+        CaseSeries(14000).widths(1, 48, 7).heights(1, 45, 5).densities({0.0, 0.15, 0.3, 0.4}).mazes(13, 12);
+    const int maxCosts[] = {1, 9, 255};
+    const uint32_t deltas[] = {0, 1, 3, 40, 1000};
+    int failures = 0;
+    for (int i = 0; i < grids; ++i) {
+        const Case c = series(i);
+        const bool terrain = !c.maze && i % 7 != 6;
+        const Grid grid = terrain ? MapGen::terrainGrid(c.width, c.height, c.density, maxCosts[i % 3], c.seed)
+                                  : makeGrid(c);
+        SplitMix64 rng(c.seed);
+        const Node source {rng.bounded(c.width), rng.bounded(c.height)};
+        const DistanceMap reference = dijkstra_distances(grid, source);
+
+        std::vector<std::pair<const char *, std::string>> results;
+        results.push_back({"dijkstra_distances", checkDistances(grid, source, reference)});
+        for (int k = 0; k < 3; ++k) {
+            const Node goal {rng.bounded(c.width), rng.bounded(c.height)};
+            const std::vector<Node> path = reference.pathTo(goal).toNodes();
+            long long cost = 0;
+            for (size_t j = 1; j < path.size(); ++j)
+                cost += grid.cost(path[j].x, path[j].y);
+            const uint32_t distance = reference.distanceTo(goal);
+            std::string error;
+            if (path.empty() != (distance == DistanceMap::Unreachable))
+                error = "path existence does not match the distance";
+            else if (!path.empty() && (!(path.front() == source) || !(path.back() == goal) || cost != distance))
+                error = "path cost " + std::to_string(cost) + " != distance " + std::to_string(distance);
+            results.push_back({"dijkstra_distances", error});
+        }
+
+        const int threads = 1 + i % 5;
+        const uint32_t delta = deltas[(i / 5) % 5];
+        const DistanceMap parallel = delta_stepping_distances(grid, source, threads, delta);
+        std::string error;
+        if (parallel.distances != reference.distances)
+            error = "distances differ from Dijkstra";
+        else if (parallel.tree.directions != reference.tree.directions)
+            error = "parents differ from Dijkstra";
+        if (!error.empty())
+            error += " (threads=" + std::to_string(threads) + ", delta=" + std::to_string(delta) + ")";
+        results.push_back({"delta_stepping_distances", error});
+
+        for (const auto &result : results) {
+            ++checks;
+            if (result.second.empty())
+                continue;
+            ++failures;
+            reportFailure(result.first, result.second, c,
+                          (terrain ? "terrain maxCost=" + std::to_string(maxCosts[i % 3]) + " " : std::string())
+                              + "source (" + std::to_string(source.x) + "," + std::to_string(source.y) + ")");
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка трассировки.
+ *
+ * Выключенная трассировка не записывает событий. Включенная записывает поиски из
+ * нескольких потоков с номерами их запросов, кольцевой буфер потока хранит только
+ * последние события, а очистка удаляет записанное.
+ */
+int runTrace(long long &checks)
+{
+    std::vector<std::string> errors;
+    const Grid grid = MapGen::randomGrid(64, 64, 0.2, 44);
+    const std::vector<Query> queries = MapGen::randomQueries(grid, 8, 45);
+
+    Trace::clear();
+    a_star_search_compact(grid, queries[0].start, queries[0].goal);
+    ++checks;
+    if (Trace::eventCount() != 0)
+        errors.push_back("events recorded while disabled");
+
+    Trace::setEnabled(true);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < queries.size(); ++t) {
+        threads.emplace_back([&grid, &queries, t] {
+            Trace::QueryScope query(1000 + t);
+            a_star_search_compact(grid, queries[t].start, queries[t].goal);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    const std::string json = Trace::chromeJson();
+#ifdef FINDPATH_NO_TRACE
+    const size_t expected = 0;
+#else
+    const size_t expected = queries.size();
+#endif
+    ++checks;
+    if (Trace::eventCount() != expected)
+        errors.push_back("recorded " + std::to_string(Trace::eventCount()) + " events instead of "
+                         + std::to_string(expected));
+    for (size_t t = 0; t < expected; ++t) {
+        ++checks;
+        if (json.find("\"query\": " + std::to_string(1000 + t) + "}") == std::string::npos)
+            errors.push_back("query " + std::to_string(1000 + t) + " is missing from the trace");
+    }
+    ++checks;
+    if (expected > 0 && json.find("\"name\": \"a_star_search\", \"cat\": \"findpath\", \"ph\": \"X\"") == std::string::npos)
+        errors.push_back("search event is missing from the trace");
+
+    Trace::clear();
+    const uint64_t begin = Trace::now();
+    for (size_t i = 0; i < Trace::BufferEvents + 100; ++i)
+        Trace::complete("event", begin, begin + i, 1);
+    // При выгрузке отбрасывается и самое старое событие: его ячейку может перезаписывать писатель
+    ++checks;
+    if (expected > 0 && Trace::eventCount() != Trace::BufferEvents - 1)
+        errors.push_back("ring buffer keeps " + std::to_string(Trace::eventCount()) + " events");
+
+    // Буферы завершившихся потоков достаются новым потокам, а их события остаются в выгрузке
+    Trace::clear();
+    size_t bytes = 0;
+    for (int t = 0; t < 32; ++t) {
+        std::thread([t] { Trace::complete("short thread", Trace::now(), Trace::now(), 2000 + t); }).join();
+        if (t == 0)
+            bytes = Trace::memoryBytes();
+    }
+    ++checks;
+    if (Trace::memoryBytes() != bytes)
+        errors.push_back("short-lived threads grew trace buffers from " + std::to_string(bytes) + " to "
+                         + std::to_string(Trace::memoryBytes()) + " bytes");
+    ++checks;
+    if (Trace::eventCount() != (expected > 0 ? 32 : 0))
+        errors.push_back("short-lived threads left " + std::to_string(Trace::eventCount()) + " events");
+    Trace::setEnabled(false);
+    Trace::clear();
+    ++checks;
+    if (Trace::eventCount() != 0)
+        errors.push_back("events left after clear");
+
+    for (const std::string &error : errors)
+        std::printf("FAIL trace: %s\n", error.c_str());
+    return int(errors.size());
+}
+
+/**
+ * @brief Проверка параллельных запросов к одной общей карте.
+ *
+ * Несколько потоков одновременно ищут пути на одной сетке, как это делают
+ * QtConcurrent в главном окне и консольный решатель. Предназначена в первую
+ * очередь для сборок с ThreadSanitizer.
+ */
+int runThreaded(long long &checks)
+{
+    const Grid grid = MapGen::randomGrid(128, 128, 0.25, 42);
+    const std::vector<Query> queries = MapGen::randomQueries(grid, 64, 43);
+    std::vector<int> expected;
+    for (const Query &query : queries)
+        expected.push_back(bfsDistance(grid, query.start, query.goal));
+
+    const unsigned threadCount = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<int> failures(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < queries.size(); i += threadCount) {
+                for (const Engine &engine : engines()) {
+                    const auto path = engine.search(grid, queries[i].start, queries[i].goal);
+                    if (!checkPath(grid, queries[i], path, expected[i]).empty())
+                        ++failures[t];
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    int total = 0;
+    for (int f : failures)
+        total += f;
+    checks += static_cast<long long>(queries.size() * engines().size());
+    if (total > 0)
+        std::printf("FAIL threaded: %d mismatches\n", total);
+    return total;
+}
+
+/**
+ * @brief Проверка объема памяти, который арена потока сохраняет между запросами.
+ *
+ * Блоки обычного запроса сохраняются для следующего, а память запроса больше предела
+ * возвращается системе при сбросе.
+ */
+int runArena(long long &checks)
+{
+    int failures = 0;
+    const SearchArena &arena = SearchArena::local();
+    auto query = [](size_t bytes, int allocations) {
+        ArenaScope scope;
+        for (int i = 0; i < allocations; ++i)
+            static_cast<char *>(scope.resource()->allocate(bytes, alignof(std::max_align_t)))[0] = 1;
+    };
+
+    query(size_t(1) << 20, 4);
+    const size_t retained = arena.capacity();
+    const long long blocks = arena.blockAllocations();
+    query(size_t(1) << 20, 4);
+    ++checks;
+    if (arena.capacity() != retained || arena.blockAllocations() != blocks) {
+        std::printf("FAIL arena: repeated query reallocated (capacity %zu -> %zu)\n", retained, arena.capacity());
+        ++failures;
+    }
+
+    query(size_t(48) << 20, 4);
+    ++checks;
+    if (arena.capacity() > size_t(64) << 20) {
+        std::printf("FAIL arena: %zu bytes retained after a large query\n", arena.capacity());
+        ++failures;
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка пула потоков планирования нескольких агентов.
+ *
+ * Каждая итерация каждого цикла выполняется ровно один раз, а циклы выполняют одни и
+ * те же потоки, созданные пулом.
+ */
+int runWorkerPool(long long &checks)
+{
+    int failures = 0;
+    Parallel::WorkerPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> used;
+    for (int round = 0; round < 500; ++round) {
+        const int count = round % 9;
+        std::vector<std::atomic<int>> runs(size_t(count) + 1);
+        pool.run(count, [&](int i) {
+            runs[size_t(i)].fetch_add(1);
+            std::lock_guard<std::mutex> lock(mutex);
+            used.insert(std::this_thread::get_id());
+        });
+        for (int i = 0; i < count; ++i) {
+            ++checks;
+            if (runs[size_t(i)].load() != 1) {
+                std::printf("FAIL worker pool: iteration %d of %d ran %d times\n", i, count, runs[size_t(i)].load());
+                ++failures;
+            }
+        }
+    }
+    ++checks;
+    if (used.size() > size_t(pool.threads())) {
+        std::printf("FAIL worker pool: %zu threads ran iterations of a %d-thread pool\n", used.size(), pool.threads());
+        ++failures;
+    }
+    return failures;
+}
+
+/**
+ * @brief Проверка, что записи путей не затирают сохраненное дерево поиска кэша.
+ *
+ * Дерево хранится с конечной точкой (-1, -1); запись пути к такой точке из того же
+ * начала не должна заменять накопленное дерево.
+ */
+int runPathCacheKeys(long long &checks)
+{
+    int failures = 0;
+    const Grid grid = MapGen::randomGrid(64, 64, 0.2, 7);
+    const std::vector<Query> queries = MapGen::randomQueries(grid, 16, 8);
+    const Node start = queries.front().start;
+    PathCache cache(1u << 20);
+    for (const Query &query : queries) {
+        SearchTree tree;
+        a_star_search_compact(grid, start, query.goal, nullptr, &tree);
+        cache.insertTree(grid, std::move(tree));
+    }
+    cache.insert(grid, start, Node{-1, -1}, CompactPath());
+
+    for (const Query &query : queries) {
+        const int expected = bfsDistance(grid, start, query.goal);
+        CompactPath path;
+        ++checks;
+        if (!cache.lookup(grid, start, query.goal, path) || (expected < 0 ? !path.empty() : int(path.steps()) != expected)) {
+            std::printf("FAIL cache keys: goal (%d,%d) not answered by the search tree after inserting a path to (-1,-1)\n",
+                        query.goal.x, query.goal.y);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+}
+
+/**
+ * @brief Точка входа проверки корректности и оптимальности алгоритмов поиска.
+ *
+ * Без аргументов выполняет систематический набор, проверку в нескольких потоках и
+ * короткий фаззинг. С --fuzz N [--seed S] выполняет только фаззинг на N случайных картах.
+ *
+ * @param argc Количество аргументов командной строки.
+ * @param argv Массив строковых аргументов командной строки.
+ * @return 0, если все проверки пройдены; 1 в противном случае.
+ */
+int main(int argc, char *argv[])
+{
+    int fuzzIterations = 0;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzzIterations = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--fuzz N] [--seed S]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    long long checks = 0;
+    int failures = 0;
+    if (fuzzIterations > 0) {
+        failures += runFuzz(fuzzIterations, seed, checks);
+    } else {
+        failures += runSuite(3000, checks);
+        failures += runThreaded(checks);
+        failures += runArena(checks);
+        failures += runWorkerPool(checks);
+        failures += runPathCacheKeys(checks);
+        failures += runTrace(checks);
+        failures += runAnyAngle(500, checks);
+        failures += runMultiAgent(300, checks);
+        failures += runAnytime(300, checks);
+        failures += runMultiGoal(500, checks);
+        failures += runTiled(20, checks);
+        failures += runFirstMove(300, checks);
+        failures += runDistances(500, checks);
+        failures += runFuzz(200, seed, checks);
+    }
+
+    std::printf("%lld checks, %d failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+QT -= core gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle qt
+
+TARGET = findPathTests
+
+# Сборки с санитайзерами: qmake SANITIZE=asan (или ubsan, tsan)
+equals(SANITIZE, asan): CONFIG += sanitizer sanitize_address
+equals(SANITIZE, ubsan): CONFIG += sanitizer sanitize_undefined
+equals(SANITIZE, tsan): CONFIG += sanitizer sanitize_thread
+
+unix: LIBS += -lpthread
+
+SOURCES += \
+    main.cpp
+
+include(../search.pri)
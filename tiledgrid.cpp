@@ -0,0 +1,575 @@
+#include "tiledgrid.h"
+#include "mapgen.h"
+#include "pathcache.h"
+#include "searcharena.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <memory_resource>
+#include <queue>
+#include <unordered_map>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define FINDPATH_TILED_BIG_ENDIAN
+#endif
+
+// Отображенные плитки используются без преобразования, поэтому только на little-endian платформах
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(FINDPATH_TILED_BIG_ENDIAN)
+#define FINDPATH_TILED_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t Magic = 0x47545046;     // "FPTG" в порядке байтов little-endian
+const size_t HeaderFields = 5;          // полей заголовка по 4 байта
+const uint32_t FormatVersion = 1;
+
+const int StateShift = 6;               // log2 стороны страницы состояния поиска
+const int StateSize = 1 << StateShift;
+const int PrefetchDistance = TiledGrid::TileSize / 4;   // упреждение по направлению поиска
+
+const uint8_t NoParent = SearchTree::Unreached;
+const uint8_t StartCell = SearchTree::Root;
+
+/**
+ * @brief Заголовок файла плиточной сетки.
+ */
+struct Header {
+    uint32_t magic;     /**< Сигнатура. */
+    uint32_t version;   /**< Версия формата. */
+    int32_t width;      /**< Ширина сетки. */
+    int32_t height;     /**< Высота сетки. */
+    int32_t tileSize;   /**< Сторона плитки. */
+};
+
+void putU32(unsigned char *out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out[i] = uint8_t(value >> (8 * i));
+}
+
+uint32_t getU32(const unsigned char *in)
+{
+    return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+#ifdef FINDPATH_TILED_BIG_ENDIAN
+/**
+ * @brief Перестановка байтов слов плиток между порядком платформы и little-endian файла.
+ */
+void swapWords(uint64_t *words, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t swapped = 0;
+        for (int b = 0; b < 8; ++b)
+            swapped |= ((words[i] >> (8 * b)) & 0xFF) << (56 - 8 * b);
+        words[i] = swapped;
+    }
+}
+#endif
+
+size_t tilesAlong(int cells)
+{
+    return (size_t(cells) + TiledGrid::TileSize - 1) >> TiledGrid::TileShift;
+}
+
+void setError(std::string *error, const std::string &message)
+{
+    if (error != nullptr)
+        *error = message;
+}
+
+/**
+ * @brief Последовательная запись файла плиточной сетки.
+ *
+ * Файл пишется полосами по одной строке плиток, поэтому в памяти находится только
+ * текущая полоса (TileSize строк карты), а не вся карта.
+ */
+class TileWriter
+{
+public:
+    TileWriter(const std::string &path, int width, int height)
+        : m_file(std::fopen(path.c_str(), "wb")), m_band(tilesAlong(width) * TiledGrid::TileWords, 0)
+    {
+        if (m_file == nullptr)
+            return;
+        unsigned char header[TiledGrid::HeaderBytes] = {};
+        putU32(header, Magic);
+        putU32(header + 4, FormatVersion);
+        putU32(header + 8, uint32_t(width));
+        putU32(header + 12, uint32_t(height));
+        putU32(header + 16, uint32_t(TiledGrid::TileSize));
+        m_ok = std::fwrite(header, 1, sizeof(header), m_file) == sizeof(header);
+    }
+
+    ~TileWriter()
+    {
+        if (m_file != nullptr)
+            std::fclose(m_file);
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    /** @brief Отметка заблокированной ячейки текущей полосы (x - столбец, row - строка в полосе). */
+    void setBlocked(int x, int row)
+    {
+        const size_t tile = size_t(x >> TiledGrid::TileShift);
+        const int column = x & (TiledGrid::TileSize - 1);
+        m_band[tile * TiledGrid::TileWords + size_t(row) * TiledGrid::TileStride + (column >> 6)]
+            |= uint64_t(1) << (column & 63);
+    }
+
+    /** @brief Запись 64 ячеек текущей полосы, начиная со столбца x (x кратен 64). */
+    void setWord(int x, int row, uint64_t bits)
+    {
+        const size_t tile = size_t(x >> TiledGrid::TileShift);
+        const int column = x & (TiledGrid::TileSize - 1);
+        m_band[tile * TiledGrid::TileWords + size_t(row) * TiledGrid::TileStride + (column >> 6)] = bits;
+    }
+
+    /** @brief Запись полосы в файл и очистка буфера. */
+    void flushBand()
+    {
+#ifdef FINDPATH_TILED_BIG_ENDIAN
+        swapWords(m_band.data(), m_band.size());
+#endif
+        m_ok = m_ok && std::fwrite(m_band.data(), sizeof(uint64_t), m_band.size(), m_file) == m_band.size();
+        std::fill(m_band.begin(), m_band.end(), 0);
+    }
+
+    bool finish()
+    {
+        m_ok = m_ok && std::fclose(m_file) == 0;
+        m_file = nullptr;
+        return m_ok;
+    }
+
+private:
+    FILE *m_file;                   /**< Записываемый файл. */
+    std::vector<uint64_t> m_band;   /**< Плитки текущей полосы. */
+    bool m_ok {false};              /**< Ошибок записи не было. */
+};
+
+#ifdef FINDPATH_TILED_MMAP
+
+/**
+ * @brief Рекомендация ОС о страницах плитки.
+ *
+ * Диапазон сужается до целых страниц: на системах со страницами больше плитки
+ * рекомендация может не действовать, это влияет только на объем резидентной памяти.
+ */
+void advise(const void *data, int advice)
+{
+    static const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + TiledGrid::TileBytes) & ~(page - 1);
+    if (begin < end)
+        madvise(reinterpret_cast<void *>(begin), end - begin, advice);
+}
+
+#endif
+
+}
+
+/**
+ * @brief Конструктор класса TiledGrid: пустая сетка без файла.
+ */
+TiledGrid::TiledGrid() = default;
+
+/**
+ * @brief Деструктор класса TiledGrid.
+ */
+TiledGrid::~TiledGrid()
+{
+    close();
+}
+
+/**
+ * @brief Запись сетки в файл плиточной сетки.
+ *
+ * @param path Путь к файлу.
+ * @param grid Сетка препятствий.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true при успешной записи.
+ */
+bool TiledGrid::create(const std::string &path, const Grid &grid, std::string *error)
+{
+    if (grid.isEmpty()) {
+        setError(error, "Empty grid");
+        return false;
+    }
+    TileWriter writer(path, grid.width(), grid.height());
+    if (!writer.isOpen()) {
+        setError(error, "Cannot create " + path);
+        return false;
+    }
+    for (int y0 = 0; y0 < grid.height(); y0 += TileSize) {
+        for (int row = 0; row < TileSize && y0 + row < grid.height(); ++row) {
+            const uint64_t *bits = grid.rowBits(y0 + row);
+            for (int word = 0; word < grid.stride(); ++word)
+                writer.setWord(word * 64, row, bits[word]);
+        }
+        writer.flushBand();
+    }
+    if (!writer.finish()) {
+        setError(error, "Cannot write " + path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Запись случайной карты в файл плиточной сетки без построения ее в памяти.
+ *
+ * Генератор обходит ячейки в том же порядке, что и MapGen::randomGrid(), поэтому при
+ * одинаковых параметрах получается та же карта; в памяти находится одна полоса плиток.
+ *
+ * @param path Путь к файлу.
+ * @param width Ширина сетки.
+ * @param height Высота сетки.
+ * @param density Доля заблокированных ячеек.
+ * @param seed Начальное значение генератора.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true при успешной записи.
+ */
+bool TiledGrid::createRandom(const std::string &path, int width, int height, double density, uint64_t seed,
+                             std::string *error)
+{
+    if (width <= 0 || height <= 0) {
+        setError(error, "Empty grid");
+        return false;
+    }
+    TileWriter writer(path, width, height);
+    if (!writer.isOpen()) {
+        setError(error, "Cannot create " + path);
+        return false;
+    }
+    SplitMix64 rng(seed);
+    for (int y0 = 0; y0 < height; y0 += TileSize) {
+        for (int row = 0; row < TileSize && y0 + row < height; ++row) {
+            for (int x = 0; x < width; ++x) {
+                if (rng.chance(density))
+                    writer.setBlocked(x, row);
+            }
+        }
+        writer.flushBand();
+    }
+    if (!writer.finish()) {
+        setError(error, "Cannot write " + path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Открытие файла плиточной сетки.
+ *
+ * На POSIX-системах файл отображается в память целиком, а кэш плиток управляет тем,
+ * какие страницы отображения остаются резидентными: вытесненные плитки отдаются системе
+ * (madvise(MADV_DONTNEED)), загружаемые запрашиваются заранее (MADV_WILLNEED). На
+ * остальных платформах плитки читаются из файла в буферы мест кэша.
+ *
+ * @param path Путь к файлу.
+ * @param cacheTiles Емкость кэша в плитках (не меньше 1).
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true, если файл открыт.
+ */
+bool TiledGrid::open(const std::string &path, size_t cacheTiles, std::string *error)
+{
+    close();
+
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        setError(error, "Cannot open " + path);
+        return false;
+    }
+    unsigned char bytes[4 * HeaderFields];
+    const bool headerRead = std::fread(bytes, sizeof(bytes), 1, file) == 1;
+    const Header header {getU32(bytes), getU32(bytes + 4), int32_t(getU32(bytes + 8)), int32_t(getU32(bytes + 12)),
+                         int32_t(getU32(bytes + 16))};
+    if (!headerRead || header.magic != Magic || header.version != FormatVersion || header.tileSize != TileSize
+        || header.width <= 0 || header.height <= 0) {
+        std::fclose(file);
+        setError(error, "Not a tiled grid file: " + path);
+        return false;
+    }
+    const size_t tileCount = tilesAlong(header.width) * tilesAlong(header.height);
+    const size_t fileSize = HeaderBytes + tileCount * TileBytes;
+
+#ifdef FINDPATH_TILED_MMAP
+    std::fclose(file);
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || size_t(info.st_size) < fileSize) {
+        if (fd >= 0)
+            ::close(fd);
+        setError(error, "Truncated tiled grid file: " + path);
+        return false;
+    }
+    void *map = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        setError(error, "Cannot map " + path);
+        return false;
+    }
+    // Доступ к плиткам случайный: упреждающее чтение ОС только увеличило бы резидентный объем
+    madvise(map, fileSize, MADV_RANDOM);
+    m_map = static_cast<const char *>(map);
+    m_mapSize = fileSize;
+#else
+    std::fclose(file);
+    m_stream.reset(new std::ifstream(path, std::ios::binary | std::ios::ate));
+    if (!*m_stream || size_t(m_stream->tellg()) < fileSize) {
+        m_stream.reset();
+        setError(error, "Truncated tiled grid file: " + path);
+        return false;
+    }
+    m_buffers.assign(std::max<size_t>(1, cacheTiles) * TileWords, 0);
+#endif
+
+    m_width = header.width;
+    m_height = header.height;
+    m_tilesX = tilesAlong(m_width);
+    m_tileCount = tileCount;
+    m_slotOfTile.assign(m_tileCount, -1);
+    m_slots.assign(std::max<size_t>(1, cacheTiles), Slot());
+    m_used = 0;
+    m_clock = 0;
+    m_counters = Counters();
+    return true;
+}
+
+/**
+ * @brief Закрытие файла и очистка кэша.
+ */
+void TiledGrid::close()
+{
+#ifdef FINDPATH_TILED_MMAP
+    if (m_map != nullptr)
+        munmap(const_cast<char *>(m_map), m_mapSize);
+#endif
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_stream.reset();
+    m_buffers.clear();
+    m_width = 0;
+    m_height = 0;
+    m_tilesX = 0;
+    m_tileCount = 0;
+    m_slotOfTile.clear();
+    m_slots.clear();
+    m_used = 0;
+}
+
+/**
+ * @brief Заблаговременная загрузка плитки, содержащей ячейку.
+ *
+ * Ничего не делает, если ячейка вне сетки или ее плитка уже в кэше. Загрузка считается
+ * отдельно от промахов; при отображении файла чтение страниц выполняется ОС асинхронно.
+ *
+ * @param x Координата x ячейки.
+ * @param y Координата y ячейки.
+ */
+void TiledGrid::prefetch(int x, int y)
+{
+    if (!contains(x, y))
+        return;
+    const size_t tile = size_t(y >> TileShift) * m_tilesX + size_t(x >> TileShift);
+    if (m_slotOfTile[tile] < 0)
+        load(tile, true);
+}
+
+/**
+ * @brief Загрузка плитки в кэш.
+ *
+ * Пока в кэше есть свободные места, занимается следующее; затем вытесняется плитка
+ * с самым давним обращением (поиск минимума по местам - O(cacheTiles) на промах, что
+ * мало по сравнению с загрузкой плитки из файла).
+ *
+ * @param tile Номер плитки.
+ * @param prefetched Загрузка по упреждению, а не по обращению.
+ * @return Место кэша с загруженной плиткой.
+ */
+TiledGrid::Slot *TiledGrid::load(size_t tile, bool prefetched)
+{
+    size_t index = m_used;
+    if (m_used < m_slots.size()) {
+        ++m_used;
+    } else {
+        index = 0;
+        for (size_t i = 1; i < m_slots.size(); ++i) {
+            if (m_slots[i].lastUse < m_slots[index].lastUse)
+                index = i;
+        }
+        m_slotOfTile[m_slots[index].tile] = -1;
+#ifdef FINDPATH_TILED_MMAP
+        advise(m_slots[index].data, MADV_DONTNEED);
+#endif
+        ++m_counters.evictions;
+    }
+
+    Slot &slot = m_slots[index];
+    slot.tile = tile;
+    slot.lastUse = ++m_clock;
+#ifdef FINDPATH_TILED_MMAP
+    slot.data = reinterpret_cast<const uint64_t *>(m_map + HeaderBytes + tile * TileBytes);
+    advise(slot.data, MADV_WILLNEED);
+#else
+    uint64_t *buffer = m_buffers.data() + index * TileWords;
+    // Если плитку прочитать не удалось, она считается полностью заблокированной
+    m_stream->clear();
+    m_stream->seekg(std::streamoff(HeaderBytes + tile * TileBytes));
+    if (!m_stream->read(reinterpret_cast<char *>(buffer), std::streamsize(TileBytes)))
+        std::fill(buffer, buffer + TileWords, ~uint64_t(0));
+#ifdef FINDPATH_TILED_BIG_ENDIAN
+    else
+        swapWords(buffer, TileWords);
+#endif
+    slot.data = buffer;
+#endif
+    m_slotOfTile[tile] = int32_t(index);
+    if (prefetched)
+        ++m_counters.prefetches;
+    else
+        ++m_counters.misses;
+    return &slot;
+}
+
+/**
+ * @brief Алгоритм A* на сетке во внешней памяти.
+ *
+ * Ищет тот же кратчайший путь, что и a_star_search_compact(), но не выделяет массивов
+ * размером с карту: стоимости и направления хранятся страницами StateSize x StateSize
+ * ячеек, которые создаются в арене потока при первом обращении. Память состояния
+ * пропорциональна исследованной области, а не площади карты.
+ *
+ * При раскрытии ячейки заранее загружается плитка на PrefetchDistance ячеек впереди
+ * по направлению, которым поиск пришел в ячейку: фронт поиска движется в основном
+ * в сторону цели, и следующая плитка оказывается в кэше до первого обращения к ней.
+ *
+ * Счетчики кэша плиток накапливаются в grid (TiledGrid::counters()).
+ *
+ * @param grid Плиточная сетка.
+ * @param start Начальный узел.
+ * @param goal Конечный узел.
+ * @param stats Статистика поиска (может быть nullptr).
+ * @return Компактный путь; пустой, если путь не найден.
+ */
+CompactPath tiled_a_star_search(TiledGrid &grid, const Node &start, const Node &goal, SearchStats *stats)
+{
+    SearchTimer timer(stats);
+    if (!grid.contains(start.x, start.y) || !grid.contains(goal.x, goal.y))
+        return {};
+
+    ArenaScope arena;
+    std::pmr::memory_resource *memory = arena.resource();
+
+    /**
+     * @brief Страница состояния поиска.
+     */
+    struct StatePage {
+        StatePage() {
+            std::fill(std::begin(g), std::end(g), INT_MAX);
+            std::fill(std::begin(cameFrom), std::end(cameFrom), NoParent);
+        }
+
+        int g[StateSize * StateSize];               /**< Стоимости лучших найденных путей. */
+        uint8_t cameFrom[StateSize * StateSize];    /**< Направления шагов, которыми пришли в ячейки. */
+    };
+
+    std::pmr::deque<StatePage> storage(memory);
+    std::pmr::unordered_map<uint64_t, StatePage *> pages(memory);
+    uint64_t lastKey = ~uint64_t(0);
+    StatePage *lastPage = nullptr;
+    auto page = [&](int x, int y) {
+        const uint64_t key = uint64_t(uint32_t(y >> StateShift)) << 32 | uint32_t(x >> StateShift);
+        if (key == lastKey)
+            return lastPage;
+        StatePage *&slot = pages[key];
+        if (slot == nullptr)
+            slot = &storage.emplace_back();
+        lastKey = key;
+        lastPage = slot;
+        return slot;
+    };
+    auto offset = [](int x, int y) { return ((y & (StateSize - 1)) << StateShift) | (x & (StateSize - 1)); };
+    auto heuristic = [&goal](int x, int y) { return std::abs(x - goal.x) + std::abs(y - goal.y); };
+
+    std::priority_queue<Node, std::pmr::vector<Node>> open_set{std::less<Node>(), std::pmr::vector<Node>(memory)};
+
+    auto memoryUsage = [&]() {
+        if (arena.bytesUsed() > 0)
+            return (long long)arena.bytesUsed();
+        return (long long)(stats->peakOpenSize * sizeof(Node)) + (long long)(storage.size() * sizeof(StatePage));
+    };
+
+    StatePage *first = page(start.x, start.y);
+    first->g[offset(start.x, start.y)] = 0;
+    first->cameFrom[offset(start.x, start.y)] = StartCell;
+    Node root{start.x, start.y};
+    root.h = heuristic(start.x, start.y);
+    root.f = root.h;
+    open_set.push(root);
+    SEARCH_STATS(stats, ++stats->pushes; stats->peakOpenSize = 1);
+
+    while (!open_set.empty()) {
+        const Node current = open_set.top();
+        open_set.pop();
+        StatePage *currentPage = page(current.x, current.y);
+        const int currentOffset = offset(current.x, current.y);
+        if (current.g > currentPage->g[currentOffset]) {
+            SEARCH_STATS(stats, ++stats->duplicatePops);
+            continue;
+        }
+        SEARCH_STATS(stats, ++stats->expansions);
+
+        if (current == goal) {
+            SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+            std::vector<uint8_t> directions;
+            for (Node node = current; !(node == start); ) {
+                const uint8_t d = page(node.x, node.y)->cameFrom[offset(node.x, node.y)];
+                directions.push_back(d);
+                node = Node{node.x - CompactPath::dx[d], node.y - CompactPath::dy[d]};
+            }
+            CompactPath path(start);
+            path.reserve(directions.size());
+            for (auto it = directions.rbegin(); it != directions.rend(); ++it)
+                path.append(CompactPath::Direction(*it));
+            return path;
+        }
+
+        const uint8_t heading = currentPage->cameFrom[currentOffset];
+        if (heading < 4)
+            grid.prefetch(current.x + CompactPath::dx[heading] * PrefetchDistance,
+                          current.y + CompactPath::dy[heading] * PrefetchDistance);
+
+        for (uint8_t d = 0; d < 4; ++d) {
+            Node neighbor{current.x + CompactPath::dx[d], current.y + CompactPath::dy[d]};
+            if (!grid.isFree(neighbor.x, neighbor.y))
+                continue;
+            const int tentative = current.g + 1;
+            StatePage *neighborPage = page(neighbor.x, neighbor.y);
+            const int neighborOffset = offset(neighbor.x, neighbor.y);
+            if (tentative >= neighborPage->g[neighborOffset])
+                continue;
+            neighborPage->g[neighborOffset] = tentative;
+            neighborPage->cameFrom[neighborOffset] = d;
+            neighbor.g = tentative;
+            neighbor.h = heuristic(neighbor.x, neighbor.y);
+            neighbor.f = neighbor.g + neighbor.h;
+            open_set.push(neighbor);
+            SEARCH_STATS(stats, ++stats->pushes;
+                         stats->peakOpenSize = std::max<long long>(stats->peakOpenSize, open_set.size()));
+        }
+    }
+    SEARCH_STATS(stats, stats->peakMemoryBytes = std::max(stats->peakMemoryBytes, memoryUsage()));
+    return {};
+}
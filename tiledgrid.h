@@ -0,0 +1,142 @@
+#pragma once
+
+#include "compactpath.h"
+#include "grid.h"
+#include "pathfinding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Сетка препятствий во внешней памяти (TiledGrid).
+ *
+ * Сетка хранится в файле плитками TileSize x TileSize ячеек (битовая маска, строки
+ * плитки по 64-битным словам) и читается через отображение файла в память. В памяти
+ * одновременно находится не больше cacheTiles плиток: при обращении к плитке вне кэша
+ * вытесняется давно не использованная (LRU), и ее страницы возвращаются системе.
+ * Поэтому объем резидентной памяти ограничен размером кэша, а не размером карты,
+ * и карты 100k x 100k (около 1.2 ГБ) обрабатываются при кэше в несколько мегабайт.
+ *
+ * Обращения к ячейкам изменяют состояние кэша, поэтому объект не потокобезопасен:
+ * каждый поток открывает файл отдельно (страницы файла в кэше ОС остаются общими).
+ *
+ * Формат файла (little-endian, как и у остальных форматов проекта): заголовок
+ * HeaderBytes байт (сигнатура, версия, ширина, высота, размер плитки - uint32), затем
+ * плитки построчно. Плитки выровнены по страницам памяти, биты за краем карты нулевые.
+ * На little-endian платформах плитки отображаются в память без преобразования, на
+ * big-endian читаются из файла с перестановкой байтов.
+ */
+class TiledGrid
+{
+public:
+    static constexpr int TileShift = 8;                     /**< log2 размера плитки. */
+    static constexpr int TileSize = 1 << TileShift;         /**< Сторона плитки в ячейках. */
+    static constexpr int TileStride = TileSize / 64;        /**< Слов на строку плитки. */
+    static constexpr size_t TileWords = size_t(TileSize) * TileStride;     /**< Слов в плитке. */
+    static constexpr size_t TileBytes = TileWords * sizeof(uint64_t);      /**< Байт в плитке. */
+    static constexpr size_t HeaderBytes = 4096;             /**< Размер заголовка файла. */
+
+    /**
+     * @brief Счетчики кэша плиток.
+     */
+    struct Counters {
+        long long hits {0};         /**< Обращений к плиткам, находившимся в кэше. */
+        long long misses {0};       /**< Обращений, потребовавших загрузки плитки. */
+        long long evictions {0};    /**< Вытесненных плиток. */
+        long long prefetches {0};   /**< Плиток, загруженных заранее по направлению поиска. */
+
+        /**
+         * @brief Доля обращений к плиткам, обслуженных без загрузки.
+         *
+         * Загрузки по упреждению входят в знаменатель наравне с промахами: иначе плитка,
+         * загруженная заранее, давала бы одни попадания. При отображении файла загрузка
+         * плитки - только отметка в кэше, а чтение с диска происходит при отказе страницы,
+         * поэтому объем ввода-вывода показывают отказы страниц процесса, а не эта доля.
+         */
+        double hitRate() const {
+            const long long loads = misses + prefetches;
+            return hits + loads > 0 ? double(hits) / double(hits + loads) : 0.0;
+        }
+    };
+
+    TiledGrid();
+    ~TiledGrid();
+
+    TiledGrid(const TiledGrid &) = delete;
+    TiledGrid &operator=(const TiledGrid &) = delete;
+
+    static bool create(const std::string &path, const Grid &grid, std::string *error = nullptr);
+    static bool createRandom(const std::string &path, int width, int height, double density, uint64_t seed,
+                             std::string *error = nullptr);
+
+    bool open(const std::string &path, size_t cacheTiles, std::string *error = nullptr);
+    void close();
+    bool isOpen() const { return m_width > 0; }
+
+    int width() const { return m_width; }      /**< Ширина сетки. */
+    int height() const { return m_height; }    /**< Высота сетки. */
+
+    /** @brief Проверка принадлежности координат сетке. */
+    bool contains(int x, int y) const { return x >= 0 && x < m_width && y >= 0 && y < m_height; }
+
+    /** @brief Проверка блокировки ячейки (координаты должны лежать внутри сетки). */
+    bool isBlocked(int x, int y) {
+        const uint64_t *tile = tileData(size_t(y >> TileShift) * m_tilesX + size_t(x >> TileShift));
+        const int row = y & (TileSize - 1);
+        const int column = x & (TileSize - 1);
+        return (tile[row * TileStride + (column >> 6)] >> (column & 63)) & 1u;
+    }
+
+    /** @brief Ячейка внутри сетки и не заблокирована. */
+    bool isFree(int x, int y) { return contains(x, y) && !isBlocked(x, y); }
+
+    void prefetch(int x, int y);
+
+    size_t cacheTiles() const { return m_slots.size(); }   /**< Емкость кэша в плитках. */
+    size_t residentTiles() const { return m_used; }        /**< Плиток в кэше. */
+    const Counters &counters() const { return m_counters; }
+    void resetCounters() { m_counters = Counters(); }
+
+private:
+    /**
+     * @brief Место в кэше плиток.
+     */
+    struct Slot {
+        size_t tile {0};                /**< Номер плитки в файле. */
+        const uint64_t *data {nullptr}; /**< Данные плитки. */
+        uint64_t lastUse {0};           /**< Момент последнего обращения (для LRU). */
+    };
+
+    int m_width {0};        /**< Ширина сетки. */
+    int m_height {0};       /**< Высота сетки. */
+    size_t m_tilesX {0};    /**< Плиток в строке плиток. */
+    size_t m_tileCount {0}; /**< Всего плиток. */
+    std::vector<int32_t> m_slotOfTile;  /**< Место плитки в кэше или -1. */
+    std::vector<Slot> m_slots;          /**< Места кэша. */
+    size_t m_used {0};                  /**< Занятых мест. */
+    uint64_t m_clock {0};               /**< Счетчик обращений. */
+    Counters m_counters;                /**< Счетчики кэша. */
+
+    const char *m_map {nullptr};        /**< Отображение файла (nullptr при чтении в буферы). */
+    size_t m_mapSize {0};               /**< Размер отображения. */
+    std::unique_ptr<std::ifstream> m_stream;    /**< Файл для чтения в буферы (без отображения). */
+    std::vector<uint64_t> m_buffers;    /**< Буферы плиток при чтении без отображения. */
+
+    /** @brief Данные плитки; при промахе плитка загружается в кэш. */
+    const uint64_t *tileData(size_t tile) {
+        const int32_t slot = m_slotOfTile[tile];
+        if (slot < 0)
+            return load(tile, false)->data;
+        ++m_counters.hits;
+        m_slots[size_t(slot)].lastUse = ++m_clock;
+        return m_slots[size_t(slot)].data;
+    }
+
+    Slot *load(size_t tile, bool prefetched);
+};
+
+CompactPath tiled_a_star_search(TiledGrid &grid, const Node &start, const Node &goal, SearchStats *stats = nullptr);
@@ -0,0 +1,384 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Trace {
+
+#ifndef FINDPATH_NO_TRACE
+namespace detail {
+std::atomic<bool> enabled {false};
+}
+#endif
+
+namespace {
+
+/**
+ * @brief Ячейка кольцевого буфера.
+ *
+ * Поля атомарны, чтобы чтение при выгрузке одновременно с записью не было гонкой
+ * данных. Поля записываются с release-порядком, а читаются с acquire: если чтение
+ * увидело значение перезаписанного события, следующее чтение счетчика буфера увидит
+ * и счетчик, сохраненный писателем перед перезаписью.
+ */
+struct Slot {
+    std::atomic<const char *> name {nullptr};   /**< Имя этапа. */
+    std::atomic<uint64_t> begin {0};            /**< Время начала. */
+    std::atomic<uint64_t> end {0};              /**< Время окончания. */
+    std::atomic<uint64_t> query {0};            /**< Номер запроса. */
+};
+
+/**
+ * @brief Поток, писавший в буфер начиная с события from.
+ */
+struct Owner {
+    uint64_t from;                              /**< Номер первого события потока в буфере. */
+    uint32_t thread;                            /**< Номер потока в трассировке. */
+    std::string name;                           /**< Имя потока. */
+};
+
+/**
+ * @brief Кольцевой буфер событий одного потока.
+ *
+ * После завершения потока буфер возвращается в список свободных и достается следующему
+ * новому потоку; события прежних потоков остаются в буфере, пока их не перезапишут.
+ */
+struct Ring {
+    std::vector<Owner> owners;                  /**< Потоки буфера по возрастанию from (под g_mutex). */
+    std::unique_ptr<Slot[]> slots {new Slot[BufferEvents]};    /**< События. */
+    std::atomic<uint64_t> head {0};             /**< Количество записанных событий. */
+    std::atomic<uint64_t> cleared {0};          /**< Значение head при последней очистке. */
+};
+
+/**
+ * @brief Прочитанное событие.
+ */
+struct Event {
+    const char *name;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t query;
+    uint32_t thread;
+};
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+std::mutex g_mutex;                             // защищает списки буферов и владельцев буферов
+std::vector<std::unique_ptr<Ring>> g_rings;     // все буферы; живут до конца процесса
+std::vector<Ring *> g_free;                     // буферы завершившихся потоков
+uint32_t g_threads = 0;                         // количество потоков, получивших буфер
+std::atomic<uint64_t> g_queries {0};
+thread_local Ring *t_ring = nullptr;
+thread_local uint64_t t_query = 0;
+thread_local std::string t_name;                // имя потока до получения буфера
+
+/**
+ * @brief Удаление владельцев, все события которых перезаписаны или очищены.
+ *
+ * Последний владелец остается всегда. Вызывается под g_mutex.
+ */
+void prune(Ring &r)
+{
+    const uint64_t head = r.head.load(std::memory_order_acquire);
+    const uint64_t first = std::max(r.cleared.load(std::memory_order_relaxed),
+                                    head > BufferEvents ? head - BufferEvents : 0);
+    size_t dead = 0;
+    while (dead + 1 < r.owners.size() && r.owners[dead + 1].from <= first)
+        ++dead;
+    r.owners.erase(r.owners.begin(), r.owners.begin() + std::ptrdiff_t(dead));
+}
+
+/**
+ * @brief Возврат буфера потока в список свободных при завершении потока.
+ */
+struct RingRelease {
+    ~RingRelease()
+    {
+        if (t_ring == nullptr)
+            return;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_free.push_back(t_ring);
+        t_ring = nullptr;
+    }
+};
+
+thread_local RingRelease t_release;
+
+/**
+ * @brief Буфер текущего потока; выдается при первом событии потока.
+ *
+ * Сначала используется буфер завершившегося потока, и только если свободных нет,
+ * создается новый: число буферов не превышает наибольшего числа одновременно
+ * пишущих потоков.
+ */
+Ring *ring()
+{
+    if (t_ring == nullptr) {
+        (void)&t_release;   // регистрирует деструктор, возвращающий буфер
+        std::unique_ptr<Ring> created;
+        std::unique_lock<std::mutex> lock(g_mutex);
+        if (g_free.empty()) {
+            lock.unlock();
+            created = std::make_unique<Ring>();
+            lock.lock();
+        }
+        Ring *r = created != nullptr ? created.get() : g_free.back();
+        if (created != nullptr)
+            g_rings.push_back(std::move(created));
+        else
+            g_free.pop_back();
+        prune(*r);
+        const uint32_t thread = ++g_threads;
+        r->owners.push_back({r->head.load(std::memory_order_relaxed), thread,
+                             t_name.empty() ? "thread " + std::to_string(thread) : t_name});
+        t_ring = r;
+    }
+    return t_ring;
+}
+
+void appendEscaped(std::string &out, const char *text)
+{
+    for (; *text != '\0'; ++text) {
+        if (*text == '"' || *text == '\\')
+            out += '\\';
+        if (uint8_t(*text) >= 0x20)
+            out += *text;
+    }
+}
+
+}
+
+#ifndef FINDPATH_NO_TRACE
+/** @brief Замена номера текущего запроса потока; возвращает прежний номер. */
+uint64_t detail::exchangeQuery(uint64_t query)
+{
+    return std::exchange(t_query, query);
+}
+#endif
+
+/**
+ * @brief Включение и выключение записи событий.
+ *
+ * В сборке с FINDPATH_NO_TRACE трассировка всегда выключена.
+ */
+void setEnabled(bool enabled)
+{
+#ifdef FINDPATH_NO_TRACE
+    (void)enabled;
+#else
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+#endif
+}
+
+/**
+ * @brief Текущее время трассировки в наносекундах от запуска процесса.
+ */
+uint64_t now()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch)
+                        .count());
+}
+
+/**
+ * @brief Новый номер запроса (начиная с 1).
+ */
+uint64_t newQuery()
+{
+    return g_queries.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief Номер текущего запроса потока (0, если не задан QueryScope).
+ */
+uint64_t currentQuery()
+{
+    return t_query;
+}
+
+/**
+ * @brief Запись события с явно заданными началом и окончанием.
+ *
+ * Используется для этапов, которые начинаются в одном потоке, а заканчиваются в другом
+ * (например, ожидание задачи в пуле потоков); событие записывается в буфер вызывающего
+ * потока.
+ *
+ * @param name Имя этапа (строка должна жить до выгрузки).
+ * @param beginNs Время начала (now()).
+ * @param endNs Время окончания (now()).
+ * @param query Номер запроса.
+ */
+void complete(const char *name, uint64_t beginNs, uint64_t endNs, uint64_t query)
+{
+    if (!isEnabled())
+        return;
+    Ring *r = ring();
+    const uint64_t head = r->head.load(std::memory_order_relaxed);
+    Slot &slot = r->slots[head & (BufferEvents - 1)];
+    slot.name.store(name, std::memory_order_release);
+    slot.begin.store(beginNs, std::memory_order_release);
+    slot.end.store(std::max(beginNs, endNs), std::memory_order_release);
+    slot.query.store(query, std::memory_order_release);
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Имя текущего потока на временной шкале.
+ *
+ * Буфер потока при этом не создается: он появится с первым событием.
+ */
+void setThreadName(const std::string &name)
+{
+    t_name = name;
+    if (t_ring != nullptr) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        t_ring->owners.back().name = name;
+    }
+}
+
+/**
+ * @brief Удаление записанных событий всех потоков.
+ *
+ * Буферы не освобождаются: чтение начнется с событий, записанных после очистки.
+ */
+void clear()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (const std::unique_ptr<Ring> &r : g_rings) {
+        r->cleared.store(r->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        prune(*r);
+    }
+}
+
+/**
+ * @brief Объем памяти буферов событий всех потоков.
+ */
+size_t memoryBytes()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_rings.size() * (sizeof(Ring) + BufferEvents * sizeof(Slot));
+}
+
+namespace {
+
+/**
+ * @brief Чтение событий всех потоков без остановки записи.
+ *
+ * Сначала читается счетчик буфера, затем события, затем счетчик еще раз: события,
+ * которые писатель мог перезаписать за время чтения, отбрасываются. Событие относится
+ * к последнему владельцу буфера, начавшему писать не позже него.
+ */
+std::vector<Event> snapshot(std::vector<std::pair<uint32_t, std::string>> *threads)
+{
+    std::vector<Event> events;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (const std::unique_ptr<Ring> &r : g_rings) {
+        if (threads != nullptr) {
+            for (const Owner &owner : r->owners)
+                threads->emplace_back(owner.thread, owner.name);
+        }
+        const uint64_t head = r->head.load(std::memory_order_acquire);
+        const uint64_t first = std::max(r->cleared.load(std::memory_order_relaxed),
+                                        head > BufferEvents ? head - BufferEvents : 0);
+        const size_t copied = events.size();
+        size_t owner = 0;
+        for (uint64_t i = first; i < head; ++i) {
+            while (owner + 1 < r->owners.size() && r->owners[owner + 1].from <= i)
+                ++owner;
+            const Slot &slot = r->slots[i & (BufferEvents - 1)];
+            events.push_back({slot.name.load(std::memory_order_acquire), slot.begin.load(std::memory_order_acquire),
+                              slot.end.load(std::memory_order_acquire), slot.query.load(std::memory_order_acquire),
+                              r->owners[owner].thread});
+        }
+        // Писатель может уже перезаписывать ячейку события after - BufferEvents
+        const uint64_t after = r->head.load(std::memory_order_acquire) + 1;
+        if (after > BufferEvents && after - BufferEvents > first) {
+            const size_t overwritten = size_t(std::min(head, after - BufferEvents) - first);
+            events.erase(events.begin() + std::ptrdiff_t(copied), events.begin() + std::ptrdiff_t(copied + overwritten));
+        }
+    }
+    return events;
+}
+
+}
+
+/**
+ * @brief Количество событий, доступных для выгрузки.
+ */
+size_t eventCount()
+{
+    return snapshot(nullptr).size();
+}
+
+/**
+ * @brief Выгрузка событий в JSON формата Chrome trace events.
+ *
+ * События выводятся как завершенные интервалы ("ph": "X") с номером запроса в args,
+ * имена потоков - событиями метаданных. Времена - в микросекундах от запуска процесса.
+ */
+std::string chromeJson()
+{
+    std::vector<std::pair<uint32_t, std::string>> threads;
+    std::vector<Event> events = snapshot(&threads);
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.begin < b.begin; });
+
+    std::string json = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    auto separator = [&] {
+        json += first ? "\n" : ",\n";
+        first = false;
+    };
+    for (const auto &thread : threads) {
+        separator();
+        json += "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + std::to_string(thread.first)
+                + ", \"args\": {\"name\": \"";
+        appendEscaped(json, thread.second.c_str());
+        json += "\"}}";
+    }
+    char numbers[160];
+    for (const Event &event : events) {
+        separator();
+        json += "{\"name\": \"";
+        appendEscaped(json, event.name != nullptr ? event.name : "?");
+        std::snprintf(numbers, sizeof(numbers),
+                      "\", \"cat\": \"findpath\", \"ph\": \"X\", \"pid\": 1, \"tid\": %" PRIu32
+                      ", \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"query\": %" PRIu64 "}}",
+                      event.thread, double(event.begin) / 1000.0, double(event.end - event.begin) / 1000.0,
+                      event.query);
+        json += numbers;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+/**
+ * @brief Запись трассировки в файл JSON формата Chrome trace events.
+ *
+ * @param path Путь к файлу.
+ * @param error Описание ошибки (может быть nullptr).
+ * @return true при успехе.
+ */
+bool writeChromeJson(const std::string &path, std::string *error)
+{
+    const std::string json = chromeJson();
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        if (error != nullptr)
+            *error = "Cannot create " + path;
+        return false;
+    }
+    const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    if (std::fclose(file) != 0 || !written) {
+        if (error != nullptr)
+            *error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+}
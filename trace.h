@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Трассировка этапов обработки запросов на временной шкале (Trace).
+ *
+ * Этапы (обработка движения мыши, копирование сетки, ожидание в пуле потоков, поиск,
+ * отрисовка пути) отмечаются областями Trace::Scope. Каждое событие хранит имя этапа,
+ * время начала и длительность, номер потока и номер запроса, к которому относится этап,
+ * поэтому на временной шкале видно, на каком этапе и в каком потоке потеряно время кадра.
+ *
+ * События записываются в кольцевой буфер потока без блокировок: писатель у буфера один,
+ * а чтение при выгрузке не останавливает запись (события, перезаписанные во время чтения,
+ * отбрасываются). Буфер хранит последние BufferEvents событий потока; буфер завершившегося
+ * потока переходит к следующему новому потоку. Выгрузка - JSON формата Chrome trace events
+ * (chrome://tracing, Perfetto).
+ *
+ * Пока трассировка выключена, область стоит одной проверки флага. При сборке с
+ * FINDPATH_NO_TRACE (qmake CONFIG += notrace) области полностью исключаются из кода.
+ */
+namespace Trace {
+
+constexpr size_t BufferEvents = size_t(1) << 16;    /**< Емкость кольцевого буфера потока. */
+
+void setEnabled(bool enabled);
+uint64_t now();
+uint64_t newQuery();
+uint64_t currentQuery();
+void complete(const char *name, uint64_t beginNs, uint64_t endNs, uint64_t query);
+void setThreadName(const std::string &name);
+void clear();
+size_t eventCount();
+size_t memoryBytes();
+std::string chromeJson();
+bool writeChromeJson(const std::string &path, std::string *error = nullptr);
+
+#ifdef FINDPATH_NO_TRACE
+
+inline bool isEnabled() { return false; }
+
+/**
+ * @brief Заглушка области трассировки для сборки без трассировки.
+ */
+class Scope
+{
+public:
+    explicit Scope(const char *, uint64_t = 0) {}
+};
+
+/**
+ * @brief Заглушка номера текущего запроса для сборки без трассировки.
+ */
+class QueryScope
+{
+public:
+    explicit QueryScope(uint64_t) {}
+};
+
+#else
+
+namespace detail {
+extern std::atomic<bool> enabled;
+uint64_t exchangeQuery(uint64_t query);
+}
+
+/** @brief Включена ли трассировка. */
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Область трассировки.
+ *
+ * Записывает событие от создания до разрушения объекта, если трассировка была включена
+ * при создании.
+ */
+class Scope
+{
+public:
+    /**
+     * @param name Имя этапа (строка должна жить до выгрузки, обычно литерал).
+     * @param query Номер запроса (0 - текущий запрос потока, см. QueryScope).
+     */
+    explicit Scope(const char *name, uint64_t query = 0)
+        : m_name(isEnabled() ? name : nullptr)
+    {
+        if (m_name != nullptr) {
+            m_query = query != 0 ? query : currentQuery();
+            m_begin = now();
+        }
+    }
+
+    ~Scope()
+    {
+        if (m_name != nullptr)
+            complete(m_name, m_begin, now(), m_query);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *m_name;     /**< Имя этапа (nullptr - событие не записывается). */
+    uint64_t m_query {0};   /**< Номер запроса. */
+    uint64_t m_begin {0};   /**< Время начала. */
+};
+
+/**
+ * @brief Номер текущего запроса потока.
+ *
+ * Пока объект существует, области без явного номера запроса (например, внутри
+ * a_star_search_compact()) относятся к этому запросу.
+ */
+class QueryScope
+{
+public:
+    explicit QueryScope(uint64_t query)
+        : m_active(isEnabled())
+    {
+        if (m_active)
+            m_previous = detail::exchangeQuery(query);
+    }
+
+    ~QueryScope()
+    {
+        if (m_active)
+            detail::exchangeQuery(m_previous);
+    }
+
+    QueryScope(const QueryScope &) = delete;
+    QueryScope &operator=(const QueryScope &) = delete;
+
+private:
+    bool m_active;              /**< Был ли номер установлен. */
+    uint64_t m_previous {0};    /**< Номер запроса до создания объекта. */
+};
+
+#endif
+
+}
@@ -57,6 +57,31 @@ void View::wheelEvent(QWheelEvent *event)
 }
 #endif
 
+/**
+ * @brief Прокрутка содержимого.
+ *
+ * Испускает сигнал viewportChanged(), так как видимая область сцены изменилась.
+ *
+ * @param dx Смещение по горизонтали.
+ * @param dy Смещение по вертикали.
+ */
+void View::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+    emit viewportChanged();
+}
+
+/**
+ * @brief Обработчик изменения размера представления.
+ *
+ * @param event Указатель на событие изменения размера.
+ */
+void View::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    emit viewportChanged();
+}
+
 /**
  * @brief Увеличение масштаба.
  *
@@ -100,4 +125,5 @@ void View::setupMatrix()
     QTransform matrix;
     matrix.scale(scale, scale); // Применение масштабирования к матрице
     setTransform(matrix);       // Установка матрицы преобразования
+    emit viewportChanged();
 }
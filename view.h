@@ -16,10 +16,15 @@ public:
 
     void resetZoom();
 
+signals:
+    void viewportChanged();
+
 protected:
 #if QT_CONFIG(wheelevent)
     void wheelEvent(QWheelEvent *event) override;
 #endif
+    void scrollContentsBy(int dx, int dy) override;
+    void resizeEvent(QResizeEvent *event) override;
 
 private:
     int m_zoom; /**< Текущее значение зума. */